@@ -15,7 +15,7 @@ using namespace blaze;
 
 // Functions using fetch should always be made named handlers
 Async<void> github_handler(Request& req, Response& res) {
-    std::string user = req.params["user"];
+    std::string user(req.params["user"]);
     std::string url = "https://api.github.com/users/" + user;
 
     std::map<std::string, std::string> headers;
@@ -3,17 +3,22 @@
 
 #include <blaze/router.h>
 #include <blaze/logger.h>
+#include <blaze/tracing.h>
+#include <blaze/flight_recorder.h>
 #include <blaze/websocket.h>
 #include <blaze/di.h>
 #include <blaze/injector.h>
 #include <blaze/json.h>
 #include <blaze/reflection.h>
+#include <blaze/util/http_date.h>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <functional>
 #include <vector>
 #include <map>
 #include <mutex>
+#include <string_view>
+#include <unordered_map>
 
 namespace net = boost::asio;
 namespace ssl = boost::asio::ssl;
@@ -43,6 +48,15 @@ struct AppConfig {
     int num_threads = 0;                     // 0 = auto-detect
     std::string server_name = "Blaze/1.0";   // Server header
     bool enable_docs = true;                 // Enable Swagger UI
+    std::string metrics_path;                // Prometheus endpoint; empty disables metrics
+    size_t pipeline_depth = 16;              // Max in-flight pipelined requests per connection
+    bool http2 = true;                       // Offer h2 via ALPN on listen_ssl() (needs libnghttp2)
+    bool h2c = false;                        // Accept prior-knowledge cleartext HTTP/2 on listen()
+    uint32_t http2_max_streams = 100;        // Concurrent streams per HTTP/2 connection
+    bool shard_per_core = false;             // One io_context + SO_REUSEPORT acceptor per thread
+    bool pin_threads = false;                // Pin each shard's thread to a CPU (Linux)
+    size_t stream_chunk_size = 64 * 1024;    // Read buffer per streamed request body
+    size_t max_stream_body_size = 1024ULL * 1024 * 1024; // 1GB cap on streamed bodies
 };
 
 
@@ -54,25 +68,35 @@ struct AppConfig {
  */
 class App {
 private:
+    // Heterogeneous lookup so the session can probe with a string_view
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
     Router router_;
+    std::unordered_map<std::string, StaticResponse, StringHash, std::equal_to<>> static_routes_;
+    HeaderBlock header_block_;
     std::map<std::string, WebSocketHandlers> ws_routes_;
 
     // Session tracking for path-based broadcasting
     std::map<std::string, std::vector<std::weak_ptr<WebSocket>>> ws_sessions_;
     std::mutex ws_mtx_;
     
-    // Lifecycle Mutex (protects listeners_, signals_)
+    // Lifecycle Mutex (protects listeners_, signals_, dump_signals_)
     std::mutex lifecycle_mtx_;
 
     void broadcast_raw(const std::string& path, const std::string& payload);
 
-    net::io_context ioc_;
+    net::io_context ioc_;                                    // Shard 0 in shard-per-core mode
+    std::vector<std::unique_ptr<net::io_context>> shards_;  // Shards 1..n-1
     ssl::context ssl_ctx_{ssl::context::tlsv12};
-    std::vector<Middleware> middleware_;
     AppConfig config_;
     ServiceProvider services_;
     std::vector<std::shared_ptr<ListenerBase>> listeners_;
     std::unique_ptr<net::signal_set> signals_;
+    std::unique_ptr<net::signal_set> dump_signals_;      // SIGUSR1 for the flight recorder
+    Pipeline recorder_middleware_;                       // In front of the flight recorder's endpoint
     std::atomic<bool> stopping_{false};
 
 public:
@@ -129,12 +153,29 @@ public:
 
     App& log_to(const std::string& path) { config_.log_path = path; return *this; }
     App& log_level(LogLevel level) { config_.log_level = level; Logger::instance().set_level(level); return *this; }
+    App& access_log(AccessLogOptions options) { Logger::instance().set_access_log(std::move(options)); return *this; }
+    App& tracing(TracingOptions options) { Tracer::instance().configure(std::move(options)); return *this; }
     App& max_body_size(size_t bytes) { config_.max_body_size = bytes; return *this; }
     App& timeout(int seconds) { config_.timeout_seconds = seconds; return *this; }
     App& shutdown_timeout(int seconds) { config_.shutdown_timeout = seconds; return *this; }
     App& num_threads(int n) { config_.num_threads = n; return *this; }
     App& server_name(const std::string& name) { config_.server_name = name; return *this; }
     App& enable_docs(bool enable) { config_.enable_docs = enable; return *this; }
+    App& metrics(std::string path = "/metrics") { config_.metrics_path = std::move(path); return *this; }
+    App& flight_recorder(FlightRecorderOptions options = {}) { FlightRecorder::instance().configure(std::move(options)); return *this; }
+    /** @brief As above, with `middleware` (e.g. auth) run in front of the admin endpoint. */
+    App& flight_recorder(FlightRecorderOptions options, Pipeline middleware) {
+        recorder_middleware_ = std::move(middleware);
+        return flight_recorder(std::move(options));
+    }
+    App& pipeline_depth(size_t depth) { config_.pipeline_depth = depth; return *this; }
+    App& http2(bool enable) { config_.http2 = enable; return *this; }
+    App& h2c(bool enable) { config_.h2c = enable; return *this; }
+    App& http2_max_streams(uint32_t streams) { config_.http2_max_streams = streams; return *this; }
+    App& shard_per_core(bool enable) { config_.shard_per_core = enable; return *this; }
+    App& pin_threads(bool enable) { config_.pin_threads = enable; return *this; }
+    App& stream_chunk_size(size_t bytes) { config_.stream_chunk_size = bytes; return *this; }
+    App& max_stream_body_size(size_t bytes) { config_.max_stream_body_size = bytes; return *this; }
 
     /**
      * @brief Access the internal ServiceProvider for registering dependencies.
@@ -184,6 +225,19 @@ public:
         services_.provide<T>(std::make_shared<T>(std::forward<Args>(args)...));
     }
 
+    /**
+     * @brief Registers a service with one instance per event-loop shard.
+     * The factory receives the io_context of the shard resolving it. Without
+     * shard_per_core there is a single shard and this behaves like a singleton.
+     * usage: app.provide_per_shard<Cache>([](net::io_context& ioc) { return std::make_shared<Cache>(ioc); });
+     */
+    template<typename T>
+    void provide_per_shard(std::function<std::shared_ptr<T>(net::io_context&)> factory) {
+        services_.provide_per_shard<T>([this, factory](ServiceProvider&) {
+            return factory(local_engine());
+        });
+    }
+
     /**
      * @brief Registers an auto-wired transient service (new instance every time).
      */
@@ -203,29 +257,102 @@ public:
      */
     template<typename Func>
     void get(const std::string& path, Func handler) {
+        get(path, Pipeline{}, std::move(handler));
+    }
+
+    /**
+     * @brief Registers a GET route with its own middleware, run after global middleware.
+     * usage: app.get("/me", {middleware::jwt_auth(secret)}, handler);
+     */
+    template<typename Func>
+    void get(const std::string& path, Pipeline middleware, Func handler) {
         router_.add_doc(reflection::inspect_handler<Func>("GET", path));
-        router_.add_route("GET", path, wrap_handler(handler));
+        router_.add_route("GET", path, wrap_handler(handler), std::move(middleware));
     }
 
+    /**
+     * @brief Registers a constant GET (and HEAD) response, e.g. a health check.
+     *
+     * The response is serialized once here and HTTP/1.1 connections write it
+     * directly, skipping routing, middleware and access logging. Only an exact path
+     * match hits the fast path; the query string is ignored. HTTP/2 requests are
+     * served through the regular router.
+     *
+     * usage: app.get_static("/health", "OK", {{"Content-Type", "text/plain"}});
+     */
+    void get_static(const std::string& path, std::string body, StaticResponse::HeaderList headers = {}, int status = 200);
+
+    /** @brief Internal: the static response for a GET/HEAD target, or nullptr. */
+    const StaticResponse* find_static(std::string_view target) const;
+
+    /** @brief The shared Date/Server header lines, refreshed every second while the server runs. */
+    const HeaderBlock& header_block() const { return header_block_; }
+
     /** @brief Registers a POST route with magic injection. */
     template<typename Func>
     void post(const std::string& path, Func handler) {
+        post(path, Pipeline{}, std::move(handler));
+    }
+
+    template<typename Func>
+    void post(const std::string& path, Pipeline middleware, Func handler) {
+        router_.add_doc(reflection::inspect_handler<Func>("POST", path));
+        router_.add_route("POST", path, wrap_handler(handler), std::move(middleware));
+    }
+
+    /**
+     * @brief Registers a POST route whose body is streamed instead of buffered.
+     *
+     * The handler runs as soon as the headers arrive and pulls the body with
+     * `co_await req.read_chunk()` or `co_await req.save_to(path)`; `req.body` stays empty.
+     * Memory per upload is bounded by AppConfig::stream_chunk_size, and the size limit is
+     * AppConfig::max_stream_body_size rather than max_body_size.
+     */
+    template<typename Func>
+    void post_stream(const std::string& path, Func handler) {
+        post_stream(path, Pipeline{}, std::move(handler));
+    }
+
+    template<typename Func>
+    void post_stream(const std::string& path, Pipeline middleware, Func handler) {
         router_.add_doc(reflection::inspect_handler<Func>("POST", path));
-        router_.add_route("POST", path, wrap_handler(handler));
+        router_.add_route("POST", path, wrap_handler(handler), std::move(middleware), true);
+    }
+
+    /** @brief Registers a PUT route whose body is streamed; see post_stream(). */
+    template<typename Func>
+    void put_stream(const std::string& path, Func handler) {
+        put_stream(path, Pipeline{}, std::move(handler));
+    }
+
+    template<typename Func>
+    void put_stream(const std::string& path, Pipeline middleware, Func handler) {
+        router_.add_doc(reflection::inspect_handler<Func>("PUT", path));
+        router_.add_route("PUT", path, wrap_handler(handler), std::move(middleware), true);
     }
 
     /** @brief Registers a PUT route with magic injection. */
     template<typename Func>
     void put(const std::string& path, Func handler) {
+        put(path, Pipeline{}, std::move(handler));
+    }
+
+    template<typename Func>
+    void put(const std::string& path, Pipeline middleware, Func handler) {
         router_.add_doc(reflection::inspect_handler<Func>("PUT", path));
-        router_.add_route("PUT", path, wrap_handler(handler));
+        router_.add_route("PUT", path, wrap_handler(handler), std::move(middleware));
     }
 
     /** @brief Registers a DELETE route with magic injection. */
     template<typename Func>
     void del(const std::string& path, Func handler) {
+        del(path, Pipeline{}, std::move(handler));
+    }
+
+    template<typename Func>
+    void del(const std::string& path, Pipeline middleware, Func handler) {
         router_.add_doc(reflection::inspect_handler<Func>("DELETE", path));
-        router_.add_route("DELETE", path, wrap_handler(handler));
+        router_.add_route("DELETE", path, wrap_handler(handler), std::move(middleware));
     }
 
     /** @brief Registers a WebSocket route. */
@@ -263,12 +390,12 @@ public:
     void listen_ssl(int port, const std::string& cert_path, const std::string& key_path, int num_threads = 0);
 
     /**
-     * @brief Registers global middleware.
+     * @brief Registers global middleware, run for every request before any group or route middleware.
      */
     void use(const Middleware &mw);
 
-    /** @brief Creates a route group with a common prefix. */
-    RouteGroup group(const std::string& prefix);
+    /** @brief Creates a route group with a common prefix and, optionally, middleware for its routes. */
+    RouteGroup group(const std::string& prefix, Pipeline middleware = {});
 
     /**
      * @brief Auto-registers multiple controllers.
@@ -290,12 +417,30 @@ public:
 
     /** @brief Returns the internal io_context engine. */
     net::io_context& engine() { return ioc_; }
-    boost::asio::awaitable<Response> handle_request(Request& req, const std::string& client_ip, bool keep_alive);
+
+    /**
+     * @brief Returns the io_context driving the calling thread.
+     * In shard-per-core mode this is the current shard's context; otherwise engine().
+     */
+    net::io_context& local_engine();
+
+
+    /**
+     * @brief Routes a request through middleware and its handler.
+     * Date, Server and Connection are added by the session when the response is written.
+     */
+    boost::asio::awaitable<Response> handle_request(Request& req, const std::string& client_ip);
 
 private:
     void _register_docs();
+    void _register_metrics();
+    void _register_recorder();
+    void _wait_dump_signal();
+    void _start_clock();
     void _run_server(int num_threads);
-    boost::asio::awaitable<void> run_middleware(size_t index, Request& req, Response& res, const Handler& final_handler);
+    void _open_shards(int num_threads);
+    void _run_shard(size_t index);
+    net::io_context& _shard(size_t index);
 
     // Takes lambda and converts it into a standard (Request, Response) handler
     template<typename Func>
@@ -12,6 +12,8 @@
 #include <tuple>
 #include <type_traits>
 #include <mutex>
+#include <vector>
+#include <algorithm>
 
 namespace blaze {
 
@@ -19,13 +21,36 @@ namespace blaze {
 
 class ServiceProvider;
 
+/**
+ * @brief Index of the event-loop shard the calling thread runs.
+ * Always 0 unless the app runs in shard-per-core mode (see AppConfig::shard_per_core).
+ */
+inline size_t& this_shard() {
+    static thread_local size_t index = 0;
+    return index;
+}
+
+// A shard's instance of a per-shard service. Any thread outside the shards counts as
+// shard 0, so creating it must be safe against a concurrent resolve.
+struct ShardInstance {
+    std::once_flag created;
+    std::any instance;
+};
+
 struct ServiceDescriptor {
     using Factory = std::function<std::any(ServiceProvider&)>;
     
     Factory factory;
     bool is_singleton;
     std::any instance;
+    bool per_shard = false;
+    std::vector<std::unique_ptr<ShardInstance>> shard_instances; // One lazily created instance per shard
     std::shared_ptr<std::mutex> init_mutex = std::make_shared<std::mutex>(); 
+
+    // Not thread-safe; only called while services are being registered
+    void resize_shards(size_t count) {
+        while (shard_instances.size() < count) shard_instances.push_back(std::make_unique<ShardInstance>());
+    }
 };
 
 template <typename T>
@@ -34,6 +59,7 @@ std::shared_ptr<T> auto_wire_factory(ServiceProvider& sp);
 
 class ServiceProvider {
     std::unordered_map<std::type_index, ServiceDescriptor> services_;
+    size_t shard_count_ = 1;
 
 public:
     ServiceProvider() = default;
@@ -62,6 +88,31 @@ public:
         });
     }
     
+    /**
+     * @brief Registers a service with one instance per event-loop shard.
+     * The factory runs on the first resolve from each shard, on that shard's thread,
+     * so the instance can bind to the shard's io_context and never be shared across cores.
+     */
+    template<typename T>
+    void provide_per_shard(std::function<std::shared_ptr<T>(ServiceProvider&)> factory) {
+        ServiceDescriptor desc;
+        desc.is_singleton = true;
+        desc.per_shard = true;
+        desc.resize_shards(shard_count_);
+        desc.factory = [factory](ServiceProvider& sp) { return factory(sp); };
+        services_[std::type_index(typeid(T))] = std::move(desc);
+    }
+
+    /**
+     * @brief Sizes per-shard storage. Called by App before the shard threads start.
+     */
+    void set_shard_count(size_t count) {
+        shard_count_ = std::max(shard_count_, count);
+        for (auto& [type, desc] : services_) {
+            if (desc.per_shard) desc.resize_shards(shard_count_);
+        }
+    }
+
     template<typename T>
     void provide_transient(std::function<std::shared_ptr<T>(ServiceProvider&)> factory) {
         ServiceDescriptor desc;
@@ -89,6 +140,16 @@ public:
 
         auto& descriptor = it->second;
 
+        if (descriptor.per_shard) {
+            const size_t shard = this_shard();
+            if (shard >= descriptor.shard_instances.size()) {
+                throw std::runtime_error(std::string("No shard ") + std::to_string(shard) + " for service: " + typeid(T).name());
+            }
+            auto& slot = *descriptor.shard_instances[shard];
+            std::call_once(slot.created, [&] { slot.instance = descriptor.factory(*this); });
+            return std::any_cast<std::shared_ptr<T>>(slot.instance);
+        }
+
         if (descriptor.is_singleton) {
             if (descriptor.instance.has_value()) {
                 return std::any_cast<std::shared_ptr<T>>(descriptor.instance);
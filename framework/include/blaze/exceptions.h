@@ -42,6 +42,12 @@ public:
     NotFound(const std::string& msg = "Not Found") : HttpError(404, msg) {}
 };
 
+/** @brief 413 Payload Too Large */
+class PayloadTooLarge : public HttpError {
+public:
+    PayloadTooLarge(const std::string& msg = "Payload Too Large") : HttpError(413, msg) {}
+};
+
 /** @brief 500 Internal Server Error */
 class InternalServerError : public HttpError {
 public:
@@ -0,0 +1,170 @@
+#ifndef BLAZE_FLIGHT_RECORDER_H
+#define BLAZE_FLIGHT_RECORDER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace blaze {
+
+struct RequestScope;
+
+/** @brief Where a request spent its time. DB_WAIT/DB_EXEC are not counted again in MIDDLEWARE or HANDLER. */
+enum class Phase : uint8_t {
+    READ,        // From the start of the read to a parsed request; includes keep-alive idle time and,
+                 // for a pipelined request, the wait behind the ones before it
+    ROUTE,       // Route lookup and path parameter decoding
+    MIDDLEWARE,
+    HANDLER,
+    DB_WAIT,     // Waiting for a pooled connection
+    DB_EXEC,     // Running queries
+    WRITE        // Writing the response (HTTP/1.1 only)
+};
+inline constexpr size_t kPhaseCount = 7;
+
+std::string_view phase_name(Phase phase);
+
+/** @brief Inline text with a fixed capacity; longer values are truncated. */
+template <size_t N>
+struct FixedText {
+    char data[N];
+    uint16_t size = 0;
+
+    void assign(std::string_view value) {
+        size = static_cast<uint16_t>(std::min(value.size(), N));
+        if (size) std::memcpy(data, value.data(), size);
+    }
+    std::string_view view() const { return {data, size}; }
+};
+
+/**
+ * @brief The phase timings of one request, filled in as it moves through the server.
+ * It lives in the request's RequestScope, where database pools find it.
+ */
+struct RequestProfile {
+    std::array<int64_t, kPhaseCount> phase_us{};
+    std::string_view route;                // Matched route template; points into the router
+    uint32_t queries = 0;
+    int64_t slowest_query_us = 0;
+    FixedText<512> slowest_sql;
+
+    void add(Phase phase, std::chrono::microseconds duration) { phase_us[static_cast<size_t>(phase)] += duration.count(); }
+    int64_t get(Phase phase) const { return phase_us[static_cast<size_t>(phase)]; }
+    int64_t db_us() const { return get(Phase::DB_WAIT) + get(Phase::DB_EXEC); }
+
+    /** @brief Time the server spent on the request: every phase except READ. */
+    int64_t server_us() const;
+};
+
+struct FlightRecorderOptions {
+    std::chrono::microseconds request_threshold = std::chrono::milliseconds(500); // Compared to server_us()
+    std::chrono::microseconds query_threshold = std::chrono::milliseconds(100);   // Wait plus execution
+    size_t capacity = 128;                    // Records kept per ring; the oldest is overwritten
+    std::string path;                         // Admin endpoint, e.g. "/debug/slow"; none unless set
+    bool dump_on_signal = true;               // Write the dump to the log on SIGUSR1
+};
+
+struct SlowRequestRecord {
+    int64_t time_us = 0;                      // Wall clock at completion, microseconds since the epoch
+    int64_t total_us = 0;                     // server_us() plus READ, idle time and all
+    std::array<int64_t, kPhaseCount> phase_us{};
+    int32_t status = 0;
+    uint32_t queries = 0;
+    int64_t slowest_query_us = 0;
+    FixedText<16> method;
+    FixedText<96> route;
+    FixedText<192> path;
+    FixedText<512> slowest_sql;
+};
+
+struct SlowQueryRecord {
+    int64_t time_us = 0;
+    int64_t wait_us = 0;
+    int64_t exec_us = 0;
+    FixedText<16> driver;
+    FixedText<96> route;                      // Of the request that ran it, if any
+    FixedText<1024> sql;
+};
+
+/**
+ * @brief Always-on recorder of the most recent slow requests and slow queries.
+ *
+ * Each kind goes into its own fixed ring of `capacity` preallocated records, overwritten
+ * oldest first. Fast requests cost a comparison against the threshold; only slow ones
+ * take the recorder's lock and copy their fields. dump() renders both rings as JSON,
+ * newest first, for the admin endpoint and the SIGUSR1 handler.
+ */
+class FlightRecorder {
+public:
+    static FlightRecorder& instance();
+
+    /** @brief Enables recording and clears both rings. Call before serving. */
+    void configure(FlightRecorderOptions options);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /** @brief Stops recording until the next configure(). What the rings hold is still dumped. */
+    void disable();
+
+    const FlightRecorderOptions& options() const { return options_; }
+
+    /** @brief Keeps the request if its server time is over the threshold. */
+    void record_request(const RequestProfile& profile, std::string_view method, std::string_view path, int status);
+
+    /** @brief Adds the query to `profile` (may be null) and keeps it if it is over the threshold. */
+    void record_query(RequestProfile* profile, std::string_view driver, std::string_view sql,
+                      std::chrono::microseconds wait, std::chrono::microseconds exec);
+
+    /** @brief Both rings as JSON: {"slow_requests": [...], "slow_queries": [...]}. */
+    std::string dump();
+
+private:
+    FlightRecorder() = default;
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<int64_t> request_threshold_us_{0};
+    std::atomic<int64_t> query_threshold_us_{0};
+    FlightRecorderOptions options_;
+
+    std::mutex mutex_;
+    std::vector<SlowRequestRecord> requests_;
+    std::vector<SlowQueryRecord> queries_;
+    uint64_t requests_written_ = 0;
+    uint64_t queries_written_ = 0;
+};
+
+/**
+ * @brief Times one database call for the recorder. Used by the connection pools:
+ * construct before acquiring a connection, call acquired() once one is held, and the
+ * destructor records the wait and execution times against the request current at
+ * construction.
+ */
+class QueryTimer {
+public:
+    QueryTimer(std::string_view driver, std::string_view sql);
+    ~QueryTimer();
+
+    QueryTimer(const QueryTimer&) = delete;
+    QueryTimer& operator=(const QueryTimer&) = delete;
+
+    void acquired();
+
+private:
+    bool active_;
+    std::string_view driver_;
+    std::string_view sql_;
+    std::shared_ptr<RequestScope> scope_;   // Of the request that ran the query, while profiled
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point acquired_;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_FLIGHT_RECORDER_H
@@ -59,10 +59,10 @@ namespace detail {
             InnerT model{};
             using Members = boost::describe::describe_members<InnerT, boost::describe::mod_any_access>;
             boost::mp11::mp_for_each<Members>([&](auto meta) {
-                std::string key = meta.name;
-                if (req.query.contains(key)) {
+                const auto it = req.query.find(std::string_view(meta.name));
+                if (it != req.query.end()) {
                     using FieldT = std::remove_cvref_t<decltype(model.*meta.pointer)>;
-                    model.*meta.pointer = convert_string<FieldT>(req.query.at(key));
+                    model.*meta.pointer = convert_string<FieldT>(it->second);
                 }
             });
             try_validate(model);
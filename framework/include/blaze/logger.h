@@ -1,15 +1,19 @@
 #ifndef HTTP_SERVER_LOGGER_H
 #define HTTP_SERVER_LOGGER_H
 
+#include <array>
+#include <chrono>
 #include <string>
 #include <string_view>
-#include <queue>
+#include <vector>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <atomic>
-#include <fstream>
-#include <sstream>
+#include <cstdint>
+#include <ctime>
+#include <blaze/util/spsc_ring.h>
 
 namespace blaze {
 
@@ -20,24 +24,127 @@ enum class LogLevel {
     ERROR
 };
 
+enum class AccessLogFormat {
+    TEXT,    // [2024-01-01 12:00:00] ACCESS: <ip> <method> <path> <status> <ms>ms
+    JSON,    // One JSON object per line
+    LOGFMT   // key=value pairs
+};
+
+/**
+ * @brief What the access log records and how much of it.
+ *
+ * Sampling is decided per request from the status and duration alone, before anything
+ * is copied or formatted. Slow requests are always kept.
+ */
+struct AccessLogOptions {
+    AccessLogFormat format = AccessLogFormat::TEXT;
+    double sample_success = 1.0;                   // Share of 1xx-3xx responses logged
+    double sample_client_error = 1.0;              // Share of 4xx responses logged
+    double sample_server_error = 1.0;              // Share of 5xx responses logged
+    std::chrono::microseconds slow_threshold{0};   // Always log requests at least this slow; 0 disables
+    std::string user_claim = "sub";                // Claim logged as the user id of authenticated requests
+};
+
+/** @brief One request as the access log sees it. Views only need to live for the call. */
+struct AccessLogEntry {
+    std::string_view client_ip;
+    std::string_view method;
+    std::string_view path;
+    std::string_view route;     // Matched route template; empty when nothing matched
+    std::string_view user;      // Empty for anonymous requests
+    int status = 0;
+    std::chrono::microseconds duration{0};
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+};
+
+/**
+ * @brief Asynchronous logger with a lock-free access-log path.
+ *
+ * log_access() copies its fields into a fixed-size record in the calling thread's own
+ * SpscRing; it takes no lock and allocates nothing. If the ring is full the record is
+ * dropped and counted (see dropped()), so a slow disk never stalls request handling.
+ * The worker drains every ring in batches, formats each batch with a timestamp cached
+ * per second and writes it with one writev(). Other messages go through a mutex-guarded
+ * queue drained in the same batches.
+ */
 class Logger {
+public:
+    /** @brief Access records each thread can buffer before new ones are dropped. */
+    static constexpr size_t kRingCapacity = 2048;
+
 private:
-    std::ofstream file_stream_;
+    // One access-log line, copied in by the request thread. Long fields are truncated.
+    struct AccessRecord {
+        int64_t time_us;        // Wall clock, microseconds since the epoch
+        int64_t duration_us;
+        uint64_t bytes_in;
+        uint64_t bytes_out;
+        int32_t status;
+        AccessLogFormat format;
+        uint8_t ip_len;
+        uint8_t method_len;
+        uint8_t user_len;
+        uint8_t route_len;
+        uint16_t path_len;
+        char ip[46];
+        char method[16];
+        char user[48];
+        char route[80];
+        char path[160];
+    };
+
+    struct ThreadBuffer {
+        SpscRing<AccessRecord, kRingCapacity> ring;
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false}; // Owning thread has exited; removed once drained
+    };
+
+    struct Message {
+        LogLevel level;
+        std::time_t time;
+        std::string text;
+    };
+
+    int fd_{-1};
+    bool owns_fd_{false};
     bool use_stdout_{false};
-    bool enabled_{true};
-    LogLevel level_{LogLevel::INFO};
-    
-    // Config Mutex (protects file_stream_, use_stdout_, enabled_, level_)
+    std::atomic<bool> enabled_{true};
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+
+    // Access log settings; thresholds are out of 2^32, so sampling is one integer compare
+    AccessLogOptions access_options_;
+    std::atomic<AccessLogFormat> access_format_{AccessLogFormat::TEXT};
+    std::array<std::atomic<uint64_t>, 3> sample_thresholds_;
+    std::atomic<int64_t> slow_threshold_us_{0};
+
+    // Config Mutex (protects fd_, owns_fd_, use_stdout_); the worker holds it while writing
     std::mutex config_mutex_;
 
-    // Async Queue
-    std::queue<std::string> queue_;
+    // Per-thread access rings; registration is the only time producers take this lock
+    std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    uint64_t retired_dropped_{0};
+
+    // Everything that isn't an access record
+    std::vector<Message> messages_;
     std::mutex queue_mutex_;
     std::condition_variable cv_;
+    std::atomic<bool> wake_{false};
     std::thread worker_;
     std::atomic<bool> running_{true};
 
-    static std::string get_timestamp();
+    // flush() handshake
+    std::atomic<uint64_t> flush_requested_{0};
+    uint64_t flush_done_{0};
+    std::condition_variable flush_cv_;
+
+    struct WorkerState;
+
+    static char* format_access(WorkerState& state, const AccessRecord& rec, char* out);
+    ThreadBuffer& local_buffer();
+    void wake_worker();
+    size_t drain(WorkerState& state);
     void process_queue();
 
     // Private Constructor (Singleton)
@@ -45,17 +152,31 @@ private:
 
 public:
     ~Logger();
-    
+
     // Global Access Point
     static Logger& instance();
 
     // Configuration
     void configure(const std::string& path);
-    void set_level(LogLevel level) { level_ = level; }
-    LogLevel get_level() const { return level_; }
+    void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel get_level() const { return level_.load(std::memory_order_relaxed); }
 
     void log(LogLevel level, std::string_view message);
 
+    /**
+     * @brief Sets the access log format and sampling. Not thread-safe for user_claim;
+     * call before serving.
+     */
+    void set_access_log(AccessLogOptions options);
+    const AccessLogOptions& access_log() const { return access_options_; }
+
+    /** @brief Whether a request with this outcome should be logged; call before building the entry. */
+    bool sample_access(int status_code, std::chrono::microseconds duration);
+
+    /** @brief Records `entry` unconditionally; pair with sample_access(). */
+    void log_access(const AccessLogEntry& entry);
+
+    /** @brief Samples, then records a request with only the basic fields. */
     void log_access(std::string_view client_ip,
                    std::string_view method,
                    std::string_view path,
@@ -63,7 +184,13 @@ public:
                    long long response_time_ms);
 
     void log_error(const std::string& message);
-    
+
+    /** @brief Blocks until everything logged before the call has been written. */
+    void flush();
+
+    /** @brief Access records dropped so far because a thread's ring was full. */
+    uint64_t dropped();
+
     // Convenience methods
     void debug(const std::string& msg) { log(LogLevel::DEBUG, msg); }
     void info(const std::string& msg) { log(LogLevel::INFO, msg); }
@@ -0,0 +1,105 @@
+#ifndef BLAZE_METRICS_H
+#define BLAZE_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace blaze {
+
+/**
+ * @brief Latency histogram with fixed buckets from 100us to 10s.
+ *
+ * observe() is a bucket search and two relaxed atomic adds. Buckets are stored
+ * non-cumulatively; snapshot() sums them the way Prometheus expects.
+ */
+class Histogram {
+public:
+    /** @brief Bucket upper bounds in microseconds; a final +Inf bucket follows. */
+    static constexpr std::array<int64_t, 16> kBoundsUs = {
+        100, 250, 500, 1'000, 2'500, 5'000, 10'000, 25'000, 50'000,
+        100'000, 250'000, 500'000, 1'000'000, 2'500'000, 5'000'000, 10'000'000
+    };
+    static constexpr size_t kBuckets = kBoundsUs.size() + 1;
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> buckets{}; // Non-cumulative
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+
+        void merge(const Snapshot& other);
+    };
+
+    void observe(std::chrono::microseconds duration);
+    Snapshot snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> sum_us_{0};
+};
+
+/**
+ * @brief Live statistics of one connection pool, updated by the pool and read at scrape time.
+ */
+struct PoolMetrics {
+    std::string driver;               // "postgres", "mysql", ...
+    std::string id;                   // Tells pools of the same driver apart, e.g. one per shard
+    std::atomic<int64_t> size{0};     // Connections opened
+    std::atomic<int64_t> in_use{0};   // Checked out right now
+    std::atomic<int64_t> waiters{0};  // Coroutines waiting for a connection
+    Histogram acquire;                // Time from asking for a connection to getting one
+};
+
+/**
+ * @brief Process-wide metrics, rendered in the Prometheus text format.
+ *
+ * Request counts and latencies are kept per io thread: each thread owns a table of
+ * series keyed by method, route template and status, and only that thread writes to
+ * it. The hot path is a hash lookup in thread-local memory plus a few uncontended
+ * atomic adds; a thread only takes its table's lock to add a new series. render()
+ * merges every thread's table.
+ *
+ * Connection pools register a PoolMetrics and keep it updated; the registry only holds
+ * a weak reference, so a destroyed pool simply stops being reported.
+ */
+class Metrics {
+public:
+    static Metrics& instance();
+
+    /** @brief Counts one request. `route` is the route template; empty for unmatched requests. */
+    void observe_request(std::string_view method, std::string_view route, int status,
+                         std::chrono::microseconds duration);
+
+    /** @brief A PoolMetrics for a new pool; keep it alive for as long as the pool. */
+    std::shared_ptr<PoolMetrics> register_pool(std::string driver);
+
+    /** @brief Every metric family this registry knows, in Prometheus text format 0.0.4. */
+    std::string render();
+
+    // Helpers for rendering additional families
+    static void write_header(std::string& out, std::string_view name, std::string_view type, std::string_view help);
+    static void write_label(std::string& out, std::string_view name, std::string_view value, bool first);
+
+private:
+    Metrics() = default;
+
+    struct Series;
+    struct ThreadTable;
+
+    ThreadTable& local_table();
+
+    std::mutex registry_mutex_;
+    std::vector<std::shared_ptr<ThreadTable>> tables_;
+    std::vector<std::weak_ptr<PoolMetrics>> pools_;
+    size_t next_pool_id_ = 0;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_METRICS_H
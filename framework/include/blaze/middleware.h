@@ -6,6 +6,8 @@
 #include <blaze/response.h>
 #include <blaze/crypto.h>
 #include <blaze/exceptions.h>
+#include <blaze/rate_limit.h>
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sys/stat.h>
@@ -14,6 +16,7 @@
 #include <shared_mutex>
 #include <unordered_map>
 #include <filesystem>
+#include <functional>
 
 namespace blaze::middleware
 {
@@ -25,8 +28,36 @@ namespace blaze::middleware
                    const std::string& methods = "GET, POST, PUT, DELETE, OPTIONS",
                    const std::string& headers = "Content-Type, Authorization");
 
-    /** @brief Serves static files from a directory. Supports streaming via file_body. */
-    Middleware static_files(const std::string& root_dir, bool serve_index = true);
+    /** @brief In-memory cache settings for static_files(). */
+    struct StaticCacheOptions {
+        size_t max_bytes = 64 * 1024 * 1024;    // Total memory for cached files and their variants; 0 disables the cache
+        size_t max_file_size = 256 * 1024;      // Larger files are always streamed from disk
+        std::chrono::milliseconds revalidate{1000}; // How often a cached file's mtime is re-checked
+    };
+
+    /**
+     * @brief Serves static files from a directory.
+     * Small files are kept in an LRU cache with gzip/brotli variants, ETag and Last-Modified,
+     * and are served without filesystem calls; larger files are streamed from disk.
+     */
+    Middleware static_files(const std::string& root_dir, bool serve_index = true,
+                            StaticCacheOptions cache = {});
+
+    /** @brief Settings for compression(). */
+    struct CompressionOptions {
+        size_t min_size = 1024;     // Smaller complete bodies are sent as-is
+        int level = 6;              // gzip/deflate level, 1 (fastest) to 9 (smallest)
+        int brotli_quality = 4;     // 0-11; qualities above ~5 cost far more CPU for little gain
+        bool brotli = true;         // Offer br when built with libbrotlienc
+    };
+
+    /**
+     * @brief Compresses responses for clients that accept it (br, gzip or deflate).
+     * Only compressible content types are touched. Complete bodies must be at least
+     * `min_size`; streamed and whole-file bodies are compressed as they are sent.
+     * Register it before middleware whose responses it should compress.
+     */
+    Middleware compression(CompressionOptions options = {});
 
     /** @brief Limits the size of the request body. */
     Middleware limit_body_size(size_t max_bytes);
@@ -56,11 +87,52 @@ namespace blaze::middleware
         };
     }
 
-    /** @brief JWT Authentication middleware. */
-    Middleware jwt_auth(const std::string_view secret);
+    /**
+     * @brief JWT Authentication middleware. Verified tokens are cached (up to `cache_entries`,
+     * 0 disables the cache) until they expire, so a reused token is only verified once.
+     */
+    Middleware jwt_auth(const std::string_view secret, size_t cache_entries = 10000);
+
+    /**
+     * @brief Picks what a request is counted against. An empty key exempts the request.
+     */
+    using RateLimitKey = std::function<std::string(const Request&)>;
+
+    /** @brief Counts requests per client IP (the default). */
+    RateLimitKey key_by_ip();
 
-    /** @brief Basic Rate Limiting middleware. */
+    /** @brief Counts requests per value of `header`, e.g. an API key; requests without it fall back to the IP. */
+    RateLimitKey key_by_header(std::string header);
+
+    /**
+     * @brief Counts requests per authenticated user, identified by a claim set by jwt_auth()
+     * (the subject by default). Anonymous requests fall back to the IP. Register jwt_auth() first.
+     */
+    RateLimitKey key_by_user(std::string claim = "sub");
+
+    /** @brief Settings for rate_limit(). */
+    struct RateLimitOptions {
+        int max_requests = 100;             // Allowed per window, and the largest burst
+        std::chrono::seconds window{60};
+        RateLimitKey key = key_by_ip();
+    };
+
+    /**
+     * @brief Limits each client to `max_requests` per window with GCRA, answering 429 with
+     * Retry-After once it is exceeded. Requests refill smoothly rather than all at once when a
+     * fixed window ends. The limiter is sharded; a known client costs a shared lock and one
+     * compare-and-swap. Idle clients are forgotten once their allowance has fully refilled.
+     */
+    Middleware rate_limit(RateLimitOptions options);
+
+    /** @brief rate_limit() per client IP. */
     Middleware rate_limit(int max_requests, int window_seconds);
+
+    /**
+     * @brief rate_limit() with counts kept by `backend`, e.g. a RedisRateLimitBackend shared
+     * by every instance behind a load balancer. The backend carries the limit and window.
+     */
+    Middleware rate_limit(std::shared_ptr<RateLimitBackend> backend, RateLimitKey key = key_by_ip());
 }
 
 #endif
@@ -11,6 +11,7 @@
 #include <blaze/json.h>
 #include <blaze/util/circuit_breaker.h>
 #include <blaze/database.h>
+#include <blaze/metrics.h>
 #include <blaze/mysql_connection.h>
 #include <blaze/app.h>
 
@@ -31,6 +32,18 @@ public:
         app.service(open(app, std::move(url), size)).template as<Database>();
     }
 
+    // One pool per event-loop shard, bound to that shard's io_context (see App::shard_per_core)
+    static void install_per_shard(App& app, std::string url, int size = 10) {
+        app.provide_per_shard<MySqlPool>([url, size](boost::asio::io_context& ctx) {
+            auto pool = std::make_shared<MySqlPool>(ctx, url, size);
+            pool->connect();
+            return pool;
+        });
+        app.services().provide_per_shard<Database>([](ServiceProvider& sp) -> std::shared_ptr<Database> {
+            return sp.resolve<MySqlPool>();
+        });
+    }
+
         void connect();
         boost::asio::awaitable<DbResult> query(const std::string& sql, const std::vector<std::string>& params = {}) override;
         boost::asio::awaitable<void> execute_transaction(std::function<boost::asio::awaitable<void>(Database&)> block) override;
@@ -54,6 +67,7 @@ private:
     std::queue<std::shared_ptr<boost::asio::steady_timer>> waiters_;
     std::mutex mutex_;
     CircuitBreaker breaker_;
+    std::shared_ptr<PoolMetrics> metrics_;
 
     void parse_url();
     boost::asio::awaitable<MySqlConnection*> acquire();
@@ -11,6 +11,7 @@
 #include <blaze/json.h>
 #include <blaze/util/circuit_breaker.h>
 #include <blaze/database.h>
+#include <blaze/metrics.h>
 #include <blaze/app.h>
 #include "pg_connection.h"
 
@@ -31,6 +32,18 @@ namespace blaze {
             app.service(open(app, std::move(conn_str), size)).template as<Database>();
         }
 
+        // One pool per event-loop shard, bound to that shard's io_context (see App::shard_per_core)
+        static void install_per_shard(App& app, std::string conn_str, int size = 10) {
+            app.provide_per_shard<PgPool>([conn_str, size](boost::asio::io_context& ctx) {
+                auto pool = std::make_shared<PgPool>(ctx, conn_str, size);
+                pool->connect();
+                return pool;
+            });
+            app.services().provide_per_shard<Database>([](ServiceProvider& sp) -> std::shared_ptr<Database> {
+                return sp.resolve<PgPool>();
+            });
+        }
+
         void connect();
         boost::asio::awaitable<DbResult> query(const std::string& sql, const std::vector<std::string>& params = {}) override;
         boost::asio::awaitable<void> execute_transaction(std::function<boost::asio::awaitable<void>(Database&)> block) override;
@@ -49,6 +62,7 @@ namespace blaze {
         std::queue<std::shared_ptr<boost::asio::steady_timer>> waiters_;
         std::mutex mutex_;
         CircuitBreaker breaker_;
+        std::shared_ptr<PoolMetrics> metrics_;
 
         boost::asio::awaitable<PgConnection*> acquire();
         void release(PgConnection* conn);
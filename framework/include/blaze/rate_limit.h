@@ -0,0 +1,143 @@
+#ifndef BLAZE_RATE_LIMIT_H
+#define BLAZE_RATE_LIMIT_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <blaze/util/circuit_breaker.h>
+#include <blaze/util/rate_limiter.h>
+
+namespace blaze {
+
+class App;
+
+/**
+ * @brief Where middleware::rate_limit() keeps its counts.
+ */
+class RateLimitBackend {
+public:
+    using Decision = RateLimiter::Decision;
+
+    virtual ~RateLimitBackend() = default;
+
+    /**
+     * @brief Decides from local state alone.
+     * @return std::nullopt when only acquire() can decide (e.g. it needs the network).
+     */
+    virtual std::optional<Decision> try_acquire(std::string_view key) = 0;
+
+    /** @brief Counts one request against `key`, waiting on remote state if it has to. */
+    virtual boost::asio::awaitable<Decision> acquire(std::string key) = 0;
+};
+
+/**
+ * @brief In-process limits (a RateLimiter). Each server instance counts on its own.
+ */
+class LocalRateLimitBackend : public RateLimitBackend {
+public:
+    LocalRateLimitBackend(int max_requests, std::chrono::seconds window);
+
+    std::optional<Decision> try_acquire(std::string_view key) override;
+    boost::asio::awaitable<Decision> acquire(std::string key) override;
+
+    RateLimiter& limiter() { return limiter_; }
+
+private:
+    RateLimiter limiter_;
+};
+
+/** @brief Settings for RedisRateLimitBackend. */
+struct RedisRateLimitOptions {
+    std::string host = "127.0.0.1";
+    unsigned short port = 6379;
+    std::string password;                    // Sent with AUTH when set
+    std::string prefix = "blaze:rl:";        // Namespace for the counters
+    int max_requests = 100;                  // Per key per window, across all instances
+    std::chrono::seconds window{60};
+    int lease_size = 100;                    // Tokens taken per round trip (at most max_requests)
+    std::chrono::milliseconds timeout{250};  // Per round trip, connecting included
+    size_t max_idle_connections = 8;
+    bool fail_open = true;                   // Allow requests while Redis is unreachable
+};
+
+/**
+ * @brief Limits shared by every instance through a Redis (or RESP-compatible) server.
+ *
+ * Counts are fixed windows aligned to wall-clock time: "<prefix><key>:<window>" is
+ * INCRBY'd by a whole lease of tokens at a time, and the instance hands them out
+ * locally until they run out. Only one request per lease_size touches the network;
+ * requests that run out of tokens while a key's lease is in flight wait for it rather
+ * than sending their own. A key the server reports as exhausted is refused locally
+ * until its window ends.
+ * Tokens leased but unused when the window ends are lost, so across N instances a
+ * key can be refused up to N * lease_size requests early; size leases accordingly.
+ * Repeated failures open a circuit breaker, after which requests are allowed (or
+ * refused, see fail_open) without waiting on the network.
+ */
+class RedisRateLimitBackend : public RateLimitBackend {
+public:
+    RedisRateLimitBackend(boost::asio::io_context& ctx, RedisRateLimitOptions options);
+    RedisRateLimitBackend(App& app, RedisRateLimitOptions options);
+    ~RedisRateLimitBackend() override;
+
+    std::optional<Decision> try_acquire(std::string_view key) override;
+    boost::asio::awaitable<Decision> acquire(std::string key) override;
+
+    /** @brief Lease round trips made so far. */
+    size_t round_trips() const { return round_trips_; }
+
+private:
+    struct Connection;
+    struct Flight;
+
+    struct Lease {
+        int64_t window = -1;
+        int tokens = 0;
+        bool exhausted = false;         // The server had nothing left this window
+        std::shared_ptr<Flight> flight; // Lease round trip in progress, if any
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    struct alignas(64) LeaseShard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Lease, KeyHash, std::equal_to<>> leases;
+        int64_t window = -1; // Leases from older windows are dropped when this moves on
+
+        void advance(int64_t now_window);
+    };
+
+    // Hands out a locally held token, or refuses a key known to be exhausted
+    std::optional<Decision> take(std::string_view key, int64_t window, std::chrono::milliseconds until_reset);
+    boost::asio::awaitable<long long> lease(const std::string& key, int64_t window);
+    std::shared_ptr<Connection> checkout();
+    void checkin(std::shared_ptr<Connection> conn);
+    Decision unavailable() const;
+    LeaseShard& shard_for(std::string_view key);
+
+    boost::asio::io_context& ctx_;
+    RedisRateLimitOptions options_;
+    int lease_size_;
+    std::array<LeaseShard, 16> shards_;
+    std::mutex pool_mutex_;
+    std::vector<std::shared_ptr<Connection>> idle_;
+    CircuitBreaker breaker_;
+    std::atomic<size_t> round_trips_{0};
+};
+
+} // namespace blaze
+
+#endif // BLAZE_RATE_LIMIT_H
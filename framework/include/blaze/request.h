@@ -5,33 +5,105 @@
 #include <string_view>
 #include <unordered_map>
 #include <optional>
+#include <memory_resource>
 #include <boost/json.hpp>
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/string_body.hpp>
+#include <boost/asio/awaitable.hpp>
 #include <any>
 #include <blaze/json.h>
 #include <blaze/exceptions.h>
 #include <blaze/di.h>
 #include <blaze/multipart.h>
+#include <blaze/tracing.h>
+#include <blaze/request_scope.h>
+#include <blaze/flight_recorder.h>
 
 namespace blaze {
 
+/**
+ * @brief Request header container. Uses a polymorphic allocator so the server can
+ * place it in the connection's arena.
+ */
+using Headers = boost::beast::http::basic_fields<std::pmr::polymorphic_allocator<char>>;
+
+/**
+ * @brief Source of a streamed request body, supplied by the server for routes
+ * registered with App::post_stream()/put_stream().
+ */
+class BodyReader {
+public:
+    virtual ~BodyReader() = default;
+
+    /** @brief Next piece of the body, valid until the next call. Empty once the body is done. */
+    virtual boost::asio::awaitable<std::string_view> read_chunk() = 0;
+};
+
+/**
+ * @brief Route parameters or query values. Keys and values are both allocated from the
+ * request's memory resource; lookups accept any string type without building a key.
+ */
+struct ParamHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+};
+
+struct ParamEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+};
+
+using ParamMap = std::pmr::unordered_map<std::pmr::string, std::pmr::string, ParamHash, ParamEqual>;
+
 struct Request {
+    /**
+     * @brief Per-request storage (path, params, query values, headers) is drawn from `mr`.
+     * The server passes its per-connection arena; the default uses the global heap.
+     */
+    Request() = default;
+    explicit Request(std::pmr::memory_resource* mr)
+        : path(mr), params(mr), path_values(mr), query(mr), headers(Headers::allocator_type(mr)), client_ip_(mr) {}
+
     std::string method;
-    std::string path;
+    std::pmr::string path;
     std::string body;
-    std::unordered_map<std::string, std::string> params;
-    std::vector<std::string> path_values;
-    std::unordered_map<std::string, std::string> query;
+    ParamMap params;
+    std::pmr::vector<std::pmr::string> path_values;
+    ParamMap query;
 
     // Owned copy of Beast headers
-    boost::beast::http::fields headers;
+    Headers headers;
 
     void set_target(std::string_view target);
-    void set_fields(boost::beast::http::fields&& fields);
+    void set_fields(Headers&& fields);
+
+    std::string_view client_ip() const { return client_ip_; }
+    void set_client_ip(std::string_view ip) { client_ip_.assign(ip.data(), ip.size()); }
     
     static std::string url_decode(std::string_view str);
 
+    /**
+     * @brief Reads the body piece by piece; an empty view marks the end.
+     *
+     * On streaming routes the body comes straight off the connection through a fixed
+     * buffer and `body` stays empty. Elsewhere the buffered `body` is returned in one piece.
+     */
+    boost::asio::awaitable<std::string_view> read_chunk();
+
+    /**
+     * @brief Streams the rest of the body into a file. Returns the number of bytes written.
+     *
+     * The writes are ordinary blocking file writes on the connection's thread. `path` is
+     * used as given; never build it from unchecked client input.
+     */
+    boost::asio::awaitable<size_t> save_to(const std::string& path);
+
+    /** @brief True if the body is streamed (see read_chunk()) rather than buffered in `body`. */
+    bool is_streaming() const { return body_reader_ != nullptr; }
+
+    // Internal use only
+    void _set_body_reader(BodyReader* reader) { body_reader_ = reader; }
+
     // Returns parsed JSON body wrapper
     blaze::Json json() const;
 
@@ -117,11 +189,33 @@ struct Request {
     // Internal use only
     void _set_services(ServiceProvider* sp) { services_ = sp; }
 
+    /** @brief This request's trace, or null when tracing is off or the request wasn't sampled. */
+    const std::shared_ptr<Trace>& trace() const {
+        static const std::shared_ptr<Trace> none;
+        return scope_ ? scope_->trace : none;
+    }
+
+    // Internal use only; see RequestScope::open()
+    const std::shared_ptr<RequestScope>& _scope() const { return scope_; }
+    bool _scope_opened() const { return scope_opened_; }
+    void _set_scope(std::shared_ptr<RequestScope> scope) {
+        scope_ = std::move(scope);
+        scope_opened_ = true;
+    }
+
+    /** @brief Phase timings for the flight recorder, or null when it is off. */
+    RequestProfile* profile() const { return scope_ && scope_->profiled ? &scope_->profile : nullptr; }
+
 private:
     ServiceProvider* services_ = nullptr;
+    BodyReader* body_reader_ = nullptr;
+    bool body_consumed_ = false;
     std::optional<blaze::Json> user_context_;
     std::unordered_map<std::string, std::any> context_;
+    std::pmr::string client_ip_;
     mutable std::optional<MultipartFormData> cached_form_;
+    std::shared_ptr<RequestScope> scope_;
+    bool scope_opened_ = false;
 };
 
 
@@ -0,0 +1,119 @@
+#ifndef BLAZE_REQUEST_SCOPE_H
+#define BLAZE_REQUEST_SCOPE_H
+
+#include <blaze/flight_recorder.h>
+#include <blaze/tracing.h>
+#include <boost/asio/execution.hpp>
+#include <boost/asio/query.hpp>
+#include <boost/asio/prefer.hpp>
+#include <boost/asio/require.hpp>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace blaze {
+
+struct Request;
+
+/**
+ * @brief What framework code that can't see the Request (database pools, fetch()) needs
+ * from it: the request's trace and its flight recorder profile.
+ *
+ * The server runs each scoped request on a RequestExecutor, which makes the scope current
+ * around every resumption of the request's coroutines, whatever they awaited.
+ */
+struct RequestScope : std::enable_shared_from_this<RequestScope> {
+    std::shared_ptr<Trace> trace; // Null if tracing is off or the request wasn't sampled
+    RequestProfile profile;
+    bool profiled = false;        // The flight recorder is on; `profile` is in use
+
+    /**
+     * @brief Gives `req` its scope, or none when nothing would use it. `cached` is reused
+     * when nothing else still holds it. Returns whether the request got a scope.
+     */
+    static bool open(Request& req, std::shared_ptr<RequestScope>& cached);
+
+    /** @brief The scope of the request running on this thread, or null. */
+    static RequestScope* current();
+
+    /**
+     * @brief Makes `scope` current for the rest of the running function; the Enter around
+     * it still restores what it replaced. For a caller that resumes inline from a request's scope.
+     */
+    static void make_current(RequestScope* scope);
+
+    /** @brief Makes `scope` current until destroyed, then restores the previous one. */
+    class Enter {
+    public:
+        explicit Enter(RequestScope* scope);
+        ~Enter();
+
+        Enter(const Enter&) = delete;
+        Enter& operator=(const Enter&) = delete;
+
+    private:
+        RequestScope* previous_;
+    };
+};
+
+/**
+ * @brief Executor adapter that runs everything submitted to `Inner` inside a RequestScope.
+ * Completions of every await resume through it, so the scope follows the request across
+ * threads and past awaits on other libraries' objects.
+ */
+template <typename Inner>
+class RequestExecutor {
+public:
+    RequestExecutor(Inner inner, std::shared_ptr<RequestScope> scope) noexcept
+        : inner_(std::move(inner)), scope_(std::move(scope)) {}
+
+    const Inner& inner() const noexcept { return inner_; }
+    const std::shared_ptr<RequestScope>& scope() const noexcept { return scope_; }
+
+    template <typename Property>
+    auto query(const Property& p) const noexcept(noexcept(boost::asio::query(std::declval<const Inner&>(), p)))
+        -> decltype(boost::asio::query(std::declval<const Inner&>(), p)) {
+        return boost::asio::query(inner_, p);
+    }
+
+    template <typename Property>
+    auto require(const Property& p) const
+        -> RequestExecutor<std::decay_t<decltype(boost::asio::require(std::declval<const Inner&>(), p))>> {
+        return {boost::asio::require(inner_, p), scope_};
+    }
+
+    template <typename Property>
+    auto prefer(const Property& p) const
+        -> RequestExecutor<std::decay_t<decltype(boost::asio::prefer(std::declval<const Inner&>(), p))>> {
+        return {boost::asio::prefer(inner_, p), scope_};
+    }
+
+    template <typename Function>
+    void execute(Function&& f) const {
+        inner_.execute(Scoped<std::decay_t<Function>>{std::forward<Function>(f), scope_});
+    }
+
+    friend bool operator==(const RequestExecutor& a, const RequestExecutor& b) noexcept {
+        return a.inner_ == b.inner_ && a.scope_ == b.scope_;
+    }
+    friend bool operator!=(const RequestExecutor& a, const RequestExecutor& b) noexcept { return !(a == b); }
+
+private:
+    template <typename Function>
+    struct Scoped {
+        Function f;
+        std::shared_ptr<RequestScope> scope;
+
+        void operator()() {
+            RequestScope::Enter enter(scope.get());
+            std::move(f)();
+        }
+    };
+
+    Inner inner_;
+    std::shared_ptr<RequestScope> scope_;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_REQUEST_SCOPE_H
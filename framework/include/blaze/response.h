@@ -3,21 +3,75 @@
 
 #include <string>
 #include <string_view>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <optional>
+#include <utility>
+#include <vector>
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <boost/beast/http/fields.hpp>
 #include <boost/beast/http/status.hpp>
 #include <boost/json.hpp>
+#include <boost/asio/awaitable.hpp>
 #include <blaze/json.h>
 
 namespace blaze {
 
+/**
+ * @brief Destination of a streamed response body, provided by the transport.
+ *
+ * write() completes once the connection has taken the chunk, so a producer that
+ * outruns a slow client waits instead of piling data up in memory. It throws once
+ * the client has gone away, which ends the producer.
+ */
+class ResponseWriter {
+public:
+    virtual ~ResponseWriter() = default;
+    virtual boost::asio::awaitable<void> write(std::string_view chunk) = 0;
+};
+
+/**
+ * @brief Server-sent events (text/event-stream) over a ResponseWriter.
+ */
+class SseWriter {
+public:
+    explicit SseWriter(ResponseWriter& out) : out_(out) {}
+
+    /** @brief Sends one event. Multi-line data is split into several `data:` lines. */
+    boost::asio::awaitable<void> send(std::string_view data, std::string_view event = {}, std::string_view id = {});
+
+    /** @brief Sends a comment line, which clients ignore; use it as a keep-alive. */
+    boost::asio::awaitable<void> comment(std::string_view text = {});
+
+    /** @brief Tells the client how long to wait before reconnecting. */
+    boost::asio::awaitable<void> retry(std::chrono::milliseconds delay);
+
+private:
+    ResponseWriter& out_;
+    std::string buffer_;
+};
+
+using StreamProducer = std::function<boost::asio::awaitable<void>(ResponseWriter&)>;
+
+/**
+ * @brief One byte range of a file response, sent after `prefix`.
+ * Used for 206 responses; a multipart/byteranges body puts each part's headers in `prefix`.
+ */
+struct FilePart {
+    std::string prefix;
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
 class Response {
 private:
     boost::beast::http::response<boost::beast::http::string_body> res_;
     std::optional<std::string> file_path_;
+    std::vector<FilePart> file_parts_;
+    std::string file_trailer_;
+    StreamProducer stream_;
 
 public:
     Response();
@@ -35,6 +89,21 @@ public:
 
     Response& send(const std::string& text);
     Response& file(const std::string& path);
+
+    /** @brief Sends only `parts` of the file, followed by `trailer`; the handler sets status and headers. */
+    Response& file(const std::string& path, std::vector<FilePart> parts, std::string trailer = {});
+
+    /**
+     * @brief Streams the body from `producer` instead of sending a complete one.
+     *
+     * The producer runs after the handler and its middleware have returned, once the
+     * connection gets to this response, so it must own (capture by value) whatever it
+     * uses. HTTP/1.1 sends it with Transfer-Encoding: chunked; HTTP/2 as DATA frames.
+     */
+    Response& stream(StreamProducer producer);
+
+    /** @brief Streams server-sent events; sets Content-Type: text/event-stream and Cache-Control: no-cache. */
+    Response& sse(std::function<boost::asio::awaitable<void>(SseWriter&)> producer);
     
     // Boost.JSON overload
     Response& json(const boost::json::value& data);
@@ -58,7 +127,12 @@ public:
     int get_status() const;
 
     bool is_file() const { return file_path_.has_value(); }
+    bool is_stream() const { return static_cast<bool>(stream_); }
+    const StreamProducer& get_stream() const { return stream_; }
     const std::string& get_file_path() const { return *file_path_; }
+    /** @brief Empty for a whole-file response. */
+    const std::vector<FilePart>& get_file_parts() const { return file_parts_; }
+    const std::string& get_file_trailer() const { return file_trailer_; }
     const boost::beast::http::response<boost::beast::http::string_body>& get_beast_response() const { return res_; }
     boost::beast::http::response<boost::beast::http::string_body>& get_beast_response() { return res_; }
 
@@ -76,6 +150,33 @@ public:
 
 };
 
+/**
+ * @brief A constant response registered with App::get_static().
+ *
+ * Serialized once at registration; HTTP/1.1 sessions then write the prebuilt head,
+ * the shared Date/Server block, the Connection header and the body in one gather
+ * write, without routing, middleware or a Response object.
+ */
+class StaticResponse {
+public:
+    using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+    StaticResponse(int status, std::string body, HeaderList headers);
+
+    /** @brief Fills a regular Response with the same status, headers and body. */
+    void apply(Response& res) const;
+
+    /** @brief Status line, the registered headers and Content-Length, each ending in CRLF. */
+    const std::string& head() const { return head_; }
+    const std::string& body() const { return body_; }
+
+private:
+    int status_;
+    std::string body_;
+    HeaderList headers_;
+    std::string head_;
+};
+
 } // namespace blaze
 
 #endif
@@ -3,7 +3,11 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <span>
 #include <functional>
+#include <initializer_list>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <blaze/request.h>
@@ -20,12 +24,84 @@ using Next = std::function<Async<void>()>;
 using Middleware = std::function<Async<void>(Request&, Response&, Next)>;
 using Handler = std::function<Async<void>(Request&, Response&)>;
 
+/**
+ * @brief A fixed middleware chain, built once and shared by every request that runs it.
+ *
+ * run() walks the layers by index. The Next handed to each layer is a 16-byte, trivially
+ * copyable cursor that std::function stores inline, so beyond the middleware's own
+ * coroutine frames a request allocates nothing per layer. Copying a pipeline shares its
+ * middleware objects (and any state they hold) rather than duplicating them.
+ */
+class Pipeline {
+public:
+    Pipeline() = default;
+    Pipeline(std::initializer_list<Middleware> layers) {
+        for (const auto& layer : layers) add(layer);
+    }
+
+    void add(Middleware layer) { layers_.push_back(std::make_shared<const Middleware>(std::move(layer))); }
+
+    /** @brief Appends the layers of `other`, after this pipeline's own. */
+    void append(const Pipeline& other) { layers_.insert(layers_.end(), other.layers_.begin(), other.layers_.end()); }
+
+    size_t size() const { return layers_.size(); }
+    bool empty() const { return layers_.empty(); }
+
+    /** @brief Runs each layer in order and then `handler`; a layer that doesn't call next() ends the chain. */
+    Async<void> run(Request& req, Response& res, const Handler& handler) const;
+
+private:
+    static Async<void> run_layers(const Pipeline& pipeline, Request& req, Response& res, const Handler& handler);
+
+    std::vector<std::shared_ptr<const Middleware>> layers_;
+};
+
 struct RouteMatch {
     Handler handler;                                      // The function to call
     std::unordered_map<std::string, std::string> params;  // Extracted params like {"id": "42"}
     std::vector<std::string> path_values;                 // Ordered param values like ["42"]
 };
 
+/** @brief Maximum number of ':param' segments a single route may declare. */
+inline constexpr size_t kMaxRouteParams = 16;
+
+/** @brief A captured path parameter. The value is the raw (still URL-encoded) segment. */
+struct RouteParam {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @brief Non-owning result of Router::find().
+ *
+ * Points into the router's tables and the request path, so it performs no allocations.
+ * Valid while the router is not modified and the path buffer is alive.
+ */
+class RouteView {
+public:
+    const Handler* handler = nullptr;
+    const Pipeline* pipeline = nullptr; // Global, group and route middleware, in that order
+    bool stream_body = false;           // Body is read by the handler, not buffered up front
+    std::string_view pattern;           // The route as registered, e.g. "/users/:id"
+
+    explicit operator bool() const { return handler != nullptr; }
+
+    std::span<const RouteParam> params() const { return {params_.data(), count_}; }
+
+    /** @brief Returns the raw value of a named parameter, or an empty view. */
+    std::string_view param(std::string_view name) const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (params_[i].name == name) return params_[i].value;
+        }
+        return {};
+    }
+
+private:
+    friend class Router;
+    std::array<RouteParam, kMaxRouteParams> params_{};
+    size_t count_ = 0;
+};
+
 class Router;
 
 /**
@@ -35,21 +111,32 @@ class RouteGroup {
 private:
     Router& router_;
     std::string prefix_;
+    Pipeline middleware_;
 
 public:
-    RouteGroup(Router& router, const std::string& prefix);
+    RouteGroup(Router& router, const std::string& prefix, Pipeline middleware = {});
+
+    /**
+     * @brief Adds middleware that runs (after global middleware) for routes registered
+     * on this group, and on groups nested in it, from now on.
+     */
+    RouteGroup& use(const Middleware& mw);
 
     /** @brief Registers a GET route within this group. */
     void get(const std::string& path, const Handler &handler) const;
+    void get(const std::string& path, const Pipeline& middleware, const Handler &handler) const;
     
     /** @brief Registers a POST route within this group. */
     void post(const std::string& path, const Handler &handler) const;
+    void post(const std::string& path, const Pipeline& middleware, const Handler &handler) const;
     
     /** @brief Registers a PUT route within this group. */
     void put(const std::string& path, const Handler &handler) const;
+    void put(const std::string& path, const Pipeline& middleware, const Handler &handler) const;
     
     /** @brief Registers a DELETE route within this group. */
     void del(const std::string& path, const Handler &handler) const;
+    void del(const std::string& path, const Pipeline& middleware, const Handler &handler) const;
 
     /**
      * @brief Creates a nested route group.
@@ -57,6 +144,9 @@ public:
      * @param subpath The prefix to append to the current group's prefix.
      */
     RouteGroup group(const std::string& subpath) const;
+
+private:
+    void add(const std::string& method, const std::string& path, const Pipeline& middleware, const Handler& handler) const;
 };
 
 class Router {
@@ -66,25 +156,74 @@ private:
         std::string method;
         std::string path;
         std::vector<std::string> segments;
+        std::vector<std::string> param_names;
         Handler handler;
+        Pipeline middleware;        // Group and route middleware
+        bool stream_body = false;   // Registered with App::post_stream()/put_stream()
+        mutable Pipeline pipeline;  // Global + middleware, built by build_tables()
+    };
+
+    // One node of a compressed (radix) tree over path segments. Runs of static
+    // segments are merged into a single edge; ':param' segments get their own node.
+    struct Node {
+        std::vector<std::string> label;   // Static segments consumed on entry (empty for param nodes)
+        std::vector<uint32_t> children;   // Static children, sorted by label[0]
+        uint32_t param_child = npos;
+        int32_t route = -1;               // Index into routes_ if a route ends here
     };
 
+    struct Tree {
+        std::vector<Node> nodes;
+    };
+
+    static constexpr uint32_t npos = static_cast<uint32_t>(-1);
+
+    // Common verbs get a fixed slot so dispatch is a switch, not a string compare per route
+    static constexpr size_t kMethodSlots = 7;
+
     std::vector<Route> routes_;
     std::vector<openapi::RouteDoc> docs_;
+    Pipeline global_;
+    size_t streaming_routes_ = 0;
+
+    mutable std::array<Tree, kMethodSlots> trees_;
+    mutable std::vector<std::pair<std::string, Tree>> custom_trees_;
+    mutable bool compiled_ = false;
 
-    static bool matches(const std::vector<std::string>& route_segments,
-                        const std::vector<std::string_view>& request_segments,
-                        std::unordered_map<std::string, std::string>& params,
-                        std::vector<std::string>& path_values);
+    static int method_slot(std::string_view method);
+    const Tree* tree_for(std::string_view method) const;
 
-    static std::vector<std::string> split(const std::string& str);
-    static std::vector<std::string_view> split_view(std::string_view str);
+    void build_tables() const;
+    void insert(Tree& tree, uint32_t route_index) const;
+    bool walk(const Tree& tree, uint32_t node, std::string_view path, size_t pos, RouteView& out) const;
 
 public:
-    void add_route(const std::string& method, const std::string& path, const Handler &handler);
+    void add_route(const std::string& method, const std::string& path, const Handler &handler,
+                   Pipeline middleware = {}, bool stream_body = false);
+
+    /** @brief True if any route streams its body; the server then reads headers before bodies. */
+    bool streams_bodies() const { return streaming_routes_ > 0; }
+
+    /** @brief Adds global middleware, run for every request including unmatched ones. */
+    void use(const Middleware& mw) { global_.add(mw); compiled_ = false; }
+
+    /** @brief The global middleware; what an unmatched request runs before the 404 handler. */
+    const Pipeline& middleware() const { return global_; }
     void add_doc(openapi::RouteDoc doc) { docs_.push_back(std::move(doc)); }
     const std::vector<openapi::RouteDoc>& docs() const { return docs_; }
 
+    /**
+     * @brief Builds the per-method radix trees and each route's full middleware pipeline.
+     * Called by App::listen(); standalone routers compile lazily on first lookup.
+     */
+    void compile() { build_tables(); }
+
+    /**
+     * @brief Allocation-free lookup. Static segments take priority over ':param' segments.
+     */
+    [[nodiscard]] RouteView find(std::string_view method, std::string_view path) const;
+
+    /** @brief Owning lookup with URL-decoded parameters (convenience wrapper over find()). */
     [[nodiscard]] std::optional<RouteMatch> match(std::string_view method, std::string_view path) const;
 };
 
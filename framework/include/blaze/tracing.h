@@ -0,0 +1,224 @@
+#ifndef BLAZE_TRACING_H
+#define BLAZE_TRACING_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace blaze {
+
+using TraceId = std::array<uint8_t, 16>;
+using SpanId = uint64_t;
+
+/** @brief The fields of a W3C `traceparent` header. */
+struct SpanContext {
+    TraceId trace_id{};
+    SpanId span_id = 0;
+    uint8_t flags = 0;     // Bit 0: sampled
+
+    bool valid() const { return span_id != 0 && trace_id != TraceId{}; }
+    bool sampled() const { return flags & 0x01; }
+};
+
+/** @brief Parses a `traceparent` header; nullopt if it is malformed or all-zero. */
+std::optional<SpanContext> parse_traceparent(std::string_view header);
+
+/** @brief Formats `00-<trace id>-<span id>-<flags>`. */
+std::string format_traceparent(const SpanContext& context);
+
+// Values match the OTLP SpanKind enum
+enum class SpanKind {
+    INTERNAL = 1,
+    SERVER = 2,
+    CLIENT = 3
+};
+
+using SpanAttribute = std::pair<std::string, std::variant<std::string, int64_t>>;
+
+/** @brief A finished span, as handed to the exporter. */
+struct SpanData {
+    TraceId trace_id{};
+    SpanId span_id = 0;
+    SpanId parent_id = 0;      // 0 for a root span without a remote parent
+    std::string name;
+    SpanKind kind = SpanKind::INTERNAL;
+    int64_t start_ns = 0;      // Unix time, nanoseconds
+    int64_t end_ns = 0;
+    bool error = false;
+    std::string status_message;
+    std::vector<SpanAttribute> attributes;
+};
+
+/**
+ * @brief The spans of one request.
+ *
+ * Started by RequestScope::open() for sampled requests and reachable as `req.trace()`. Spans
+ * nest by time: a span started while another is open becomes its child.
+ *
+ * Framework code that can't see the Request (database pools, fetch()) finds the trace
+ * through Trace::current(), which reads the RequestScope the request's executor makes
+ * current around each resumption; it holds after any await, not just the framework's own.
+ */
+class Trace {
+public:
+    explicit Trace(const SpanContext& parent);
+
+    const TraceId& trace_id() const { return trace_id_; }
+
+    /** @brief The innermost open span, for propagating to outbound calls. */
+    SpanContext context() const;
+
+    /** @brief The trace of the request running on this thread, or null. */
+    static const std::shared_ptr<Trace>& current();
+
+private:
+    friend class Span;
+    friend class Tracer;
+
+    TraceId trace_id_;
+    SpanId remote_parent_;
+    uint8_t flags_;
+
+    mutable std::mutex mutex_;
+    SpanId active_ = 0;            // Innermost open span
+    bool finished_ = false;        // Spans ending later are discarded
+    std::vector<SpanData> spans_;
+};
+
+/**
+ * @brief RAII span. A span built from a null trace does nothing, so call sites need no
+ * check of their own; set_attribute() only copies its arguments on an active span.
+ */
+class Span {
+public:
+    Span() = default;
+    Span(std::shared_ptr<Trace> trace, std::string_view name, SpanKind kind = SpanKind::INTERNAL);
+    ~Span() { end(); }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    explicit operator bool() const { return trace_ != nullptr; }
+
+    void set_name(std::string_view name);
+    void set_attribute(std::string_view key, std::string_view value);
+    void set_attribute(std::string_view key, int64_t value);
+    void set_error(std::string_view message = {});
+
+    /** @brief This span as a `traceparent` value, for outbound requests. */
+    std::string traceparent() const;
+
+    /** @brief Records the span. Idempotent. */
+    void end();
+
+private:
+    std::shared_ptr<Trace> trace_;
+    SpanData data_;
+};
+
+/**
+ * @brief Receives finished spans encoded as an OTLP/JSON ExportTraceServiceRequest.
+ * Called from the tracer's export thread only.
+ */
+class SpanExporter {
+public:
+    virtual ~SpanExporter() = default;
+    virtual bool export_json(const std::string& body) = 0;
+};
+
+/**
+ * @brief POSTs each batch to an OTLP/HTTP collector, e.g. http://127.0.0.1:4318/v1/traces.
+ * Plain http only; run a local collector or agent and let it handle TLS upstream.
+ */
+class OtlpHttpExporter : public SpanExporter {
+public:
+    explicit OtlpHttpExporter(std::string endpoint, std::chrono::milliseconds timeout = std::chrono::seconds(2));
+    bool export_json(const std::string& body) override;
+
+private:
+    std::string host_;
+    std::string port_;
+    std::string path_;
+    std::chrono::milliseconds timeout_;
+};
+
+struct TracingOptions {
+    std::string endpoint = "http://127.0.0.1:4318/v1/traces"; // OTLP/HTTP collector
+    std::string service_name = "blaze";
+    double sample_ratio = 1.0;                                // For requests without a sampled parent
+    size_t max_queued_spans = 8192;                           // Beyond this, finished spans are dropped
+    std::chrono::milliseconds export_interval{1000};
+};
+
+/** @brief Encodes spans as an OTLP/JSON ExportTraceServiceRequest. */
+std::string encode_otlp_json(const std::vector<SpanData>& spans, std::string_view service_name);
+
+/**
+ * @brief Starts traces, collects finished ones and exports them in the background.
+ *
+ * Disabled until configure() is called. Requests whose `traceparent` is sampled are
+ * always traced; the rest are sampled by `sample_ratio`. Export runs on its own thread
+ * every `export_interval`, so a slow or missing collector never delays a request.
+ */
+class Tracer {
+public:
+    static Tracer& instance();
+    ~Tracer();
+
+    /** @brief Enables tracing. Without an exporter, spans are sent to `options.endpoint`. */
+    void configure(TracingOptions options, std::unique_ptr<SpanExporter> exporter = nullptr);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /** @brief A new trace continuing `traceparent` (may be empty), or null if not sampled. */
+    std::shared_ptr<Trace> start_trace(std::string_view traceparent);
+
+    /** @brief Queues the trace's spans for export; later spans are discarded. */
+    void finish(const std::shared_ptr<Trace>& trace);
+
+    /** @brief Exports everything queued so far before returning. */
+    void flush();
+
+    /** @brief Spans dropped because the export queue was full. */
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /** @brief Exports what is queued and turns tracing off until the next configure(). */
+    void shutdown();
+
+private:
+    Tracer() = default;
+
+    void export_queued(bool report);
+    void run();
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint64_t> sample_threshold_{0}; // Out of 2^32
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex queue_mutex_;
+    std::vector<SpanData> queue_;
+    TracingOptions options_;
+
+    std::mutex export_mutex_;                   // One export at a time; guards exporter_
+    std::unique_ptr<SpanExporter> exporter_;
+    bool export_failing_ = false;
+
+    std::mutex worker_mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_TRACING_H
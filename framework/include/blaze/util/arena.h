@@ -0,0 +1,58 @@
+#ifndef BLAZE_UTIL_ARENA_H
+#define BLAZE_UTIL_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace blaze {
+
+/**
+ * @brief Bump allocator for request-scoped data, owned by a single connection.
+ *
+ * Allocations are carved out of one contiguous block and individual frees are no-ops;
+ * everything is released at once by reset(). Requests that overflow the block spill to
+ * the heap, and the next reset() grows the block to the observed high-water mark, so a
+ * warmed-up keep-alive connection stops touching the global allocator. Not thread-safe.
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(std::size_t capacity = 8 * 1024);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Releases every allocation. Anything still pointing into the arena dangles.
+     */
+    void reset();
+
+    std::size_t capacity() const { return capacity_; }
+
+    /** @brief Bytes handed out since the last reset(), including spilled blocks. */
+    std::size_t used() const { return offset_ + spilled_; }
+
+private:
+    struct Spill {
+        Spill* next;
+        std::size_t align;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    void release_spills();
+
+    std::byte* block_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t offset_ = 0;
+    std::size_t spilled_ = 0;
+    Spill* spills_ = nullptr;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_UTIL_ARENA_H
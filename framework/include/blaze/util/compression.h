@@ -0,0 +1,115 @@
+#ifndef BLAZE_UTIL_COMPRESSION_H
+#define BLAZE_UTIL_COMPRESSION_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace blaze::util {
+
+/** @brief HTTP content codings Blaze can produce and decode. */
+enum class ContentCoding { identity, gzip, deflate, br };
+
+/** @brief The Content-Encoding token ("gzip", "deflate", "br"); empty for identity. */
+std::string_view coding_name(ContentCoding coding);
+
+/**
+ * @brief Parses a Content-Encoding value. "x-gzip" is read as gzip and an empty value as identity.
+ * @return std::nullopt for codings Blaze can't decode, including stacked ones ("gzip, br").
+ */
+std::optional<ContentCoding> parse_coding(std::string_view content_encoding);
+
+/**
+ * @brief Compresses `data` into a gzip member (RFC 1952).
+ * Uses Beast's deflate implementation, so it needs no extra library.
+ * @param level 1 (fastest) to 9 (smallest).
+ */
+std::string gzip_compress(std::string_view data, int level = 6);
+
+/** @brief True if Blaze was built with libbrotlienc. */
+bool brotli_available();
+
+/**
+ * @brief Compresses `data` with Brotli (RFC 7932).
+ * @param quality 0 (fastest) to 11 (smallest).
+ * @throws std::runtime_error if brotli_available() is false.
+ */
+std::string brotli_compress(std::string_view data, int quality = 9);
+
+/**
+ * @brief One-shot compression with `coding`, appended to `out`.
+ * gzip and deflate (zlib format, RFC 1950) reuse a per-thread deflate context, so
+ * repeated calls on a thread don't reallocate its window and hash tables.
+ * @param level 1-9 for gzip/deflate, 0-11 for brotli.
+ */
+void compress(ContentCoding coding, std::string_view data, int level, std::string& out);
+
+/**
+ * @brief Incremental compressor for bodies that arrive in pieces.
+ */
+class StreamCompressor {
+public:
+    StreamCompressor(ContentCoding coding, int level);
+    ~StreamCompressor();
+    StreamCompressor(const StreamCompressor&) = delete;
+    StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+    /**
+     * @brief Compresses `data`, appending whatever output is ready to `out`.
+     * @param flush Also emit everything buffered so far, so the peer can decode it now
+     *        (costs some ratio; use it for event streams, not bulk data).
+     */
+    void write(std::string_view data, std::string& out, bool flush = false);
+
+    /** @brief Ends the stream (trailer included). */
+    void finish(std::string& out);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Incremental decoder for compressed request bodies.
+ *
+ * Output is appended as input arrives, so the compressed copy is never held whole.
+ * gzip accepts concatenated members; deflate accepts the zlib format and, as some
+ * clients send it, a bare deflate stream. Checksums are verified.
+ */
+class StreamDecompressor {
+public:
+    explicit StreamDecompressor(ContentCoding coding);
+    ~StreamDecompressor();
+    StreamDecompressor(const StreamDecompressor&) = delete;
+    StreamDecompressor& operator=(const StreamDecompressor&) = delete;
+
+    /**
+     * @brief Decodes `data`, appending the output to `out`.
+     * @param limit Largest size `out` may reach; the guard against decompression bombs.
+     * @throws std::length_error once `out` would grow past `limit`.
+     * @throws std::runtime_error on malformed input.
+     */
+    void write(std::string_view data, std::string& out, std::size_t limit);
+
+    /** @brief Checks the input ended with a complete stream. @throws std::runtime_error if truncated. */
+    void finish();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Checks whether an Accept-Encoding value allows `coding` (e.g. "gzip").
+ * Honors "*" and treats q=0 as a refusal.
+ */
+bool accepts_encoding(std::string_view accept_encoding, std::string_view coding);
+
+/** @brief True for MIME types that are worth compressing (text, JSON, JS, SVG, ...). */
+bool is_compressible(std::string_view content_type);
+
+} // namespace blaze::util
+
+#endif // BLAZE_UTIL_COMPRESSION_H
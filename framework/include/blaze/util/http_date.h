@@ -0,0 +1,74 @@
+#ifndef BLAZE_UTIL_HTTP_DATE_H
+#define BLAZE_UTIL_HTTP_DATE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace blaze {
+
+/**
+ * @brief Formatting for HTTP Date values.
+ */
+struct HttpDate {
+    /** @brief Length of an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT". */
+    static constexpr std::size_t kLength = 29;
+
+    /** @brief Formats `t` as an IMF-fixdate (RFC 9110, 5.6.7) into `out[0, kLength)`. */
+    static void format(std::time_t t, char* out);
+
+    /** @brief Parses an IMF-fixdate; nullopt for anything else (obsolete formats included). */
+    static std::optional<std::time_t> parse(std::string_view text);
+};
+
+/**
+ * @brief The pre-formatted "Date: ...\r\nServer: ...\r\n" lines shared by every response.
+ *
+ * One thread calls refresh() (the App runs it from a one-second timer) while any number
+ * of threads append the block to outgoing headers. The date sits behind a seqlock:
+ * refresh() makes the sequence odd while it stores the new date, and a reader copies the
+ * date and tries again if the sequence was odd or moved meanwhile. Readers never see a
+ * half-written date, never block the writer and never format or allocate anything.
+ */
+class HeaderBlock {
+public:
+    using DateText = std::array<char, HttpDate::kLength>;
+
+    explicit HeaderBlock(std::string_view server_name = "Blaze/1.0");
+
+    /** @brief Changes the Server value. Not thread-safe; call before serving. */
+    void set_server(std::string_view server_name);
+
+    /** @brief Re-formats the date if the second has changed. */
+    void refresh();
+
+    /** @brief Appends the Date and/or Server lines, each ending in CRLF. */
+    void append_to(std::string& out, bool date = true, bool server = true) const;
+
+    /** @brief A copy of the current Date value. */
+    DateText date() const;
+
+    const std::string& server() const { return server_; }
+
+private:
+    static constexpr std::size_t kDateAt = 6;  // After "Date: "
+    static constexpr std::size_t kDateLine = kDateAt + HttpDate::kLength + 2;
+    static constexpr std::size_t kDateWords = (HttpDate::kLength + 7) / 8;
+
+    void store_date(std::time_t t);
+
+    std::string server_;
+    std::string server_line_;                                  // "Server: ...\r\n"
+    std::array<std::atomic<std::uint64_t>, kDateWords> date_{}; // The formatted date, zero-padded
+    std::atomic<std::uint64_t> sequence_{0};                   // Odd while store_date() is writing
+    std::time_t formatted_ = 0;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_UTIL_HTTP_DATE_H
@@ -0,0 +1,78 @@
+#ifndef BLAZE_UTIL_JWT_CACHE_H
+#define BLAZE_UTIL_JWT_CACHE_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <blaze/json.h>
+
+namespace blaze {
+
+/**
+ * @brief Bounded cache of verified JWT claims, so a token reused across requests is
+ * only verified once.
+ *
+ * Entries are keyed by the token's signature segment and store the signed part next to
+ * the claims; a hit needs both to match, so a forged payload under a known signature
+ * misses. An entry whose `exp` has passed is never returned. Claims are shared, not
+ * copied, on a hit.
+ *
+ * Keys are spread over shards, each holding at most capacity / shards entries. A lookup
+ * takes its shard's shared lock. A full shard drops expired entries first, then an
+ * arbitrary one.
+ *
+ * Cache only tokens verified against a single secret; the secret is not part of the key.
+ */
+class JwtCache {
+public:
+    /**
+     * @param capacity Total entries kept across all shards.
+     * @param shards Rounded up to a power of two; 0 picks one from the hardware thread count.
+     */
+    explicit JwtCache(size_t capacity = 10000, size_t shards = 0);
+    ~JwtCache();
+    JwtCache(const JwtCache&) = delete;
+    JwtCache& operator=(const JwtCache&) = delete;
+
+    /** @brief Claims of a previously verified `token`, unless it has expired by `now`. */
+    std::optional<Json> find(std::string_view token, std::time_t now = std::time(nullptr)) const;
+
+    /** @brief Remembers `claims` for a token that has just passed verification. */
+    void insert(std::string_view token, Json claims);
+
+    /** @brief Entries currently held. Takes every shard lock; meant for tests and diagnostics. */
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string signed_part; // "<header>.<payload>"
+        Json claims;
+        int64_t exp; // 0 when the token has no exp claim
+    };
+
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, Entry, Hash, std::equal_to<>> entries;
+    };
+
+    Shard& shard_for(std::string_view signature) const;
+
+    size_t per_shard_;
+    size_t mask_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_UTIL_JWT_CACHE_H
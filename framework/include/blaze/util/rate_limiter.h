@@ -0,0 +1,96 @@
+#ifndef BLAZE_UTIL_RATE_LIMITER_H
+#define BLAZE_UTIL_RATE_LIMITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace blaze {
+
+/**
+ * @brief Per-key request limiter using GCRA (the generic cell rate algorithm).
+ *
+ * Each key stores one timestamp, its theoretical arrival time (TAT). A request is
+ * allowed when TAT - now stays within the window; admitting it advances TAT by
+ * window / limit. That behaves like a sliding window that allows up to `limit`
+ * requests in a burst and then refills smoothly.
+ *
+ * Keys are spread over shards. A known key is updated under its shard's shared lock
+ * with one compare-and-swap, so requests only serialize when they insert a new key.
+ * A key whose TAT has passed is in the same state as a key never seen, so idle keys
+ * are dropped without changing any decision. Each shard sweeps them at most once
+ * per window, on the insert path.
+ */
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Decision {
+        bool allowed;
+        int remaining;                          // Requests still allowed right now
+        std::chrono::milliseconds retry_after;  // Wait before the next request is allowed; 0 if allowed
+    };
+
+    /**
+     * @param limit Requests allowed per window (and the largest burst).
+     * @param shards Rounded up to a power of two; 0 picks one from the hardware thread count.
+     */
+    RateLimiter(int limit, std::chrono::nanoseconds window, size_t shards = 0);
+    ~RateLimiter();
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /** @brief Counts one request against `key`. */
+    Decision acquire(std::string_view key, Clock::time_point now = Clock::now());
+
+    /** @brief Keys currently tracked. Takes every shard lock; meant for tests and diagnostics. */
+    size_t size() const;
+
+    int limit() const { return limit_; }
+
+private:
+    // A key with its hash, which picks the shard and is reused for the map lookup
+    struct Probe {
+        std::string_view key;
+        size_t hash;
+    };
+
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+        size_t operator()(const Probe& probe) const { return probe.hash; }
+    };
+
+    struct Equal {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+        bool operator()(const Probe& a, std::string_view b) const { return a.key == b; }
+        bool operator()(std::string_view a, const Probe& b) const { return a == b.key; }
+    };
+
+    // Aligned so neighbouring shards' locks don't share a cache line
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::atomic<int64_t>, Hash, Equal> clients;
+        int64_t next_sweep = 0;
+    };
+
+    Decision update(std::atomic<int64_t>& tat, int64_t now) const;
+    void sweep(Shard& shard, int64_t now);
+
+    int limit_;
+    int64_t window_ns_;
+    int64_t interval_ns_; // window / limit: how far each request moves TAT
+    size_t mask_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_UTIL_RATE_LIMITER_H
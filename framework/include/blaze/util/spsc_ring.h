@@ -0,0 +1,75 @@
+#ifndef BLAZE_UTIL_SPSC_RING_H
+#define BLAZE_UTIL_SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <type_traits>
+
+namespace blaze {
+
+/**
+ * @brief Fixed-capacity ring buffer for one producer thread and one consumer thread.
+ *
+ * Neither side locks or allocates. The producer fills a slot in place and publishes it
+ * with one release store; the consumer reads a run of slots and frees them all with one
+ * store. Each side caches the other's index, so it only touches the other's cache line
+ * when the ring looks full (producer) or holds fewer records than asked for (consumer).
+ */
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(std::has_single_bit(Capacity), "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing holds plain records");
+
+public:
+    static constexpr std::size_t kCapacity = Capacity;
+
+    /**
+     * @brief Producer side: calls fill(T&) on a free slot and publishes it.
+     * @return false, without calling fill, if the ring is full.
+     */
+    template <typename Fill>
+    bool try_push(Fill&& fill) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == Capacity) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == Capacity) return false;
+        }
+        fill(slots_[tail & (Capacity - 1)]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side: calls visit(const T&) on up to `max` records in order, then frees them.
+     * @return Records consumed.
+     */
+    template <typename Visit>
+    std::size_t consume(Visit&& visit, std::size_t max = Capacity) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (tail_cache_ - head < max) tail_cache_ = tail_.load(std::memory_order_acquire);
+        std::size_t count = tail_cache_ - head;
+        if (count > max) count = max;
+        for (std::size_t i = 0; i < count; ++i) visit(slots_[(head + i) & (Capacity - 1)]);
+        if (count) head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /** @brief Records waiting; exact only when called from one of the two sides while the other is idle. */
+    std::size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Producer and consumer state on separate cache lines
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+    alignas(64) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    alignas(64) std::array<T, Capacity> slots_;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_UTIL_SPSC_RING_H
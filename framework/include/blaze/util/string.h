@@ -3,6 +3,7 @@
 
 #include <string>
 #include <string_view>
+#include <memory_resource>
 #include <type_traits>
 #include <charconv>
 #include <blaze/exceptions.h>
@@ -15,11 +16,21 @@ namespace blaze::util {
  */
 std::string url_decode(std::string_view str);
 
+/**
+ * @brief Same as url_decode(), but the result is allocated from the given memory resource.
+ */
+std::pmr::string url_decode(std::string_view str, std::pmr::memory_resource* mr);
+
 /**
  * @brief Converts a binary string or buffer to a hex-encoded string.
  */
 std::string hex_encode(std::string_view input);
 
+/**
+ * @brief Appends `value` to `out` as a quoted JSON string, escaping quotes, backslashes and control characters.
+ */
+void append_json_string(std::string& out, std::string_view value);
+
 /**
  * @brief Converts CamelCase or PascalCase to snake_case.
  */
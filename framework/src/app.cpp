@@ -1,17 +1,55 @@
 #include <blaze/app.h>
 #include <blaze/exceptions.h>
+#include <blaze/flight_recorder.h>
+#include <blaze/metrics.h>
+#include <blaze/request_scope.h>
+#include <blaze/tracing.h>
+#include <blaze/util/string.h>
+#include <charconv>
 #include <chrono>
 #include <memory>
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 #include "server.h"
 
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
 namespace blaze {
 
+namespace {
+    // Binds the calling thread to one CPU, wrapping around when there are more shards than CPUs
+    void pin_to_cpu(size_t index) {
+#ifdef __linux__
+        const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            Logger::instance().log_error("Could not pin shard " + std::to_string(index) + " to a CPU");
+        }
+#else
+        (void)index;
+#endif
+    }
+
+    // Declared Content-Length, or `fallback` (the buffered body size) when there is none
+    uint64_t content_length(std::string_view header, size_t fallback) {
+        uint64_t length = 0;
+        const auto [end, ec] = std::from_chars(header.data(), header.data() + header.size(), length);
+        return ec == std::errc() && end == header.data() + header.size() ? length : fallback;
+    }
+}
+
 App::App() = default;
 
 App::~App() {
+    for (auto& shard : shards_) {
+        shard->stop();
+    }
     if(!ioc_.stopped()) {
         ioc_.stop();
     }
@@ -70,41 +108,67 @@ Router &App::get_router() {
     return router_;
 }
 
-boost::asio::awaitable<void> App::run_middleware(size_t index, Request& req, Response& res, const Handler& final_handler) {
-    if (index < middleware_.size()) {
-        const auto& mw = middleware_[index];
-        co_await mw(req, res, [this, index, &req, &res, &final_handler]() -> boost::asio::awaitable<void> {
-            co_await run_middleware(index + 1, req, res, final_handler);
-        });
-    } else {
-        co_await final_handler(req, res);
+boost::asio::awaitable<Response> App::handle_request(Request& req, const std::string& client_ip) {
+    // The server scopes its requests before spawning them; direct callers get theirs here.
+    // A scoped request runs on a RequestExecutor so its trace and profile stay current across awaits.
+    if (!req._scope_opened()) {
+        std::shared_ptr<RequestScope> scope;
+        RequestScope::open(req, scope);
+    }
+    if (req._scope() && RequestScope::current() != req._scope().get()) {
+        RequestScope* caller = RequestScope::current();
+        Response res = co_await boost::asio::co_spawn(
+            RequestExecutor(co_await boost::asio::this_coro::executor, req._scope()),
+            handle_request(req, client_ip), boost::asio::use_awaitable);
+        // We may resume inline from inside the request's scope; carry on in the caller's
+        RequestScope::make_current(caller);
+        co_return res;
     }
-}
 
-boost::asio::awaitable<Response> App::handle_request(Request& req, const std::string& client_ip, const bool keep_alive) {
     const auto start_time = std::chrono::steady_clock::now();
     Response res;
     int status_code = 500;
+    std::string_view route_pattern;
+
+    // Sampled requests have a trace; the server span is renamed once the route is known
+    Span server_span(req.trace(), req.method, SpanKind::SERVER);
+
+    // The server's profiles already hold the read time; the chain times the handler itself
+    RequestProfile* const profile = req.profile();
+    auto chain_start = start_time;
+    int64_t chain_db_before = 0;
 
     try {
-        req.set("client_ip", client_ip);
+        req.set_client_ip(client_ip);
         req._set_services(&services_);
-        const auto match = router_.match(req.method, req.path);
-        
-        Handler handler;
-        if (match.has_value()) {
-            req.params = match->params;
-            req.path_values = match->path_values;
-            handler = match->handler;
-        } else {
-            handler = [](Request&, Response& res) -> boost::asio::awaitable<void> {
-                res.status(404).send("404 Not Found\n");
-                co_return;
-            };
+        const RouteView route = router_.find(req.method, req.path);
+
+        static const Handler not_found = [](Request&, Response& res) -> boost::asio::awaitable<void> {
+            res.status(404).send("404 Not Found\n");
+            co_return;
+        };
+
+        const Handler* handler = &not_found;
+        const Pipeline* pipeline = &router_.middleware();
+        if (route) {
+            std::pmr::memory_resource* mr = req.params.get_allocator().resource();
+            req.path_values.reserve(route.params().size());
+            for (const auto& param : route.params()) {
+                auto& value = req.path_values.emplace_back(util::url_decode(param.value, mr));
+                req.params.insert_or_assign(std::pmr::string(param.name, mr), value);
+            }
+            handler = route.handler;
+            pipeline = route.pipeline;
+            route_pattern = route.pattern;
         }
 
-        // Run the chain
-        co_await run_middleware(0, req, res, handler);
+        if (profile) {
+            chain_start = std::chrono::steady_clock::now();
+            profile->add(Phase::ROUTE, std::chrono::duration_cast<std::chrono::microseconds>(chain_start - start_time));
+            profile->route = route_pattern;
+            chain_db_before = profile->db_us();
+        }
+        co_await pipeline->run(req, res, *handler);
 
         status_code = res.get_status();
 
@@ -123,22 +187,137 @@ boost::asio::awaitable<Response> App::handle_request(Request& req, const std::st
         Logger::instance().log_error(std::string("Exception in handle_request: ") + e.what());
     }
 
-    if (keep_alive) {
-        res.header("Connection", "keep-alive");
-    } else {
-        res.header("Connection", "close");
+    // Async Logger; sampled out requests skip building the entry entirely
+    const auto end_time = std::chrono::steady_clock::now();
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    if (server_span) {
+        if (!route_pattern.empty()) server_span.set_name(req.method + " " + std::string(route_pattern));
+        server_span.set_attribute("http.request.method", req.method);
+        server_span.set_attribute("url.path", req.path);
+        server_span.set_attribute("http.route", route_pattern);
+        server_span.set_attribute("client.address", client_ip);
+        server_span.set_attribute("http.response.status_code", static_cast<int64_t>(status_code));
+        if (status_code >= 500) server_span.set_error();
+        server_span.end();
+        Tracer::instance().finish(req.trace());
     }
+    if (profile) {
+        // The rest of the chain, building an error response included. Concurrent queries
+        // can add up to more than the chain's own time.
+        const int64_t chain_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - chain_start).count();
+        const int64_t middleware_us = chain_us - profile->get(Phase::HANDLER) - (profile->db_us() - chain_db_before);
+        profile->add(Phase::MIDDLEWARE, std::chrono::microseconds(std::max<int64_t>(middleware_us, 0)));
+    }
+    if (!config_.metrics_path.empty()) {
+        Metrics::instance().observe_request(req.method, route_pattern, status_code, duration);
+    }
+    Logger& logger = Logger::instance();
+    if (logger.sample_access(status_code, duration)) {
+        std::string user;
+        const std::string& claim = logger.access_log().user_claim;
+        if (!claim.empty() && req.is_authenticated() && req.user().has(claim)) {
+            user = req.user()[claim].as<std::string>();
+        }
 
-    res.header("Server", config_.server_name);
-
-    // Async Logger
-    const auto end_time = std::chrono::steady_clock::now();
-    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-    Logger::instance().log_access(client_ip, req.method, req.path, status_code, duration);
+        AccessLogEntry entry;
+        entry.client_ip = client_ip;
+        entry.method = req.method;
+        entry.path = req.path;
+        entry.route = route_pattern;
+        entry.user = user;
+        entry.status = status_code;
+        entry.duration = duration;
+        entry.bytes_in = content_length(req.get_header("Content-Length"), req.body.size());
+        entry.bytes_out = content_length(res.get_beast_response()[boost::beast::http::field::content_length],
+                                         res.get_beast_response().body().size());
+        logger.log_access(entry);
+    }
 
     co_return res;
 }
 
+void App::get_static(const std::string& path, std::string body, StaticResponse::HeaderList headers, const int status) {
+    auto [it, inserted] = static_routes_.try_emplace(path, status, std::move(body), std::move(headers));
+    if (!inserted) {
+        throw std::runtime_error("Static route already registered: " + path);
+    }
+
+    // Router fallback for protocols that bypass the HTTP/1.1 fast path; HEAD is answered there too
+    const StaticResponse* fixed = &it->second;
+    const auto serve = [fixed](Request&, Response& res) -> Async<void> {
+        fixed->apply(res);
+        co_return;
+    };
+    router_.add_route("GET", path, serve);
+    router_.add_route("HEAD", path, serve);
+}
+
+const StaticResponse* App::find_static(std::string_view target) const {
+    if (static_routes_.empty()) return nullptr;
+
+    target = target.substr(0, target.find('?'));
+    const auto it = static_routes_.find(target);
+    return it != static_routes_.end() ? &it->second : nullptr;
+}
+
+void App::_start_clock() {
+    // Ticks just after each second boundary so the Date header never lags
+    boost::asio::co_spawn(ioc_, [this]() -> Async<void> {
+        net::steady_timer timer(co_await boost::asio::this_coro::executor);
+        while (!stopping_) {
+            header_block_.refresh();
+            const auto now = std::chrono::system_clock::now();
+            const auto next = std::chrono::floor<std::chrono::seconds>(now) + std::chrono::seconds(1);
+            timer.expires_after(next - now + std::chrono::milliseconds(1));
+            co_await timer.async_wait(boost::asio::use_awaitable);
+        }
+    }, boost::asio::detached);
+}
+
+void App::_register_metrics() {
+    this->get(config_.metrics_path, [this](Response& res) -> Async<void> {
+        std::string body = Metrics::instance().render();
+
+        // Open WebSocket sessions per path, counted from the registry the broadcaster uses
+        Metrics::write_header(body, "blaze_websocket_sessions", "gauge", "Open WebSocket sessions.");
+        {
+            std::lock_guard<std::mutex> lock(ws_mtx_);
+            for (const auto& [path, sessions] : ws_sessions_) {
+                const auto open = std::count_if(sessions.begin(), sessions.end(),
+                                                [](const auto& weak) { return !weak.expired(); });
+                body += "blaze_websocket_sessions{";
+                Metrics::write_label(body, "path", path, true);
+                body += "} ";
+                body += std::to_string(open);
+                body += '\n';
+            }
+        }
+
+        res.header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+        res.send(body);
+        co_return;
+    });
+}
+
+void App::_register_recorder() {
+    const FlightRecorderOptions& options = FlightRecorder::instance().options();
+    if (options.path.empty()) return;
+    this->get(options.path, recorder_middleware_, [](Response& res) -> Async<void> {
+        res.header("Content-Type", "application/json");
+        res.send(FlightRecorder::instance().dump());
+        co_return;
+    });
+}
+
+void App::_wait_dump_signal() {
+    dump_signals_->async_wait([this](boost::system::error_code const& ec, int) {
+        if (ec) return;
+        Logger::instance().info("[Blaze] Flight recorder: " + FlightRecorder::instance().dump());
+        std::lock_guard<std::mutex> lock(lifecycle_mtx_);
+        if (!stopping_) _wait_dump_signal();
+    });
+}
+
 void App::_register_docs() {
     // Register Documentation Routes
     this->get("/openapi.json", [this]() -> Async<Json> {
@@ -217,6 +396,9 @@ void App::stop() {
         if (signals_) {
             signals_->cancel();
         }
+        if (dump_signals_) {
+            dump_signals_->cancel();
+        }
 
         // Close listeners
         for (auto& listener : listeners_) {
@@ -258,6 +440,15 @@ void App::listen(const int port, int num_threads) {
     if (config_.enable_docs) {
         _register_docs();
     }
+    if (!config_.metrics_path.empty()) {
+        _register_metrics();
+    }
+    if (FlightRecorder::instance().enabled()) {
+        _register_recorder();
+    }
+    router_.compile();
+    header_block_.set_server(config_.server_name);
+    _start_clock();
 
     if (num_threads <= 0) {
         num_threads = config_.num_threads;
@@ -268,17 +459,26 @@ void App::listen(const int port, int num_threads) {
         if (num_threads == 0) num_threads = 4;
     }
 
+#ifndef BLAZE_HAS_HTTP2
+    if (config_.h2c) {
+        throw std::runtime_error("h2c requires Blaze to be built with libnghttp2");
+    }
+#endif
+
     auto const address = net::ip::make_address("0.0.0.0");
     auto const endpoint = net::ip::tcp::endpoint{address, static_cast<unsigned short>(port)};
 
     try {
-        // Create and launch listening port
-        auto listener = std::make_shared<Listener>(ioc_, endpoint, *this);
-        {
-            std::lock_guard<std::mutex> lock(lifecycle_mtx_);
-            listeners_.push_back(listener);
+        // Create and launch listening port (one SO_REUSEPORT acceptor per shard when sharded)
+        _open_shards(num_threads);
+        for (size_t i = 0; i <= shards_.size(); ++i) {
+            auto listener = std::make_shared<Listener>(_shard(i), endpoint, *this, config_.shard_per_core);
+            {
+                std::lock_guard<std::mutex> lock(lifecycle_mtx_);
+                listeners_.push_back(listener);
+            }
+            listener->run();
         }
-        listener->run();
     } catch (const std::exception& e) {
         std::cerr << "[Blaze] FATAL: Could not start listener: " << e.what() << std::endl;
         throw; // Crash the process so blaze dev knows we failed
@@ -297,6 +497,10 @@ void App::listen(const int port, int num_threads) {
             std::cout << "[Blaze] Received signal " << signal_number << ", stopping..." << std::endl;
             this->stop();
         });
+        if (FlightRecorder::instance().enabled() && FlightRecorder::instance().options().dump_on_signal) {
+            dump_signals_ = std::make_unique<net::signal_set>(ioc_, SIGUSR1);
+            _wait_dump_signal();
+        }
     }
 
     _run_server(num_threads);
@@ -309,6 +513,15 @@ void App::listen_ssl(const int port, const std::string& cert_path, const std::st
     if (config_.enable_docs) {
         _register_docs();
     }
+    if (!config_.metrics_path.empty()) {
+        _register_metrics();
+    }
+    if (FlightRecorder::instance().enabled()) {
+        _register_recorder();
+    }
+    router_.compile();
+    header_block_.set_server(config_.server_name);
+    _start_clock();
 
     if (num_threads <= 0) {
         num_threads = config_.num_threads;
@@ -330,13 +543,16 @@ void App::listen_ssl(const int port, const std::string& cert_path, const std::st
     auto const address = net::ip::make_address("0.0.0.0");
     auto const endpoint = net::ip::tcp::endpoint{address, static_cast<unsigned short>(port)};
 
-    // Create and launch SSL listening port
-    auto listener = std::make_shared<SslListener>(ioc_, ssl_ctx_, endpoint, *this);
-    {
-        std::lock_guard<std::mutex> lock(lifecycle_mtx_);
-        listeners_.push_back(listener);
+    // Create and launch SSL listening port (one SO_REUSEPORT acceptor per shard when sharded)
+    _open_shards(num_threads);
+    for (size_t i = 0; i <= shards_.size(); ++i) {
+        auto listener = std::make_shared<SslListener>(_shard(i), ssl_ctx_, endpoint, *this, config_.shard_per_core);
+        {
+            std::lock_guard<std::mutex> lock(lifecycle_mtx_);
+            listeners_.push_back(listener);
+        }
+        listener->run();
     }
-    listener->run();
 
     // (Ctrl+C) to stop cleanly
     {
@@ -351,6 +567,10 @@ void App::listen_ssl(const int port, const std::string& cert_path, const std::st
             std::cout << "[Blaze] Received signal " << signal_number << ", stopping..." << std::endl;
             this->stop();
         });
+        if (FlightRecorder::instance().enabled() && FlightRecorder::instance().options().dump_on_signal) {
+            dump_signals_ = std::make_unique<net::signal_set>(ioc_, SIGUSR1);
+            _wait_dump_signal();
+        }
     }
 
     std::cout << "[App] Starting HTTPS on port " << port << " with " << num_threads << " threads\n";
@@ -358,7 +578,56 @@ void App::listen_ssl(const int port, const std::string& cert_path, const std::st
     _run_server(num_threads);
 }
 
+void App::_open_shards(const int num_threads) {
+    if (!config_.shard_per_core) {
+        return;
+    }
+
+    // Shard 0 is ioc_; each extra shard is only ever run by one thread
+    shards_.clear();
+    for (int i = 1; i < num_threads; ++i) {
+        shards_.push_back(std::make_unique<net::io_context>(1));
+    }
+    services_.set_shard_count(shards_.size() + 1);
+}
+
+net::io_context& App::_shard(const size_t index) {
+    return index == 0 ? ioc_ : *shards_[index - 1];
+}
+
+net::io_context& App::local_engine() {
+    const size_t index = this_shard();
+    return index <= shards_.size() ? _shard(index) : ioc_;
+}
+
+void App::_run_shard(const size_t index) {
+    this_shard() = index;
+    if (config_.pin_threads) {
+        pin_to_cpu(index);
+    }
+    _shard(index).run();
+}
+
 void App::_run_server(int num_threads) {
+    if (config_.shard_per_core) {
+        std::vector<std::thread> v;
+        v.reserve(shards_.size());
+        for (size_t i = 1; i <= shards_.size(); ++i)
+            v.emplace_back([this, i]{
+                _run_shard(i);
+            });
+
+        // Shard 0 runs on the main thread and owns the lifecycle:
+        // once it stops (signal, stop() timeout, engine().stop()) every shard stops
+        _run_shard(0);
+        for (auto& shard : shards_)
+            shard->stop();
+
+        for(auto& t : v)
+            if(t.joinable()) t.join();
+        return;
+    }
+
     // Run the IO Context on n threads
     std::vector<std::thread> v;
     v.reserve(num_threads - 1);
@@ -375,11 +644,11 @@ void App::_run_server(int num_threads) {
 }
 
 void App::use(const Middleware &mw) {
-    middleware_.push_back(mw);
+    router_.use(mw);
 }
 
-RouteGroup App::group(const std::string& prefix) {
-    return RouteGroup(router_, prefix);
+RouteGroup App::group(const std::string& prefix, Pipeline middleware) {
+    return RouteGroup(router_, prefix, std::move(middleware));
 }
 
 } // namespace blaze
@@ -1,4 +1,5 @@
 #include <blaze/client.h>
+#include <blaze/tracing.h>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/ssl.hpp>
@@ -82,7 +83,7 @@ namespace blaze {
         return ctx;
     }
 
-    boost::asio::awaitable<FetchResponse> fetch_core(
+    boost::asio::awaitable<FetchResponse> fetch_follow(
         std::string url, 
         std::string method_str, 
         std::map<std::string, std::string> headers,
@@ -184,6 +185,36 @@ namespace blaze {
         throw std::runtime_error("Too many redirects");
     }
 
+    // One client span per fetch, redirects included; the callee continues it via traceparent
+    boost::asio::awaitable<FetchResponse> fetch_core(
+        std::string url,
+        std::string method_str,
+        std::map<std::string, std::string> headers,
+        std::string body_str,
+        bool set_json_content_type,
+        int timeout_seconds
+    ) {
+        Span span(Trace::current(), "HTTP " + method_str, SpanKind::CLIENT);
+        if (!span) {
+            co_return co_await fetch_follow(std::move(url), std::move(method_str), std::move(headers),
+                                            std::move(body_str), set_json_content_type, timeout_seconds);
+        }
+
+        span.set_attribute("http.request.method", method_str);
+        span.set_attribute("url.full", url);
+        headers["traceparent"] = span.traceparent();
+        try {
+            FetchResponse response = co_await fetch_follow(std::move(url), std::move(method_str), std::move(headers),
+                                                           std::move(body_str), set_json_content_type, timeout_seconds);
+            span.set_attribute("http.response.status_code", static_cast<int64_t>(response.status));
+            if (response.status >= 400) span.set_error();
+            co_return response;
+        } catch (const std::exception& e) {
+            span.set_error(e.what());
+            throw;
+        }
+    }
+
     boost::asio::awaitable<FetchResponse> fetch(
         std::string url, 
         std::string method_str, 
@@ -8,6 +8,8 @@
 #include <openssl/kdf.h>
 #include <openssl/params.h>
 #include <openssl/crypto.h>
+#include <array>
+#include <cstdint>
 #include <iomanip>
 #include <memory>
 #include <string_view>
@@ -19,10 +21,14 @@ namespace blaze::crypto {
     struct BioDeleter { void operator()(BIO* b) { BIO_free_all(b); } };
     struct KdfDeleter { void operator()(EVP_KDF* k) { EVP_KDF_free(k); } };
     struct KdfCtxDeleter { void operator()(EVP_KDF_CTX* c) { EVP_KDF_CTX_free(c); } };
+    struct MacDeleter { void operator()(EVP_MAC* m) { EVP_MAC_free(m); } };
+    struct MacCtxDeleter { void operator()(EVP_MAC_CTX* c) { EVP_MAC_CTX_free(c); } };
 
     using BioPtr = std::unique_ptr<BIO, BioDeleter>;
     using KdfPtr = std::unique_ptr<EVP_KDF, KdfDeleter>;
     using KdfCtxPtr = std::unique_ptr<EVP_KDF_CTX, KdfCtxDeleter>;
+    using MacPtr = std::unique_ptr<EVP_MAC, MacDeleter>;
+    using MacCtxPtr = std::unique_ptr<EVP_MAC_CTX, MacCtxDeleter>;
 
     namespace {
         BioPtr create_base64_sink() {
@@ -48,6 +54,79 @@ namespace blaze::crypto {
             BIO_push(b64.get(), mem);
             return b64;
         }
+
+        constexpr size_t SHA256_SIZE = 32;
+        constexpr size_t npos = static_cast<size_t>(-1);
+
+        constexpr auto BASE64URL_TABLE = [] {
+            std::array<int8_t, 256> table{};
+            table.fill(-1);
+            const std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+            for (size_t i = 0; i < alphabet.size(); ++i) table[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+            return table;
+        }();
+
+        constexpr size_t base64url_decoded_size(size_t length) {
+            return length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0);
+        }
+
+        // Decodes unpadded base64url straight into `out`. Returns the decoded size, or npos
+        // if `input` isn't base64url or doesn't fit in `capacity`.
+        size_t decode_base64url(std::string_view input, unsigned char* out, size_t capacity) {
+            while (!input.empty() && input.back() == '=') input.remove_suffix(1);
+            if (input.size() % 4 == 1) return npos;
+            const size_t size = base64url_decoded_size(input.size());
+            if (size > capacity) return npos;
+
+            uint32_t bits = 0;
+            int pending = 0;
+            size_t written = 0;
+            for (const char c : input) {
+                const int8_t value = BASE64URL_TABLE[static_cast<unsigned char>(c)];
+                if (value < 0) return npos;
+                bits = (bits << 6) | static_cast<uint32_t>(value);
+                pending += 6;
+                if (pending >= 8) {
+                    pending -= 8;
+                    out[written++] = static_cast<unsigned char>(bits >> pending);
+                }
+            }
+            return written;
+        }
+
+        // HMAC-SHA256 on a per-thread context that is only rekeyed when the key changes
+        bool hmac_sha256_into(std::string_view key, std::string_view data, unsigned char (&out)[SHA256_SIZE]) {
+            static const MacPtr hmac(EVP_MAC_fetch(nullptr, "HMAC", nullptr));
+            struct ThreadMac {
+                MacCtxPtr ctx;
+                std::string key;
+                bool keyed = false;
+            };
+            thread_local ThreadMac state;
+
+            if (!hmac) return false;
+            if (!state.ctx) state.ctx.reset(EVP_MAC_CTX_new(hmac.get()));
+            if (!state.ctx) return false;
+
+            if (!state.keyed || state.key != key) {
+                char digest[] = "SHA256";
+                const OSSL_PARAM params[] = {
+                    OSSL_PARAM_construct_utf8_string("digest", digest, 0),
+                    OSSL_PARAM_construct_end()
+                };
+                state.keyed = EVP_MAC_init(state.ctx.get(), reinterpret_cast<const unsigned char*>(key.data()), key.size(), params) > 0;
+                if (!state.keyed) return false;
+                state.key.assign(key);
+            } else if (EVP_MAC_init(state.ctx.get(), nullptr, 0, nullptr) <= 0) {
+                // A null key restarts the MAC with the key already set
+                state.keyed = false;
+                return false;
+            }
+
+            size_t len = 0;
+            return EVP_MAC_update(state.ctx.get(), reinterpret_cast<const unsigned char*>(data.data()), data.size()) > 0 &&
+                   EVP_MAC_final(state.ctx.get(), out, &len, SHA256_SIZE) > 0 && len == SHA256_SIZE;
+        }
     }
 
     std::string sha256(std::string_view input) {
@@ -58,10 +137,9 @@ namespace blaze::crypto {
     }
 
     std::string hmac_sha256(std::string_view key, std::string_view data) {
-        unsigned char hash[32];
-        unsigned int len = 32;
-        HMAC(EVP_sha256(), key.data(), key.size(), (unsigned char*)data.data(), data.size(), hash, &len);
-        return std::string((char*)hash, len);
+        unsigned char hash[SHA256_SIZE];
+        if (!hmac_sha256_into(key, data, hash)) return "";
+        return std::string((char*)hash, SHA256_SIZE);
     }
 
     std::string base64_encode(std::string_view input) {
@@ -138,45 +216,60 @@ namespace blaze::crypto {
 
     Json jwt_verify(std::string_view token, std::string_view secret, JwtError* error) {
         if (error) *error = JwtError::None;
+        auto fail = [error](JwtError reason) {
+            if (error) *error = reason;
+            return blaze::Json();
+        };
 
         size_t first_dot = token.find('.');
         size_t last_dot = token.rfind('.');
         if(first_dot == std::string::npos || last_dot == std::string::npos || first_dot == last_dot) {
-            if (error) *error = JwtError::Malformed;
-            return blaze::Json();
+            return fail(JwtError::Malformed);
         }
 
         std::string_view data = token.substr(0, last_dot);
         std::string_view sig_b64 = token.substr(last_dot + 1);
-        
-        std::string expected_sig = hmac_sha256(secret, data);
-        std::string received_sig = base64url_decode(sig_b64);
 
-        if (expected_sig.size() != received_sig.size() ||
-            CRYPTO_memcmp(expected_sig.data(), received_sig.data(), expected_sig.size()) != 0) {
-            if (error) *error = JwtError::InvalidSignature;
-            return blaze::Json();
+        // Everything up to the parse lives on the stack
+        unsigned char expected_sig[SHA256_SIZE];
+        unsigned char received_sig[SHA256_SIZE + 3];
+        if (!hmac_sha256_into(secret, data, expected_sig)) return fail(JwtError::InvalidSignature);
+        if (decode_base64url(sig_b64, received_sig, sizeof(received_sig)) != SHA256_SIZE ||
+            CRYPTO_memcmp(expected_sig, received_sig, SHA256_SIZE) != 0) {
+            return fail(JwtError::InvalidSignature);
         }
 
-        try {
-            std::string payload_json = base64url_decode(token.substr(first_dot + 1, last_dot - first_dot - 1));
-            auto payload = boost::json::parse(payload_json);
-            
-            if (payload.is_object() && payload.as_object().contains("exp")) {
-                auto& exp_val = payload.at("exp");
-                if (exp_val.is_number()) {
-                    if (std::time(nullptr) > exp_val.to_number<std::int64_t>()) {
-                        if (error) *error = JwtError::Expired;
-                        return blaze::Json(); 
-                    }
+        std::string_view payload_b64 = token.substr(first_dot + 1, last_dot - first_dot - 1);
+        unsigned char stack_payload[1024];
+        std::string heap_payload;
+        unsigned char* payload_buf = stack_payload;
+        size_t capacity = sizeof(stack_payload);
+        if (base64url_decoded_size(payload_b64.size()) > capacity) {
+            heap_payload.resize(base64url_decoded_size(payload_b64.size()));
+            payload_buf = reinterpret_cast<unsigned char*>(heap_payload.data());
+            capacity = heap_payload.size();
+        }
+        const size_t payload_size = decode_base64url(payload_b64, payload_buf, capacity);
+        if (payload_size == npos) return fail(JwtError::Malformed);
+
+        // The parser's scratch space is on the stack too; only the result is allocated
+        unsigned char parse_buffer[2048];
+        boost::json::parser parser(boost::json::storage_ptr(), {}, parse_buffer, sizeof(parse_buffer));
+        boost::json::error_code ec;
+        parser.write(reinterpret_cast<const char*>(payload_buf), payload_size, ec);
+        if (ec) return fail(JwtError::Malformed);
+        boost::json::value payload = parser.release();
+
+        if (payload.is_object()) {
+            if (const auto* exp_val = payload.as_object().if_contains("exp"); exp_val && exp_val->is_number()) {
+                // NumericDate may be fractional or out of int64 range; as a double it converts without throwing
+                if (static_cast<double>(std::time(nullptr)) > exp_val->to_number<double>()) {
+                    return fail(JwtError::Expired);
                 }
             }
-            
-            return blaze::Json(payload);
-        } catch (...) {
-            if (error) *error = JwtError::Malformed;
-            return blaze::Json();
         }
+
+        return blaze::Json(std::move(payload));
     }
 
     std::string hash_password(std::string_view password) {
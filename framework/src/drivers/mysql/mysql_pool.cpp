@@ -11,6 +11,9 @@ namespace blaze {
         explicit MySqlConnectionProxy(MySqlConnection* conn) : conn_(conn) {}
 
         boost::asio::awaitable<DbResult> query(const std::string& sql, const std::vector<std::string>& params = {}) override {
+            Span span(Trace::current(), "mysql.query", SpanKind::CLIENT);
+            span.set_attribute("db.system", "mysql");
+            span.set_attribute("db.statement", sql);
             MySqlResult res = co_await conn_->query(sql, params);
             co_return DbResult(std::make_shared<MySqlResult>(std::move(res)));
         }
@@ -28,7 +31,8 @@ namespace blaze {
     };
 
 MySqlPool::MySqlPool(boost::asio::io_context& ctx, std::string url, int size)
-    : ctx_(ctx), url_(std::move(url)), size_(size) {
+    : ctx_(ctx), url_(std::move(url)), size_(size),
+      metrics_(Metrics::instance().register_pool("mysql")) {
     parse_url();
 }
 
@@ -67,6 +71,7 @@ boost::asio::awaitable<void> MySqlPool::start() {
             std::lock_guard<std::mutex> lock(mutex_);
             available_.push(conn.get());
             pool_.push_back(std::move(conn));
+            metrics_->size.fetch_add(1, std::memory_order_relaxed);
 
             if (!waiters_.empty()) {
                 auto timer = waiters_.front();
@@ -87,6 +92,9 @@ boost::asio::awaitable<MySqlConnection*> MySqlPool::acquire() {
             if (!available_.empty()) {
                 auto* conn = available_.front();
                 available_.pop();
+                metrics_->in_use.fetch_add(1, std::memory_order_relaxed);
+                metrics_->acquire.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start_time));
                 co_return conn;
             }
             
@@ -97,14 +105,17 @@ boost::asio::awaitable<MySqlConnection*> MySqlPool::acquire() {
             timer = std::make_shared<boost::asio::steady_timer>(ctx_, std::chrono::seconds(5));
             waiters_.push(timer);
         }
+        metrics_->waiters.fetch_add(1, std::memory_order_relaxed);
         try {
             co_await timer->async_wait(boost::asio::use_awaitable);
         } catch (...) {}
+        metrics_->waiters.fetch_sub(1, std::memory_order_relaxed);
     }
 }
 
 void MySqlPool::release(MySqlConnection* conn) {
     if (!conn) return;
+    metrics_->in_use.fetch_sub(1, std::memory_order_relaxed);
     std::lock_guard<std::mutex> lock(mutex_);
     available_.push(conn);
     if (!waiters_.empty()) {
@@ -119,7 +130,17 @@ boost::asio::awaitable<DbResult> MySqlPool::query(const std::string& sql, const
         throw std::runtime_error("MySQL Circuit Open: Too many recent failures");
     }
 
-    auto* conn = co_await acquire();
+    Span span(Trace::current(), "mysql.query", SpanKind::CLIENT);
+    span.set_attribute("db.system", "mysql");
+    span.set_attribute("db.statement", sql);
+
+    QueryTimer timer("mysql", sql);
+    MySqlConnection* conn;
+    {
+        Span wait(Trace::current(), "mysql.acquire");
+        conn = co_await acquire();
+    }
+    timer.acquired();
 
     for (int attempt = 1; attempt <= 2; ++attempt) {
         try {
@@ -138,6 +159,7 @@ boost::asio::awaitable<DbResult> MySqlPool::query(const std::string& sql, const
             if (attempt == 2) {
                 release(conn);
                 breaker_.record_failure();
+                span.set_error(e.what());
                 throw;
             }
         }
@@ -10,6 +10,9 @@ namespace blaze {
         explicit PgConnectionProxy(PgConnection* conn) : conn_(conn) {}
 
         boost::asio::awaitable<DbResult> query(const std::string& sql, const std::vector<std::string>& params = {}) override {
+            Span span(Trace::current(), "postgres.query", SpanKind::CLIENT);
+            span.set_attribute("db.system", "postgresql");
+            span.set_attribute("db.statement", sql);
             PgResult res = co_await conn_->query(sql, params);
             co_return DbResult(std::make_shared<PgResult>(std::move(res)));
         }
@@ -28,7 +31,8 @@ namespace blaze {
     };
 
     PgPool::PgPool(boost::asio::io_context& ctx, std::string conn_str, int size)
-        : ctx_(ctx), conn_str_(std::move(conn_str)), size_(size) {}
+        : ctx_(ctx), conn_str_(std::move(conn_str)), size_(size),
+          metrics_(Metrics::instance().register_pool("postgres")) {}
 
     PgPool::PgPool(App& app, std::string conn_str, const int size)
         : PgPool(app.engine(), std::move(conn_str), size) {}
@@ -53,6 +57,7 @@ namespace blaze {
                 std::lock_guard<std::mutex> lock(mutex_);
                 available_.push(conn.get());
                 pool_.push_back(std::move(conn));
+                metrics_->size.fetch_add(1, std::memory_order_relaxed);
                 
                 if (!waiters_.empty()) {
                     auto timer = waiters_.front();
@@ -73,6 +78,9 @@ namespace blaze {
                 if (!available_.empty()) {
                     PgConnection* conn = available_.front();
                     available_.pop();
+                    metrics_->in_use.fetch_add(1, std::memory_order_relaxed);
+                    metrics_->acquire.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start_time));
                     co_return conn;
                 }
 
@@ -83,14 +91,17 @@ namespace blaze {
                 timer = std::make_shared<boost::asio::steady_timer>(ctx_, std::chrono::seconds(5));
                 waiters_.push(timer);
             }
+            metrics_->waiters.fetch_add(1, std::memory_order_relaxed);
             try {
                 co_await timer->async_wait(boost::asio::use_awaitable);
             } catch (...) {}
+            metrics_->waiters.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
     void PgPool::release(PgConnection* conn) {
         if (!conn) return;
+        metrics_->in_use.fetch_sub(1, std::memory_order_relaxed);
         std::lock_guard<std::mutex> lock(mutex_);
         available_.push(conn);
         if (!waiters_.empty()) {
@@ -105,7 +116,17 @@ namespace blaze {
             throw std::runtime_error("Postgres Circuit Open: Too many recent failures");
         }
 
-        PgConnection* conn = co_await acquire();
+        Span span(Trace::current(), "postgres.query", SpanKind::CLIENT);
+        span.set_attribute("db.system", "postgresql");
+        span.set_attribute("db.statement", sql);
+
+        QueryTimer timer("postgres", sql);
+        PgConnection* conn;
+        {
+            Span wait(Trace::current(), "postgres.acquire");
+            conn = co_await acquire();
+        }
+        timer.acquired();
 
         for (int attempt = 1; attempt <= 2; ++attempt) {
             try {
@@ -126,6 +147,7 @@ namespace blaze {
                 if (attempt == 2) {
                     release(conn);
                     breaker_.record_failure();
+                    span.set_error(e.what());
                     throw;
                 }
             }
@@ -0,0 +1,214 @@
+#include <blaze/flight_recorder.h>
+#include <blaze/request_scope.h>
+#include <blaze/util/string.h>
+
+namespace blaze {
+
+namespace {
+    int64_t wall_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t elapsed_us(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+    }
+
+    void append_field(std::string& out, std::string_view key, int64_t value) {
+        util::append_json_string(out, key);
+        out += ':';
+        out += std::to_string(value);
+    }
+
+    void append_field(std::string& out, std::string_view key, std::string_view value) {
+        util::append_json_string(out, key);
+        out += ':';
+        util::append_json_string(out, value);
+    }
+
+    // Visits the `written` most recent records of a ring, newest first
+    template <typename Record, typename Visit>
+    void newest_first(const std::vector<Record>& ring, uint64_t written, Visit&& visit) {
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(written, ring.size()));
+        for (size_t i = 1; i <= count; ++i) {
+            visit(ring[(written - i) % ring.size()]);
+        }
+    }
+}
+
+std::string_view phase_name(const Phase phase) {
+    switch (phase) {
+        case Phase::READ:       return "read";
+        case Phase::ROUTE:      return "route";
+        case Phase::MIDDLEWARE: return "middleware";
+        case Phase::HANDLER:    return "handler";
+        case Phase::DB_WAIT:    return "db_wait";
+        case Phase::DB_EXEC:    return "db_exec";
+        case Phase::WRITE:      return "write";
+    }
+    return "unknown";
+}
+
+// ---- RequestProfile ----
+
+int64_t RequestProfile::server_us() const {
+    int64_t total = 0;
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        if (i != static_cast<size_t>(Phase::READ)) total += phase_us[i];
+    }
+    return total;
+}
+
+// ---- FlightRecorder ----
+
+FlightRecorder& FlightRecorder::instance() {
+    static FlightRecorder instance;
+    return instance;
+}
+
+void FlightRecorder::configure(FlightRecorderOptions options) {
+    options.capacity = std::max<size_t>(options.capacity, 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.assign(options.capacity, SlowRequestRecord{});
+        queries_.assign(options.capacity, SlowQueryRecord{});
+        requests_written_ = 0;
+        queries_written_ = 0;
+    }
+    request_threshold_us_.store(options.request_threshold.count(), std::memory_order_relaxed);
+    query_threshold_us_.store(options.query_threshold.count(), std::memory_order_relaxed);
+    options_ = std::move(options);
+    enabled_.store(true, std::memory_order_release);
+}
+
+void FlightRecorder::disable() {
+    enabled_.store(false, std::memory_order_relaxed);
+}
+
+void FlightRecorder::record_request(const RequestProfile& profile, std::string_view method, std::string_view path,
+                                    const int status) {
+    const int64_t server_us = profile.server_us();
+    if (!enabled() || server_us < request_threshold_us_.load(std::memory_order_relaxed)) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    SlowRequestRecord& rec = requests_[requests_written_++ % requests_.size()];
+    rec.time_us = wall_us();
+    rec.total_us = server_us + profile.get(Phase::READ);
+    rec.phase_us = profile.phase_us;
+    rec.status = status;
+    rec.queries = profile.queries;
+    rec.slowest_query_us = profile.slowest_query_us;
+    rec.method.assign(method);
+    rec.route.assign(profile.route);
+    rec.path.assign(path);
+    rec.slowest_sql.assign(profile.slowest_sql.view());
+}
+
+void FlightRecorder::record_query(RequestProfile* profile, std::string_view driver, std::string_view sql,
+                                  const std::chrono::microseconds wait, const std::chrono::microseconds exec) {
+    const int64_t total_us = wait.count() + exec.count();
+    if (profile) {
+        profile->add(Phase::DB_WAIT, wait);
+        profile->add(Phase::DB_EXEC, exec);
+        ++profile->queries;
+        if (total_us >= profile->slowest_query_us) {
+            profile->slowest_query_us = total_us;
+            profile->slowest_sql.assign(sql);
+        }
+    }
+    if (!enabled() || total_us < query_threshold_us_.load(std::memory_order_relaxed)) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    SlowQueryRecord& rec = queries_[queries_written_++ % queries_.size()];
+    rec.time_us = wall_us();
+    rec.wait_us = wait.count();
+    rec.exec_us = exec.count();
+    rec.driver.assign(driver);
+    rec.route.assign(profile ? profile->route : std::string_view{});
+    rec.sql.assign(sql);
+}
+
+std::string FlightRecorder::dump() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    out.reserve(256 + (requests_.size() + queries_.size()) * 256);
+
+    out += "{\"slow_requests\":[";
+    bool first = true;
+    newest_first(requests_, requests_written_, [&](const SlowRequestRecord& rec) {
+        if (!first) out += ',';
+        first = false;
+        out += '{';
+        append_field(out, "time_us", rec.time_us);
+        out += ',';
+        append_field(out, "method", rec.method.view());
+        out += ',';
+        append_field(out, "path", rec.path.view());
+        out += ',';
+        append_field(out, "route", rec.route.view());
+        out += ',';
+        append_field(out, "status", rec.status);
+        out += ',';
+        append_field(out, "total_us", rec.total_us);
+        out += ",\"phases_us\":{";
+        for (size_t i = 0; i < kPhaseCount; ++i) {
+            if (i) out += ',';
+            append_field(out, phase_name(static_cast<Phase>(i)), rec.phase_us[i]);
+        }
+        out += "},";
+        append_field(out, "queries", rec.queries);
+        if (rec.queries) {
+            out += ',';
+            append_field(out, "slowest_query_us", rec.slowest_query_us);
+            out += ',';
+            append_field(out, "slowest_sql", rec.slowest_sql.view());
+        }
+        out += '}';
+    });
+
+    out += "],\"slow_queries\":[";
+    first = true;
+    newest_first(queries_, queries_written_, [&](const SlowQueryRecord& rec) {
+        if (!first) out += ',';
+        first = false;
+        out += '{';
+        append_field(out, "time_us", rec.time_us);
+        out += ',';
+        append_field(out, "driver", rec.driver.view());
+        out += ',';
+        append_field(out, "route", rec.route.view());
+        out += ',';
+        append_field(out, "wait_us", rec.wait_us);
+        out += ',';
+        append_field(out, "exec_us", rec.exec_us);
+        out += ',';
+        append_field(out, "sql", rec.sql.view());
+        out += '}';
+    });
+    out += "]}";
+    return out;
+}
+
+// ---- QueryTimer ----
+
+QueryTimer::QueryTimer(std::string_view driver, std::string_view sql)
+    : active_(FlightRecorder::instance().enabled()), driver_(driver), sql_(sql) {
+    if (!active_) return;
+    RequestScope* scope = RequestScope::current();
+    if (scope && scope->profiled) scope_ = scope->shared_from_this();
+    start_ = acquired_ = std::chrono::steady_clock::now();
+}
+
+void QueryTimer::acquired() {
+    if (active_) acquired_ = std::chrono::steady_clock::now();
+}
+
+QueryTimer::~QueryTimer() {
+    if (!active_) return;
+    const auto now = std::chrono::steady_clock::now();
+    FlightRecorder::instance().record_query(scope_ ? &scope_->profile : nullptr, driver_, sql_,
+                                            std::chrono::microseconds(elapsed_us(start_, acquired_)),
+                                            std::chrono::microseconds(elapsed_us(acquired_, now)));
+}
+
+} // namespace blaze
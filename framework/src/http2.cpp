@@ -0,0 +1,565 @@
+#include "http2.h"
+#include <blaze/app.h>
+#include <blaze/exceptions.h>
+#include <blaze/flight_recorder.h>
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <vector>
+
+namespace blaze {
+
+namespace {
+
+    // Connection-specific fields are forbidden in HTTP/2 responses (RFC 9113, 8.2.2).
+    // Expects a lowercase name.
+    bool is_hop_by_hop(std::string_view name) {
+        return name == "connection" || name == "keep-alive" || name == "transfer-encoding" ||
+               name == "upgrade" || name == "proxy-connection";
+    }
+
+    std::string to_lower(std::string_view s) {
+        std::string out(s);
+        std::transform(out.begin(), out.end(), out.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return out;
+    }
+
+    nghttp2_nv make_nv(std::string_view name, std::string_view value) {
+        return {
+            reinterpret_cast<uint8_t*>(const_cast<char*>(name.data())),
+            reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())),
+            name.size(), value.size(), NGHTTP2_NV_FLAG_NONE
+        };
+    }
+
+    void error_response(Response& res, int status, std::string_view message) {
+        res = Response();
+        res.status(status).json({{"error", std::string(message)}});
+    }
+
+    // A streaming producer waits once this much of its output is queued for the peer
+    constexpr size_t kStreamHighWater = 64 * 1024;
+
+}
+
+template<class Stream>
+Http2Session<Stream>::Http2Session(App& app, Stream&& stream, beast::flat_buffer&& buffer, std::string client_ip)
+    : stream_(std::move(stream)), buffer_(std::move(buffer)), app_(app), client_ip_(std::move(client_ip)),
+      idle_deadline_(beast::get_lowest_layer(stream_).socket(), std::chrono::seconds(app.get_config().timeout_seconds)),
+      write_deadline_(beast::get_lowest_layer(stream_).socket(), std::chrono::seconds(app.get_config().timeout_seconds)) {
+    nghttp2_session_callbacks* callbacks = nullptr;
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) {
+        throw std::runtime_error("HTTP/2: failed to allocate callbacks");
+    }
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, &Http2Session::on_begin_headers);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, &Http2Session::on_header);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, &Http2Session::on_data_chunk);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, &Http2Session::on_frame_recv);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, &Http2Session::on_stream_close);
+
+    const int rv = nghttp2_session_server_new(&session_, callbacks, this);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) {
+        throw std::runtime_error(std::string("HTTP/2: ") + nghttp2_strerror(rv));
+    }
+}
+
+template<class Stream>
+Http2Session<Stream>::~Http2Session() {
+    nghttp2_session_del(session_);
+}
+
+template<class Stream>
+void Http2Session<Stream>::run() {
+    idle_deadline_.bind(this->weak_from_this());
+    write_deadline_.bind(this->weak_from_this());
+    boost::asio::co_spawn(stream_.get_executor(), read_loop(this->shared_from_this()), boost::asio::detached);
+}
+
+template<class Stream>
+boost::asio::awaitable<void> Http2Session<Stream>::read_loop(std::shared_ptr<Http2Session> self) {
+    const nghttp2_settings_entry settings[] = {
+        {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, app_.get_config().http2_max_streams},
+    };
+    nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings, std::size(settings));
+
+    // Bytes consumed while detecting the protocol belong to the connection preface
+    if (buffer_.size() > 0) {
+        const auto data = buffer_.data();
+        if (!feed(data.data(), data.size())) {
+            close();
+            co_return;
+        }
+        buffer_.consume(buffer_.size());
+    }
+    flush();
+
+    while (!closed_ && (nghttp2_session_want_read(session_) || nghttp2_session_want_write(session_))) {
+        // A stream may wait on its handler for as long as that takes; only an idle connection times out
+        if (streams_.empty()) idle_deadline_.arm();
+
+        reading_ = true;
+        beast::error_code ec;
+        const size_t n = co_await stream_.async_read_some(
+            net::buffer(read_buf_), net::redirect_error(net::use_awaitable, ec));
+        reading_ = false;
+        idle_deadline_.disarm();
+        if (ec || !feed(read_buf_.data(), n)) break;
+        flush();
+    }
+    close();
+}
+
+template<class Stream>
+bool Http2Session<Stream>::feed(const void* data, size_t size) {
+    const auto rv = nghttp2_session_mem_recv(session_, static_cast<const uint8_t*>(data), size);
+    if (rv < 0) {
+        if (rv != NGHTTP2_ERR_BAD_CLIENT_MAGIC) {
+            std::cerr << "[HTTP/2] Protocol error: " << nghttp2_strerror(static_cast<int>(rv)) << "\n";
+        }
+        return false;
+    }
+    return true;
+}
+
+template<class Stream>
+void Http2Session<Stream>::flush() {
+    if (writing_ || closed_) return;
+    writing_ = true;
+    boost::asio::co_spawn(stream_.get_executor(), write_loop(this->shared_from_this()), boost::asio::detached);
+}
+
+template<class Stream>
+boost::asio::awaitable<void> Http2Session<Stream>::write_loop(std::shared_ptr<Http2Session> self) {
+    while (!closed_) {
+        // Coalesce every pending frame into one write
+        write_buf_.clear();
+        for (;;) {
+            const uint8_t* data = nullptr;
+            const auto n = nghttp2_session_mem_send(session_, &data);
+            if (n < 0) {
+                writing_ = false;
+                close();
+                co_return;
+            }
+            if (n == 0) break;
+            write_buf_.append(reinterpret_cast<const char*>(data), static_cast<size_t>(n));
+            if (write_buf_.size() >= 64 * 1024) break;
+        }
+        if (write_buf_.empty()) break;
+
+        write_deadline_.arm();
+        beast::error_code ec;
+        co_await net::async_write(stream_, net::buffer(write_buf_), net::redirect_error(net::use_awaitable, ec));
+        write_deadline_.disarm();
+        if (ec) {
+            writing_ = false;
+            close();
+            co_return;
+        }
+    }
+    writing_ = false;
+
+    if (!nghttp2_session_want_read(session_) && !nghttp2_session_want_write(session_)) {
+        close();
+    }
+}
+
+template<class Stream>
+void Http2Session<Stream>::close() {
+    if (closed_) return;
+    closed_ = true;
+    idle_deadline_.disarm();
+    write_deadline_.disarm();
+    for (auto& [id, state] : streams_) {
+        if (state->drained) state->drained->cancel();
+    }
+    beast::error_code ec;
+    beast::get_lowest_layer(stream_).socket().shutdown(tcp::socket::shutdown_both, ec);
+    beast::get_lowest_layer(stream_).close();
+}
+
+template<class Stream>
+typename Http2Session<Stream>::StreamState* Http2Session<Stream>::find(int32_t stream_id) {
+    auto it = streams_.find(stream_id);
+    return it == streams_.end() ? nullptr : it->second.get();
+}
+
+template<class Stream>
+void Http2Session<Stream>::erase(int32_t stream_id) {
+    streams_.erase(stream_id);
+    // The last stream is gone while a read waits: the connection is idle from here
+    if (streams_.empty() && reading_ && !closed_) idle_deadline_.arm();
+}
+
+template<class Stream>
+void Http2Session<Stream>::dispatch(int32_t stream_id) {
+    StreamState* state = find(stream_id);
+    if (!state || state->dispatched) return;
+
+    if (state->decoder && !state->rejected) {
+        try {
+            state->decoder->finish();
+        } catch (const std::exception&) {
+            state->rejected = 400;
+        }
+    }
+    if (state->rejected) {
+        error_response(state->response, state->rejected,
+                       state->rejected == 413 ? "Payload Too Large" :
+                       state->rejected == 415 ? "Unsupported Content-Encoding" : "Bad Request");
+        submit(stream_id, *state);
+        return;
+    }
+
+    state->dispatched = true;
+    // A scoped request runs on an executor that keeps its scope current across awaits
+    if (RequestScope::open(state->request, state->scope)) {
+        boost::asio::co_spawn(RequestExecutor(stream_.get_executor(), state->scope),
+                              handle_stream(this->shared_from_this(), stream_id), boost::asio::detached);
+        return;
+    }
+    boost::asio::co_spawn(stream_.get_executor(), handle_stream(this->shared_from_this(), stream_id), boost::asio::detached);
+}
+
+template<class Stream>
+boost::asio::awaitable<void> Http2Session<Stream>::handle_stream(std::shared_ptr<Http2Session> self, int32_t stream_id) {
+    StreamState& state = *find(stream_id);
+    try {
+        state.response = co_await app_.handle_request(state.request, client_ip_);
+    } catch (const HttpError& e) {
+        error_response(state.response, e.status(), e.what());
+    } catch (const std::exception& e) {
+        std::cerr << "Async Handler Error: " << e.what() << "\n";
+        error_response(state.response, 500, "Internal Server Error");
+    }
+    // Frames are written as flow control allows, so there is no write phase to time here
+    if (const RequestProfile* profile = state.request.profile()) {
+        FlightRecorder::instance().record_request(*profile, state.request.method, state.request.path,
+                                                  state.response.get_status());
+    }
+    if (state.closed || closed_) {
+        erase(stream_id);
+        co_return;
+    }
+    submit(stream_id, state);
+    flush();
+
+    // The state stays dispatched, and so alive, until a streamed body is finished
+    if (state.streaming) co_await stream_body(stream_id, state);
+    state.dispatched = false;
+    if (state.closed) erase(stream_id);
+}
+
+// Hands Response::stream() output to nghttp2, which frames it as DATA as flow control allows
+template<class Stream>
+class Http2Session<Stream>::StreamWriter : public ResponseWriter {
+public:
+    StreamWriter(Http2Session& session, int32_t stream_id, StreamState& state)
+        : session_(session), stream_id_(stream_id), state_(state) {}
+
+    boost::asio::awaitable<void> write(std::string_view chunk) override {
+        if (state_.closed || session_.closed_) {
+            throw boost::system::system_error(net::error::operation_aborted);
+        }
+        state_.chunks.append(chunk);
+        session_.resume(stream_id_, state_);
+
+        while (state_.chunks.size() >= kStreamHighWater && !state_.closed && !session_.closed_) {
+            state_.drained->expires_at(net::steady_timer::time_point::max());
+            beast::error_code ec;
+            co_await state_.drained->async_wait(net::redirect_error(net::use_awaitable, ec));
+        }
+    }
+
+private:
+    Http2Session& session_;
+    int32_t stream_id_;
+    StreamState& state_;
+};
+
+template<class Stream>
+boost::asio::awaitable<void> Http2Session<Stream>::stream_body(int32_t stream_id, StreamState& state) {
+    state.drained.emplace(stream_.get_executor());
+    StreamWriter writer(*this, stream_id, state);
+    try {
+        co_await state.response.get_stream()(writer);
+    } catch (const std::exception& e) {
+        // A reset tells the client the body is incomplete, where END_STREAM would not
+        if (!state.closed && !closed_) {
+            nghttp2_submit_rst_stream(session_, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_INTERNAL_ERROR);
+            flush();
+        }
+        co_return;
+    }
+    state.stream_done = true;
+    resume(stream_id, state);
+}
+
+template<class Stream>
+void Http2Session<Stream>::resume(int32_t stream_id, StreamState& state) {
+    if (state.deferred) {
+        state.deferred = false;
+        nghttp2_session_resume_data(session_, stream_id);
+    }
+    flush();
+}
+
+template<class Stream>
+void Http2Session<Stream>::submit(int32_t stream_id, StreamState& state) {
+    auto& res = state.response.get_beast_response();
+
+    if (state.response.is_file()) {
+        beast::error_code ec;
+        state.file.emplace();
+        state.file->open(state.response.get_file_path().c_str(), beast::file_mode::scan, ec);
+        const std::uint64_t size = ec ? 0 : state.file->size(ec);
+        if (ec) {
+            state.file.reset();
+            error_response(state.response, 404, "File not found");
+        } else {
+            state.file_parts = state.response.get_file_parts();
+            if (state.file_parts.empty()) state.file_parts.push_back({{}, 0, size});
+            state.file_size = state.response.get_file_trailer().size();
+            for (const auto& part : state.file_parts) {
+                if (part.offset > size || part.length > size - part.offset) {
+                    state.file.reset();
+                    error_response(state.response, 500, "Internal Server Error");
+                    break;
+                }
+                state.file_size += part.prefix.size() + part.length;
+            }
+        }
+    }
+
+    const std::string status = std::to_string(res.result_int());
+    std::string content_length;
+    std::vector<std::string> names;
+    std::vector<nghttp2_nv> nva;
+    names.reserve(std::distance(res.begin(), res.end()));
+    nva.reserve(names.capacity() + 4);
+    nva.push_back(make_nv(":status", status));
+
+    bool has_date = false;
+    bool has_server = false;
+    for (const auto& field : res) {
+        std::string name = to_lower(std::string_view(field.name_string().data(), field.name_string().size()));
+        if (is_hop_by_hop(name) || name == "content-length") continue;
+        has_date = has_date || name == "date";
+        has_server = has_server || name == "server";
+        names.push_back(std::move(name));
+        nva.push_back(make_nv(names.back(), std::string_view(field.value().data(), field.value().size())));
+    }
+
+    const HeaderBlock& block = app_.header_block();
+    const HeaderBlock::DateText date = block.date();
+    if (!has_date) nva.push_back(make_nv("date", std::string_view(date.data(), date.size())));
+    if (!has_server) nva.push_back(make_nv("server", block.server()));
+
+    const bool no_body = state.request.method == "HEAD" || res.result_int() == 204 || res.result_int() == 304;
+    state.streaming = state.response.is_stream() && !no_body;
+    if (res.result_int() != 204 && res.result_int() != 304 && !state.streaming) {
+        content_length = std::to_string(state.file ? state.file_size : res.body().size());
+        nva.push_back(make_nv("content-length", content_length));
+    }
+
+    nghttp2_data_provider provider{};
+    provider.source.ptr = &state;
+    provider.read_callback = &Http2Session::read_body;
+
+    // nghttp2 copies the header block, so the local strings may go out of scope
+    const int rv = nghttp2_submit_response(session_, stream_id, nva.data(), nva.size(), no_body ? nullptr : &provider);
+    if (rv != 0) {
+        nghttp2_submit_rst_stream(session_, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_INTERNAL_ERROR);
+    }
+}
+
+template<class Stream>
+ssize_t Http2Session<Stream>::read_body(nghttp2_session*, int32_t, uint8_t* buf, size_t length,
+                                        uint32_t* data_flags, nghttp2_data_source* source, void*) {
+    auto* state = static_cast<StreamState*>(source->ptr);
+
+    if (state->streaming) {
+        if (state->chunks.empty()) {
+            if (state->stream_done) {
+                *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+                return 0;
+            }
+            state->deferred = true;
+            return NGHTTP2_ERR_DEFERRED;
+        }
+        const size_t n = std::min(length, state->chunks.size());
+        std::copy_n(state->chunks.data(), n, buf);
+        state->chunks.erase(0, n);
+        if (state->chunks.size() < kStreamHighWater) state->drained->cancel();
+        return static_cast<ssize_t>(n);
+    }
+
+    if (state->file) {
+        const ssize_t n = read_file(*state, buf, length);
+        if (n < 0) return n;
+        if (n == 0 || state->offset >= state->file_size) {
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        }
+        return n;
+    }
+
+    const std::string& body = state->response.get_beast_response().body();
+    const size_t n = std::min(length, body.size() - state->offset);
+    std::copy_n(body.data() + state->offset, n, buf);
+    state->offset += n;
+    if (state->offset == body.size()) {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return static_cast<ssize_t>(n);
+}
+
+// Fills `buf` from the file parts (prefix, then the file range) and the trailer, from state.offset on
+template<class Stream>
+ssize_t Http2Session<Stream>::read_file(StreamState& state, uint8_t* buf, size_t length) {
+    size_t written = 0;
+    size_t start = 0; // Body offset of the current piece
+    auto copy = [&](std::string_view piece) {
+        if (state.offset < start + piece.size() && written < length) {
+            const size_t n = std::min(length - written, start + piece.size() - state.offset);
+            std::copy_n(piece.data() + (state.offset - start), n, buf + written);
+            written += n;
+            state.offset += n;
+        }
+        start += piece.size();
+    };
+
+    for (const auto& part : state.file_parts) {
+        copy(part.prefix);
+        if (state.offset < start + part.length && written < length) {
+            beast::error_code ec;
+            state.file->seek(part.offset + (state.offset - start), ec);
+            const size_t want = std::min<std::uint64_t>(length - written, start + part.length - state.offset);
+            const size_t n = ec ? 0 : state.file->read(buf + written, want, ec);
+            if (ec || n == 0) return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+            written += n;
+            state.offset += n;
+            if (n < want) return static_cast<ssize_t>(written); // Short read; continue from here next time
+        }
+        start += part.length;
+    }
+    copy(state.response.get_file_trailer());
+    return static_cast<ssize_t>(written);
+}
+
+template<class Stream>
+int Http2Session<Stream>::on_begin_headers(nghttp2_session*, const nghttp2_frame* frame, void* user_data) {
+    auto* self = static_cast<Http2Session*>(user_data);
+    if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+        self->streams_.emplace(frame->hd.stream_id, std::make_unique<StreamState>());
+    }
+    return 0;
+}
+
+template<class Stream>
+int Http2Session<Stream>::on_header(nghttp2_session*, const nghttp2_frame* frame,
+                                    const uint8_t* name, size_t namelen,
+                                    const uint8_t* value, size_t valuelen,
+                                    uint8_t, void* user_data) {
+    auto* self = static_cast<Http2Session*>(user_data);
+    if (frame->hd.type != NGHTTP2_HEADERS) return 0;
+
+    StreamState* state = self->find(frame->hd.stream_id);
+    if (!state) return 0;
+
+    const std::string_view key(reinterpret_cast<const char*>(name), namelen);
+    const std::string_view val(reinterpret_cast<const char*>(value), valuelen);
+    const beast::string_view beast_key(key.data(), key.size());
+    const beast::string_view beast_val(val.data(), val.size());
+    Request& req = state->request;
+
+    if (key == ":method") {
+        req.method.assign(val);
+    } else if (key == ":path") {
+        req.set_target(val);
+    } else if (key == ":authority") {
+        req.headers.set(http::field::host, beast_val);
+    } else if (key.starts_with(':')) {
+        // :scheme and :protocol carry nothing a handler needs
+    } else if (key == "cookie" && req.has_header("Cookie")) {
+        // HTTP/2 may split cookies across fields; rejoin them for Request::cookie()
+        std::string joined(req.get_header("Cookie"));
+        joined.append("; ").append(val);
+        req.headers.set(http::field::cookie, joined);
+    } else if (key == "content-encoding") {
+        // Bodies are decoded as they arrive (see on_data_chunk), so handlers never see the coding
+        const auto coding = util::parse_coding(val);
+        if (!coding) {
+            state->rejected = 415;
+        } else if (*coding != util::ContentCoding::identity) {
+            state->decoder.emplace(*coding);
+        }
+    } else {
+        req.headers.insert(beast_key, beast_val);
+    }
+    return 0;
+}
+
+template<class Stream>
+int Http2Session<Stream>::on_data_chunk(nghttp2_session*, uint8_t, int32_t stream_id,
+                                        const uint8_t* data, size_t len, void* user_data) {
+    auto* self = static_cast<Http2Session*>(user_data);
+    StreamState* state = self->find(stream_id);
+    if (!state || state->rejected) return 0;
+
+    const std::string_view chunk(reinterpret_cast<const char*>(data), len);
+    const size_t limit = self->app_.get_config().max_body_size;
+    std::string& body = state->request.body;
+    try {
+        if (state->decoder) {
+            state->decoder->write(chunk, body, limit);
+        } else if (body.size() + len > limit) {
+            state->rejected = 413;
+        } else {
+            body.append(chunk);
+        }
+    } catch (const std::length_error&) {
+        state->rejected = 413;
+    } catch (const std::exception&) {
+        state->rejected = 400;
+    }
+    if (state->rejected) {
+        body.clear();
+        body.shrink_to_fit();
+        state->decoder.reset();
+    }
+    return 0;
+}
+
+template<class Stream>
+int Http2Session<Stream>::on_frame_recv(nghttp2_session*, const nghttp2_frame* frame, void* user_data) {
+    auto* self = static_cast<Http2Session*>(user_data);
+    if ((frame->hd.type == NGHTTP2_HEADERS || frame->hd.type == NGHTTP2_DATA) &&
+        (frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+        self->dispatch(frame->hd.stream_id);
+    }
+    return 0;
+}
+
+template<class Stream>
+int Http2Session<Stream>::on_stream_close(nghttp2_session*, int32_t stream_id, uint32_t, void* user_data) {
+    auto* self = static_cast<Http2Session*>(user_data);
+    auto it = self->streams_.find(stream_id);
+    if (it == self->streams_.end()) return 0;
+
+    if (it->second->dispatched) {
+        // The handler still references the state; it cleans up when it finishes
+        it->second->closed = true;
+        if (it->second->drained) it->second->drained->cancel();
+    } else {
+        self->erase(stream_id);
+    }
+    return 0;
+}
+
+// Explicit Instantiations
+template class Http2Session<beast::tcp_stream>;
+template class Http2Session<ssl::stream<beast::tcp_stream>>;
+
+} // namespace blaze
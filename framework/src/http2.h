@@ -0,0 +1,107 @@
+#ifndef BLAZE_HTTP2_H
+#define BLAZE_HTTP2_H
+
+#include "server.h"
+#include <nghttp2/nghttp2.h>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace blaze {
+
+// The 24-byte client connection preface that opens every HTTP/2 connection (RFC 9113, 3.4)
+inline constexpr std::string_view kHttp2Preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// Serves one HTTP/2 connection on top of libnghttp2.
+// nghttp2 owns framing, HPACK and flow control; this class moves bytes between it and the
+// socket and runs every complete stream through App::handle_request concurrently.
+template<class Stream>
+class Http2Session : public std::enable_shared_from_this<Http2Session<Stream>> {
+public:
+    // `buffer` holds bytes already read from the connection (e.g. while sniffing for h2c)
+    Http2Session(App& app, Stream&& stream, beast::flat_buffer&& buffer, std::string client_ip);
+    ~Http2Session();
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    void run();
+
+private:
+    struct StreamState {
+        Arena arena{2048};
+        Request request{&arena};
+        Response response;
+        std::optional<beast::file> file;
+        std::vector<FilePart> file_parts;            // The whole file unless the handler picked ranges
+        size_t file_size = 0;                        // Body length, part prefixes and trailer included
+        size_t offset = 0;
+        std::string chunks;                          // Response::stream() output not yet framed
+        std::optional<net::steady_timer> drained;    // Wakes a producer held back by backpressure
+        std::optional<util::StreamDecompressor> decoder; // Request body has a Content-Encoding
+        std::shared_ptr<RequestScope> scope;         // Set while the request is scoped
+        bool streaming = false;  // Body comes from Response::stream()
+        bool stream_done = false;
+        bool deferred = false;   // nghttp2 is waiting on the producer
+        int rejected = 0;        // Error status (413, 415, 400) sent without running the handler
+        bool dispatched = false; // Handler is running
+        bool closed = false;     // Peer reset the stream while the handler was running
+    };
+
+    boost::asio::awaitable<void> read_loop(std::shared_ptr<Http2Session> self);
+    boost::asio::awaitable<void> write_loop(std::shared_ptr<Http2Session> self);
+    boost::asio::awaitable<void> handle_stream(std::shared_ptr<Http2Session> self, int32_t stream_id);
+    boost::asio::awaitable<void> stream_body(int32_t stream_id, StreamState& state);
+
+    class StreamWriter;
+
+    bool feed(const void* data, size_t size);
+    void flush();
+    void close();
+    void dispatch(int32_t stream_id);
+    void submit(int32_t stream_id, StreamState& state);
+    static ssize_t read_file(StreamState& state, uint8_t* buf, size_t length);
+    void resume(int32_t stream_id, StreamState& state);
+    StreamState* find(int32_t stream_id);
+    void erase(int32_t stream_id);
+
+    // nghttp2 callbacks; user_data is the session
+    static int on_begin_headers(nghttp2_session*, const nghttp2_frame* frame, void* user_data);
+    static int on_header(nghttp2_session*, const nghttp2_frame* frame,
+                         const uint8_t* name, size_t namelen,
+                         const uint8_t* value, size_t valuelen,
+                         uint8_t flags, void* user_data);
+    static int on_data_chunk(nghttp2_session*, uint8_t flags, int32_t stream_id,
+                             const uint8_t* data, size_t len, void* user_data);
+    static int on_frame_recv(nghttp2_session*, const nghttp2_frame* frame, void* user_data);
+    static int on_stream_close(nghttp2_session*, int32_t stream_id, uint32_t error_code, void* user_data);
+    static ssize_t read_body(nghttp2_session*, int32_t stream_id, uint8_t* buf, size_t length,
+                             uint32_t* data_flags, nghttp2_data_source* source, void* user_data);
+
+    Stream stream_;
+    beast::flat_buffer buffer_;
+    App& app_;
+    std::string client_ip_;
+
+    nghttp2_session* session_ = nullptr;
+    std::unordered_map<int32_t, std::unique_ptr<StreamState>> streams_;
+    std::array<char, 16 * 1024> read_buf_;
+    std::string write_buf_;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool closed_ = false;
+    Deadline idle_deadline_;   // Armed only while no stream is open or dispatched
+    Deadline write_deadline_;  // Each socket write
+};
+
+// Hands an accepted connection over to HTTP/2
+template<class Stream>
+void start_http2(App& app, Stream&& stream, beast::flat_buffer&& buffer, std::string client_ip) {
+    std::make_shared<Http2Session<Stream>>(app, std::move(stream), std::move(buffer), std::move(client_ip))->run();
+}
+
+} // namespace blaze
+
+#endif
@@ -1,83 +1,430 @@
 #include <blaze/logger.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
-#include <iostream>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <functional>
 #include <filesystem>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 namespace blaze {
 
+namespace {
+    constexpr auto kIdleWait = std::chrono::milliseconds(10);
+    constexpr size_t kBatchBytes = 256 * 1024;
+    constexpr size_t kMaxAccessLine = 2560; // Longest line a record can format to, with every byte escaped
+    constexpr uint64_t kSampleAll = uint64_t(1) << 32;
+
+    std::string_view level_name(LogLevel level) {
+        switch (level) {
+            case LogLevel::DEBUG: return "DEBUG";
+            case LogLevel::INFO:  return "INFO";
+            case LogLevel::WARN:  return "WARN";
+            case LogLevel::ERROR: return "ERROR";
+        }
+        return "INFO";
+    }
+
+    template <size_t N>
+    uint8_t copy_field(char (&dest)[N], std::string_view value) {
+        const size_t n = std::min(value.size(), N);
+        std::memcpy(dest, value.data(), n);
+        return static_cast<uint8_t>(n);
+    }
+
+    // A timestamp formatted once per second, on the worker thread only
+    class StampCache {
+    public:
+        StampCache(const char* format, bool utc) : format_(format), utc_(utc) {}
+
+        std::string_view get(std::time_t t) {
+            if (t != second_) {
+                std::tm tm_buf{};
+                if (utc_) gmtime_r(&t, &tm_buf);
+                else localtime_r(&t, &tm_buf);
+                length_ = std::strftime(text_, sizeof(text_), format_, &tm_buf);
+                second_ = t;
+            }
+            return {text_, length_};
+        }
+
+    private:
+        const char* format_;
+        bool utc_;
+        std::time_t second_ = -1;
+        size_t length_ = 0;
+        char text_[32] = {};
+    };
+
+    // Lines for one writev(). Formatted text lives in a buffer that is never reallocated,
+    // so iovecs can point into it; message bodies are referenced where they are.
+    class WriteBatch {
+    public:
+        WriteBatch() : buffer_(std::make_unique<char[]>(kBatchBytes)) {}
+
+        size_t remaining() const { return kBatchBytes - used_; }
+
+        // Where the next line goes; write at most remaining() bytes, then commit() them
+        char* reserve() { return buffer_.get() + used_; }
+
+        void commit(size_t n) {
+            char* start = buffer_.get() + used_;
+            used_ += n;
+            // Extend the last segment when it ends right where this one starts
+            if (!iov_.empty() && static_cast<char*>(iov_.back().iov_base) + iov_.back().iov_len == start) {
+                iov_.back().iov_len += n;
+            } else {
+                iov_.push_back({start, n});
+            }
+        }
+
+        void append(std::string_view text) {
+            if (text.size() <= remaining()) {
+                std::memcpy(reserve(), text.data(), text.size());
+                commit(text.size());
+            } else {
+                iov_.push_back({const_cast<char*>(text.data()), text.size()});
+            }
+        }
+
+        void write_to(int fd) {
+            size_t index = 0;
+            while (fd >= 0 && index < iov_.size()) {
+                const int count = static_cast<int>(std::min<size_t>(iov_.size() - index, IOV_MAX));
+                ssize_t written = ::writev(fd, iov_.data() + index, count);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                // Skip whole segments, then trim a partially written one
+                while (index < iov_.size() && static_cast<size_t>(written) >= iov_[index].iov_len) {
+                    written -= static_cast<ssize_t>(iov_[index].iov_len);
+                    ++index;
+                }
+                if (index < iov_.size() && written > 0) {
+                    iov_[index].iov_base = static_cast<char*>(iov_[index].iov_base) + written;
+                    iov_[index].iov_len -= static_cast<size_t>(written);
+                }
+            }
+            iov_.clear();
+            used_ = 0;
+        }
+
+    private:
+        std::unique_ptr<char[]> buffer_;
+        size_t used_ = 0;
+        std::vector<iovec> iov_;
+    };
+
+    uint64_t sample_threshold(double rate) {
+        if (!(rate > 0.0)) return 0;
+        if (rate >= 1.0) return kSampleAll;
+        return static_cast<uint64_t>(rate * static_cast<double>(kSampleAll));
+    }
+
+    // xorshift32; sampling only needs to be cheap and roughly uniform
+    uint32_t next_random() {
+        thread_local uint32_t state = static_cast<uint32_t>(
+            std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1);
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    char* put(char* out, std::string_view text) {
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    template <typename Int>
+    char* put_int(char* out, Int value) {
+        return std::to_chars(out, out + 24, value).ptr;
+    }
+
+    char* put_hex_escape(char* out, unsigned char c) {
+        static constexpr char digits[] = "0123456789abcdef";
+        out = put(out, "\\u00");
+        *out++ = digits[c >> 4];
+        *out++ = digits[c & 0xF];
+        return out;
+    }
+
+    // JSON string contents: quotes, backslashes and control characters escaped
+    char* put_json(char* out, std::string_view text) {
+        for (const char ch : text) {
+            const auto c = static_cast<unsigned char>(ch);
+            if (c == '"' || c == '\\') {
+                *out++ = '\\';
+                *out++ = ch;
+            } else if (c < 0x20) {
+                out = put_hex_escape(out, c);
+            } else {
+                *out++ = ch;
+            }
+        }
+        return out;
+    }
+
+    // A logfmt value, quoted only when it has to be
+    char* put_logfmt(char* out, std::string_view text) {
+        const bool quote = text.empty() || std::any_of(text.begin(), text.end(), [](char ch) {
+            const auto c = static_cast<unsigned char>(ch);
+            return c <= ' ' || c == '"' || c == '=' || c == '\\';
+        });
+        if (!quote) return put(out, text);
+        *out++ = '"';
+        out = put_json(out, text);
+        *out++ = '"';
+        return out;
+    }
+}
+
+// State that only the worker thread touches
+struct Logger::WorkerState {
+    StampCache stamps{"%Y-%m-%d %H:%M:%S", false};
+    StampCache utc_stamps{"%Y-%m-%dT%H:%M:%S", true};
+    WriteBatch out;
+    WriteBatch err;
+    uint64_t reported_drops = 0;
+};
+
+char* Logger::format_access(WorkerState& state, const AccessRecord& rec, char* p) {
+    const std::string_view ip{rec.ip, rec.ip_len};
+    const std::string_view method{rec.method, rec.method_len};
+    const std::string_view path{rec.path, rec.path_len};
+    const std::string_view route{rec.route, rec.route_len};
+    const std::string_view user{rec.user, rec.user_len};
+    const std::time_t second = static_cast<std::time_t>(rec.time_us / 1000000);
+
+    // ISO 8601 in UTC with microseconds, for the structured formats
+    auto put_iso_time = [&](char* out) {
+        out = put(out, state.utc_stamps.get(second));
+        *out++ = '.';
+        char micros[8];
+        const auto fraction = static_cast<unsigned>(rec.time_us % 1000000);
+        std::snprintf(micros, sizeof(micros), "%06u", fraction);
+        out = put(out, {micros, 6});
+        *out++ = 'Z';
+        return out;
+    };
+
+    switch (rec.format) {
+        case AccessLogFormat::JSON:
+            p = put(p, "{\"ts\":\"");
+            p = put_iso_time(p);
+            p = put(p, "\",\"ip\":\"");
+            p = put_json(p, ip);
+            p = put(p, "\",\"method\":\"");
+            p = put_json(p, method);
+            p = put(p, "\",\"path\":\"");
+            p = put_json(p, path);
+            p = put(p, "\"");
+            if (!route.empty()) {
+                p = put(p, ",\"route\":\"");
+                p = put_json(p, route);
+                p = put(p, "\"");
+            }
+            p = put(p, ",\"status\":");
+            p = put_int(p, rec.status);
+            p = put(p, ",\"duration_us\":");
+            p = put_int(p, rec.duration_us);
+            p = put(p, ",\"bytes_in\":");
+            p = put_int(p, rec.bytes_in);
+            p = put(p, ",\"bytes_out\":");
+            p = put_int(p, rec.bytes_out);
+            if (!user.empty()) {
+                p = put(p, ",\"user\":\"");
+                p = put_json(p, user);
+                p = put(p, "\"");
+            }
+            return put(p, "}\n");
+
+        case AccessLogFormat::LOGFMT:
+            p = put(p, "ts=");
+            p = put_iso_time(p);
+            p = put(p, " ip=");
+            p = put_logfmt(p, ip);
+            p = put(p, " method=");
+            p = put_logfmt(p, method);
+            p = put(p, " path=");
+            p = put_logfmt(p, path);
+            if (!route.empty()) {
+                p = put(p, " route=");
+                p = put_logfmt(p, route);
+            }
+            p = put(p, " status=");
+            p = put_int(p, rec.status);
+            p = put(p, " duration_us=");
+            p = put_int(p, rec.duration_us);
+            p = put(p, " bytes_in=");
+            p = put_int(p, rec.bytes_in);
+            p = put(p, " bytes_out=");
+            p = put_int(p, rec.bytes_out);
+            if (!user.empty()) {
+                p = put(p, " user=");
+                p = put_logfmt(p, user);
+            }
+            return put(p, "\n");
+
+        case AccessLogFormat::TEXT:
+            break;
+    }
+
+    *p++ = '[';
+    p = put(p, state.stamps.get(second));
+    p = put(p, "] ACCESS: ");
+    p = put(p, ip);
+    *p++ = ' ';
+    p = put(p, method);
+    *p++ = ' ';
+    p = put(p, path);
+    *p++ = ' ';
+    p = put_int(p, rec.status);
+    *p++ = ' ';
+    p = put_int(p, rec.duration_us / 1000);
+    return put(p, "ms\n");
+}
+
 Logger& Logger::instance() {
     static Logger instance;
     return instance;
 }
 
 Logger::Logger() {
+    for (auto& threshold : sample_thresholds_) threshold.store(kSampleAll, std::memory_order_relaxed);
     worker_ = std::thread(&Logger::process_queue, this);
 }
 
 Logger::~Logger() {
     running_ = false;
-    cv_.notify_all();
+    wake_worker();
     if (worker_.joinable()) {
         worker_.join();
     }
-    if (file_stream_.is_open()) {
-        file_stream_.flush();
-        file_stream_.close();
-    }
+    if (owns_fd_) ::close(fd_);
 }
 
-std::string Logger::get_timestamp() {
-    const auto now = std::chrono::system_clock::now();
-    const auto now_time_t = std::chrono::system_clock::to_time_t(now);
-    std::tm tm_buf{};
-    
-    localtime_r(&now_time_t, &tm_buf);
+Logger::ThreadBuffer& Logger::local_buffer() {
+    struct Handle {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~Handle() {
+            if (buffer) buffer->retired.store(true, std::memory_order_release);
+        }
+    };
+    thread_local Handle handle;
 
-    std::stringstream ss;
-    ss << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+    if (!handle.buffer) {
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(handle.buffer);
+    }
+    return *handle.buffer;
 }
 
-void Logger::process_queue() {
-    while (running_ || !queue_.empty()) {
-        std::string msg;
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            cv_.wait(lock, [this] { return !queue_.empty() || !running_; });
-            
-            if (queue_.empty() && !running_) {
-                break;
-            }
+void Logger::wake_worker() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        wake_.store(true, std::memory_order_relaxed);
+    }
+    cv_.notify_one();
+}
+
+size_t Logger::drain(WorkerState& state) {
+    size_t handled = 0;
+
+    std::vector<Message> messages;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        messages.swap(messages_);
+    }
+
+    std::lock_guard<std::mutex> config_lock(config_mutex_);
+    const bool split_errors = use_stdout_;
+
+    for (const Message& msg : messages) {
+        const bool to_err = split_errors && msg.level == LogLevel::ERROR;
+        WriteBatch& batch = to_err ? state.err : state.out;
+        // The prefix is built on the stack, so it must be copied into the batch
+        if (batch.remaining() < 64) batch.write_to(to_err ? STDERR_FILENO : fd_);
+        char prefix[64];
+        char* p = prefix;
+        *p++ = '[';
+        p = put(p, state.stamps.get(msg.time));
+        p = put(p, "] ");
+        p = put(p, level_name(msg.level));
+        p = put(p, ": ");
+        batch.append({prefix, static_cast<size_t>(p - prefix)});
+        batch.append(msg.text);
+        batch.append("\n");
+    }
+    handled += messages.size();
 
-            msg = std::move(queue_.front());
-            queue_.pop();
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            const size_t room = state.out.remaining() / kMaxAccessLine;
+            handled += buffer->ring.consume([&](const AccessRecord& rec) {
+                char* start = state.out.reserve();
+                state.out.commit(static_cast<size_t>(format_access(state, rec, start) - start));
+            }, room);
         }
 
-        std::stringstream output;
-        output << "[" << get_timestamp() << "] " << msg << "\n";
-        std::string out_str = output.str();
+        // Forget rings whose threads are gone once they are empty
+        std::erase_if(buffers_, [this](const std::shared_ptr<ThreadBuffer>& buffer) {
+            if (!buffer->retired.load(std::memory_order_acquire) || buffer->ring.size() != 0) return false;
+            retired_dropped_ += buffer->dropped.load(std::memory_order_relaxed);
+            return true;
+        });
+    }
 
-        std::lock_guard<std::mutex> config_lock(config_mutex_);
-        if (use_stdout_) {
-            if (msg.find("ERROR") != std::string::npos) {
-                std::cerr << out_str;
-            } else {
-                std::cout << out_str;
-            }
-        } else if (file_stream_.is_open()) {
-            file_stream_ << out_str;
-            if (msg.find("ERROR") != std::string::npos) {
-                file_stream_.flush();
+    const uint64_t total_dropped = dropped();
+    if (total_dropped > state.reported_drops) {
+        std::string note = "[" + std::string(state.stamps.get(std::time(nullptr))) + "] WARN: Logger dropped " +
+            std::to_string(total_dropped - state.reported_drops) + " access records (buffer full)\n";
+        state.reported_drops = total_dropped;
+        state.out.append(note);
+        state.out.write_to(fd_);
+    }
+
+    state.out.write_to(fd_);
+    state.err.write_to(split_errors ? STDERR_FILENO : fd_);
+    return handled;
+}
+
+void Logger::process_queue() {
+    WorkerState state;
+    while (true) {
+        const uint64_t requested = flush_requested_.load(std::memory_order_acquire);
+        const bool stopping = !running_.load(std::memory_order_acquire);
+
+        // Keep going while there is a backlog; a full batch leaves records behind
+        while (drain(state) > 0) {}
+
+        if (requested > 0) {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                flush_done_ = std::max(flush_done_, requested);
             }
+            flush_cv_.notify_all();
         }
+        if (stopping) break;
+
+        // Access records don't signal; the timeout picks them up
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        cv_.wait_for(lock, kIdleWait, [this] { return wake_.load(std::memory_order_relaxed); });
+        wake_.store(false, std::memory_order_relaxed);
     }
 }
 
 void Logger::configure(const std::string& path) {
     std::lock_guard<std::mutex> lock(config_mutex_);
-    
+
     if (path == "/dev/null") {
         enabled_ = false;
         return;
@@ -85,67 +432,113 @@ void Logger::configure(const std::string& path) {
 
     enabled_ = true;
 
+    if (owns_fd_) ::close(fd_);
+    owns_fd_ = false;
+
     if (path == "stdout" || path.empty()) {
         use_stdout_ = true;
+        fd_ = STDOUT_FILENO;
         return;
     }
 
     use_stdout_ = false;
-    
+
     std::filesystem::path p(path);
     if (p.has_parent_path()) {
         std::filesystem::create_directories(p.parent_path());
     }
 
-    if (file_stream_.is_open()) file_stream_.close();
-    file_stream_.open(path, std::ios::out | std::ios::app);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    owns_fd_ = fd_ >= 0;
 }
 
 void Logger::log(LogLevel level, std::string_view message) {
-    {
-        std::lock_guard<std::mutex> config_lock(config_mutex_);
-        if (!enabled_ || level < level_) return;
-    }
+    if (!enabled_.load(std::memory_order_relaxed) || level < get_level()) return;
 
-    std::string level_str;
-    switch (level) {
-        case LogLevel::DEBUG: level_str = "DEBUG"; break;
-        case LogLevel::INFO:  level_str = "INFO";  break;
-        case LogLevel::WARN:  level_str = "WARN";  break;
-        case LogLevel::ERROR: level_str = "ERROR"; break;
-    }
-
-    std::string msg = level_str + ": " + std::string(message);
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        queue_.push(std::move(msg));
+        messages_.push_back({level, std::time(nullptr), std::string(message)});
+        wake_.store(true, std::memory_order_relaxed);
     }
     cv_.notify_one();
 }
 
+void Logger::set_access_log(AccessLogOptions options) {
+    access_format_.store(options.format, std::memory_order_relaxed);
+    sample_thresholds_[0].store(sample_threshold(options.sample_success), std::memory_order_relaxed);
+    sample_thresholds_[1].store(sample_threshold(options.sample_client_error), std::memory_order_relaxed);
+    sample_thresholds_[2].store(sample_threshold(options.sample_server_error), std::memory_order_relaxed);
+    slow_threshold_us_.store(options.slow_threshold.count(), std::memory_order_relaxed);
+    access_options_ = std::move(options);
+}
+
+bool Logger::sample_access(int status_code, std::chrono::microseconds duration) {
+    if (!enabled_.load(std::memory_order_relaxed) || LogLevel::INFO < get_level()) return false;
+
+    const int64_t slow = slow_threshold_us_.load(std::memory_order_relaxed);
+    if (slow > 0 && duration.count() >= slow) return true;
+
+    const size_t bucket = status_code >= 500 ? 2 : status_code >= 400 ? 1 : 0;
+    const uint64_t threshold = sample_thresholds_[bucket].load(std::memory_order_relaxed);
+    if (threshold >= kSampleAll) return true;
+    if (threshold == 0) return false;
+    return next_random() < threshold;
+}
+
+void Logger::log_access(const AccessLogEntry& entry) {
+    ThreadBuffer& buffer = local_buffer();
+    const bool pushed = buffer.ring.try_push([&](AccessRecord& rec) {
+        rec.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        rec.duration_us = entry.duration.count();
+        rec.bytes_in = entry.bytes_in;
+        rec.bytes_out = entry.bytes_out;
+        rec.status = entry.status;
+        rec.format = access_format_.load(std::memory_order_relaxed);
+        rec.ip_len = copy_field(rec.ip, entry.client_ip);
+        rec.method_len = copy_field(rec.method, entry.method);
+        rec.user_len = copy_field(rec.user, entry.user);
+        rec.route_len = copy_field(rec.route, entry.route);
+        rec.path_len = copy_field(rec.path, entry.path);
+    });
+    if (!pushed) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 void Logger::log_access(std::string_view client_ip,
                        std::string_view method,
                        std::string_view path,
                        int status_code,
                        long long response_time_ms) {
-    {
-        std::lock_guard<std::mutex> config_lock(config_mutex_);
-        if (!enabled_ || LogLevel::INFO < level_) return;
-    }
+    const std::chrono::microseconds duration = std::chrono::milliseconds(response_time_ms);
+    if (!sample_access(status_code, duration)) return;
 
-    std::stringstream ss;
-    ss << "ACCESS: " << client_ip << " " << method << " " << path << " " 
-       << status_code << " " << response_time_ms << "ms";
-    
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        queue_.push(ss.str());
-    }
-    cv_.notify_one();
+    AccessLogEntry entry;
+    entry.client_ip = client_ip;
+    entry.method = method;
+    entry.path = path;
+    entry.status = status_code;
+    entry.duration = duration;
+    log_access(entry);
 }
 
 void Logger::log_error(const std::string& message) {
     log(LogLevel::ERROR, message);
 }
 
+void Logger::flush() {
+    const uint64_t ticket = flush_requested_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    wake_worker();
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    flush_cv_.wait(lock, [&] { return flush_done_ >= ticket; });
+}
+
+uint64_t Logger::dropped() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    uint64_t total = retired_dropped_;
+    for (const auto& buffer : buffers_) total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
 } // namespace blaze
@@ -0,0 +1,295 @@
+#include <blaze/metrics.h>
+#include <blaze/logger.h>
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace blaze {
+
+namespace {
+    // Methods outside this set share one label, so clients can't mint new series
+    std::string_view method_label(std::string_view method) {
+        static constexpr std::array<std::string_view, 7> known = {"GET", "POST", "PUT", "DELETE", "PATCH", "HEAD", "OPTIONS"};
+        for (const auto m : known) {
+            if (m == method) return m;
+        }
+        return "OTHER";
+    }
+
+    struct SeriesView {
+        std::string_view method;
+        std::string_view route;
+        int status;
+    };
+
+    struct SeriesKey {
+        std::string method;
+        std::string route;
+        int status;
+
+        operator SeriesView() const { return {method, route, status}; }
+    };
+
+    struct SeriesHash {
+        using is_transparent = void;
+        size_t operator()(const SeriesView& key) const {
+            size_t h = std::hash<std::string_view>{}(key.route);
+            h ^= std::hash<std::string_view>{}(key.method) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h ^ (static_cast<size_t>(key.status) * 0x9e3779b97f4a7c15ULL);
+        }
+        size_t operator()(const SeriesKey& key) const { return (*this)(SeriesView(key)); }
+    };
+
+    struct SeriesEqual {
+        using is_transparent = void;
+        static bool same(const SeriesView& a, const SeriesView& b) {
+            return a.status == b.status && a.route == b.route && a.method == b.method;
+        }
+        bool operator()(const SeriesKey& a, const SeriesKey& b) const { return same(a, b); }
+        bool operator()(const SeriesKey& a, const SeriesView& b) const { return same(a, b); }
+        bool operator()(const SeriesView& a, const SeriesKey& b) const { return same(a, b); }
+    };
+
+    // Seconds in plain decimal ("0.0001", not "1e-04")
+    void append_number(std::string& out, double value) {
+        char buf[48];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed);
+        out.append(buf, end);
+    }
+
+    void append_number(std::string& out, uint64_t value) {
+        char buf[24];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, end);
+    }
+
+    void append_number(std::string& out, int64_t value) {
+        char buf[24];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, end);
+    }
+
+    // Writes _bucket, _sum and _count lines; `labels` is the label list without braces
+    void write_histogram(std::string& out, std::string_view name, const std::string& labels,
+                         const Histogram::Snapshot& snap) {
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < Histogram::kBuckets; ++i) {
+            cumulative += snap.buckets[i];
+            out += name;
+            out += "_bucket{";
+            out += labels;
+            out += labels.empty() ? "le=\"" : ",le=\"";
+            if (i < Histogram::kBoundsUs.size()) append_number(out, static_cast<double>(Histogram::kBoundsUs[i]) / 1e6);
+            else out += "+Inf";
+            out += "\"} ";
+            append_number(out, cumulative);
+            out += '\n';
+        }
+        out += name;
+        out += "_sum{";
+        out += labels;
+        out += "} ";
+        append_number(out, static_cast<double>(snap.sum_us) / 1e6);
+        out += '\n';
+        out += name;
+        out += "_count{";
+        out += labels;
+        out += "} ";
+        append_number(out, snap.count);
+        out += '\n';
+    }
+}
+
+// ---- Histogram ----
+
+void Histogram::observe(std::chrono::microseconds duration) {
+    const int64_t us = std::max<int64_t>(duration.count(), 0);
+    const size_t bucket = static_cast<size_t>(
+        std::lower_bound(kBoundsUs.begin(), kBoundsUs.end(), us) - kBoundsUs.begin());
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        snap.count += snap.buckets[i];
+    }
+    snap.sum_us = sum_us_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+void Histogram::Snapshot::merge(const Snapshot& other) {
+    for (size_t i = 0; i < kBuckets; ++i) buckets[i] += other.buckets[i];
+    count += other.count;
+    sum_us += other.sum_us;
+}
+
+// ---- Metrics ----
+
+struct Metrics::Series {
+    Histogram latency;
+};
+
+struct Metrics::ThreadTable {
+    // The owning thread reads without locking; inserts and render() take the lock
+    std::mutex mutex;
+    std::unordered_map<SeriesKey, std::unique_ptr<Series>, SeriesHash, SeriesEqual> series;
+};
+
+Metrics& Metrics::instance() {
+    static Metrics instance;
+    return instance;
+}
+
+Metrics::ThreadTable& Metrics::local_table() {
+    // Tables outlive their threads; their counts are still part of the totals
+    thread_local std::shared_ptr<ThreadTable> table;
+    if (!table) {
+        table = std::make_shared<ThreadTable>();
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        tables_.push_back(table);
+    }
+    return *table;
+}
+
+void Metrics::observe_request(std::string_view method, std::string_view route, int status,
+                              std::chrono::microseconds duration) {
+    ThreadTable& table = local_table();
+    const SeriesView key{method_label(method), route, status};
+
+    auto it = table.series.find(key);
+    if (it == table.series.end()) {
+        std::lock_guard<std::mutex> lock(table.mutex);
+        it = table.series.emplace(SeriesKey{std::string(key.method), std::string(route), status},
+                                  std::make_unique<Series>()).first;
+    }
+    it->second->latency.observe(duration);
+}
+
+std::shared_ptr<PoolMetrics> Metrics::register_pool(std::string driver) {
+    auto pool = std::make_shared<PoolMetrics>();
+    pool->driver = std::move(driver);
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    pool->id = std::to_string(next_pool_id_++);
+    std::erase_if(pools_, [](const auto& weak) { return weak.expired(); });
+    pools_.push_back(pool);
+    return pool;
+}
+
+void Metrics::write_header(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void Metrics::write_label(std::string& out, std::string_view name, std::string_view value, bool first) {
+    if (!first) out += ',';
+    out += name;
+    out += "=\"";
+    for (const char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+std::string Metrics::render() {
+    // Merge every thread's series, sorted so output is stable between scrapes
+    std::map<std::tuple<std::string, std::string, int>, Histogram::Snapshot> requests;
+    std::vector<std::shared_ptr<PoolMetrics>> pools;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        for (const auto& table : tables_) {
+            std::lock_guard<std::mutex> table_lock(table->mutex);
+            for (const auto& [key, series] : table->series) {
+                requests[{key.method, key.route, key.status}].merge(series->latency.snapshot());
+            }
+        }
+        for (const auto& weak : pools_) {
+            if (auto pool = weak.lock()) pools.push_back(std::move(pool));
+        }
+    }
+
+    std::string out;
+    std::vector<std::string> labels;
+    labels.reserve(requests.size());
+    for (const auto& [key, snap] : requests) {
+        std::string l;
+        write_label(l, "method", std::get<0>(key), true);
+        write_label(l, "route", std::get<1>(key).empty() ? "unmatched" : std::get<1>(key), false);
+        write_label(l, "status", std::to_string(std::get<2>(key)), false);
+        labels.push_back(std::move(l));
+    }
+
+    write_header(out, "blaze_http_requests_total", "counter", "HTTP requests handled, by method, route template and status.");
+    size_t i = 0;
+    for (const auto& [key, snap] : requests) {
+        out += "blaze_http_requests_total{";
+        out += labels[i++];
+        out += "} ";
+        append_number(out, snap.count);
+        out += '\n';
+    }
+
+    write_header(out, "blaze_http_request_duration_seconds", "histogram", "Time from routing a request to its response being ready.");
+    i = 0;
+    for (const auto& [key, snap] : requests) {
+        write_histogram(out, "blaze_http_request_duration_seconds", labels[i++], snap);
+    }
+
+    if (!pools.empty()) {
+        std::vector<std::string> pool_labels;
+        for (const auto& pool : pools) {
+            std::string l;
+            write_label(l, "driver", pool->driver, true);
+            write_label(l, "pool", pool->id, false);
+            pool_labels.push_back(std::move(l));
+        }
+
+        auto gauge = [&](std::string_view name, std::string_view help, std::atomic<int64_t> PoolMetrics::*field) {
+            write_header(out, name, "gauge", help);
+            for (size_t p = 0; p < pools.size(); ++p) {
+                out += name;
+                out += '{';
+                out += pool_labels[p];
+                out += "} ";
+                append_number(out, ((*pools[p]).*field).load(std::memory_order_relaxed));
+                out += '\n';
+            }
+        };
+        gauge("blaze_db_pool_connections", "Connections opened by the pool.", &PoolMetrics::size);
+        gauge("blaze_db_pool_in_use", "Connections currently checked out.", &PoolMetrics::in_use);
+        gauge("blaze_db_pool_waiters", "Callers waiting for a free connection.", &PoolMetrics::waiters);
+
+        write_header(out, "blaze_db_pool_acquire_seconds", "histogram", "Time spent waiting to check out a connection.");
+        for (size_t p = 0; p < pools.size(); ++p) {
+            write_histogram(out, "blaze_db_pool_acquire_seconds", pool_labels[p], pools[p]->acquire.snapshot());
+        }
+    }
+
+    write_header(out, "blaze_log_dropped_records_total", "counter", "Access log records dropped because a buffer was full.");
+    out += "blaze_log_dropped_records_total ";
+    append_number(out, Logger::instance().dropped());
+    out += '\n';
+
+    return out;
+}
+
+} // namespace blaze
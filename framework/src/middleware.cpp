@@ -1,19 +1,106 @@
 #include <blaze/middleware.h>
 #include <blaze/util/string.h>
+#include <blaze/util/compression.h>
+#include <blaze/util/http_date.h>
+#include <blaze/util/jwt_cache.h>
+#include <atomic>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
+#include <list>
 #include <shared_mutex>
+#include <unordered_set>
 
 namespace blaze::middleware {
 
 namespace fs = std::filesystem;
+namespace beast = boost::beast;
+namespace http = beast::http;
 
 // Thread-safe cache structure for static files
 struct FileCache {
     std::shared_mutex mtx; // Reader-Writer Lock
     std::unordered_map<std::string, std::string> type_map;
-    // We no longer cache content here since we use file_body for streaming,
-    // but we can cache MIME types or small file metadata if needed.
+};
+
+// Validators for one version of a file, derived from its mtime and size
+struct Validators {
+    std::string etag;           // "<mtime>-<size>", without the quotes
+    std::string last_modified;
+    std::time_t modified = 0;
+};
+
+// A small file held in memory with its precompressed variants and validators
+struct CachedAsset {
+    fs::path file;
+    fs::file_time_type mtime;
+    uintmax_t size = 0;
+    std::string content_type;
+    Validators validators;
+    std::string identity;
+    std::string gzip;           // Empty when compression didn't pay off
+    std::string brotli;
+    mutable std::atomic<std::chrono::steady_clock::rep> checked{0}; // Last mtime check
+
+    size_t bytes() const { return identity.size() + gzip.size() + brotli.size(); }
+};
+
+// Bounded LRU of CachedAssets keyed by request path (in normal form, see is_normal_path());
+// the front is the most recently used
+class AssetCache {
+public:
+    explicit AssetCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    std::shared_ptr<const CachedAsset> find(const std::string& key) {
+        std::lock_guard lock(mtx_);
+        auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    void insert(const std::string& key, std::shared_ptr<const CachedAsset> asset) {
+        std::lock_guard lock(mtx_);
+        remove(key);
+        bytes_ += asset->bytes();
+        lru_.emplace_front(key, std::move(asset));
+        index_[key] = lru_.begin();
+        while (bytes_ > max_bytes_ && !lru_.empty()) remove(lru_.back().first);
+    }
+
+    void erase(const std::string& key) {
+        std::lock_guard lock(mtx_);
+        remove(key);
+    }
+
+    // Claims the load of `key`; false while another request is loading it
+    bool claim(const std::string& key) {
+        std::lock_guard lock(mtx_);
+        return loading_.insert(key).second;
+    }
+
+    void release(const std::string& key) {
+        std::lock_guard lock(mtx_);
+        loading_.erase(key);
+    }
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const CachedAsset>>;
+
+    void remove(const std::string& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return;
+        bytes_ -= it->second->second->bytes();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    std::mutex mtx_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::unordered_set<std::string> loading_;
+    size_t bytes_ = 0;
+    const size_t max_bytes_;
 };
 
 static std::string get_mime_type(const std::string& path) {
@@ -68,8 +155,288 @@ Middleware cors(const std::string& origin, const std::string& methods, const std
     };
 }
 
-Middleware static_files(const std::string& root_dir, bool serve_index) {
+namespace {
+    Validators make_validators(const fs::file_time_type mtime, const uintmax_t size) {
+        Validators v;
+        const auto modified = std::chrono::file_clock::to_sys(mtime);
+        const auto ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(modified.time_since_epoch()).count();
+        char hex[40];
+        const int n = std::snprintf(hex, sizeof(hex), "%llx-%llx",
+                                    static_cast<unsigned long long>(ticks), static_cast<unsigned long long>(size));
+        v.etag.assign(hex, static_cast<size_t>(n));
+
+        v.modified = std::chrono::system_clock::to_time_t(
+            std::chrono::time_point_cast<std::chrono::system_clock::duration>(modified));
+        v.last_modified.resize(HttpDate::kLength);
+        HttpDate::format(v.modified, v.last_modified.data());
+        return v;
+    }
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    // "x-gzip" names the same file as "x", compressed by compression(); see tag_etag()
+    bool is_coded_variant(std::string_view tag, std::string_view etag) {
+        if (etag.size() < 2) return false;
+        const std::string_view open = etag.substr(0, etag.size() - 1); // Without the closing quote
+        for (const std::string_view suffix : {"-gzip\"", "-br\"", "-deflate\""}) {
+            if (tag.size() == open.size() + suffix.size() && tag.starts_with(open) && tag.ends_with(suffix)) return true;
+        }
+        return false;
+    }
+
+    // If-None-Match uses weak comparison: W/"x" matches "x", and so does "x-gzip". Returns
+    // the matching tag, to send back with the 304, or an empty view.
+    std::string_view etag_list_match(std::string_view list, std::string_view etag) {
+        while (!list.empty()) {
+            const size_t comma = list.find(',');
+            std::string_view tag = trim(list.substr(0, comma));
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            if (tag == "*") return etag;
+            if (tag.substr(0, 2) == "W/") tag.remove_prefix(2);
+            if (tag == etag || is_coded_variant(tag, etag)) return tag;
+        }
+        return {};
+    }
+
+    // RFC 9110, 13.2.2: If-None-Match takes precedence; If-Modified-Since is only used without it.
+    // Returns the validator to answer the 304 with, or an empty view if the request goes ahead.
+    std::string_view not_modified(const Request& req, std::string_view etag, const std::time_t modified) {
+        const auto none_match = req.get_header("If-None-Match");
+        if (!none_match.empty()) return etag_list_match(none_match, etag);
+
+        const auto since = req.get_header("If-Modified-Since");
+        if (since.empty()) return {};
+        const auto date = HttpDate::parse(since);
+        return date && modified <= *date ? etag : std::string_view();
+    }
+
+    // If-Range must match exactly: a strong ETag or the Last-Modified date
+    bool if_range_matches(const Request& req, std::string_view etag, std::string_view last_modified) {
+        const auto validator = req.get_header("If-Range");
+        if (validator.empty()) return true;
+        if (validator.front() == '"') return validator == etag;
+        return validator == last_modified;
+    }
+
+    struct ByteRange {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    // More ranges than this and the Range header is ignored, so one request can't fan out into many parts
+    constexpr size_t kMaxRanges = 16;
+
+    // Parses "bytes=..." against `size`. nullopt means "ignore the header and send everything";
+    // an empty list means no range is satisfiable (416).
+    std::optional<std::vector<ByteRange>> parse_ranges(std::string_view header, const uint64_t size) {
+        if (header.substr(0, 6) != "bytes=") return std::nullopt;
+        header.remove_prefix(6);
+
+        auto number = [](std::string_view digits, uint64_t& out) {
+            if (digits.empty()) return false;
+            const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), out);
+            return ec == std::errc() && end == digits.data() + digits.size();
+        };
+
+        std::vector<ByteRange> ranges;
+        size_t specs = 0;
+        while (!header.empty()) {
+            const size_t comma = header.find(',');
+            const std::string_view spec = trim(header.substr(0, comma));
+            header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+            if (spec.empty()) continue;
+            if (++specs > kMaxRanges) return std::nullopt;
+
+            const size_t dash = spec.find('-');
+            if (dash == std::string_view::npos) return std::nullopt;
+            const std::string_view first = spec.substr(0, dash);
+            const std::string_view last = spec.substr(dash + 1);
+
+            uint64_t a = 0, b = 0;
+            if (first.empty()) {
+                // Suffix range: the final `b` bytes
+                if (!number(last, b)) return std::nullopt;
+                if (b > 0 && size > 0) ranges.push_back({size - std::min(b, size), std::min(b, size)});
+                continue;
+            }
+            if (!number(first, a)) return std::nullopt;
+            if (last.empty()) {
+                b = size == 0 ? 0 : size - 1;
+            } else if (!number(last, b) || b < a) {
+                return std::nullopt;
+            }
+            if (a < size) ranges.push_back({a, std::min(b, size - 1) - a + 1});
+        }
+        if (specs == 0) return std::nullopt;
+        return ranges;
+    }
+
+    std::string content_range(const ByteRange& range, const uint64_t size) {
+        return "bytes " + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1) +
+               "/" + std::to_string(size);
+    }
+
+    // What the conditional and Range headers leave to send for one representation
+    enum class Selection { full, partial, done };
+
+    // Answers 304 and 416 itself (`done`). For `partial` it sets 206 and the range headers and
+    // fills `parts`/`trailer`; a multipart/byteranges body puts each part's headers in the prefix.
+    Selection select(const Request& req, Response& res, const std::string& etag, const Validators& v,
+                     const uint64_t size, const std::string& content_type, const bool ranges_allowed,
+                     std::vector<FilePart>& parts, std::string& trailer) {
+        res.header("Last-Modified", v.last_modified);
+        res.header("ETag", etag);
+        res.header("Accept-Ranges", "bytes");
+
+        if (const std::string_view matched = not_modified(req, etag, v.modified); !matched.empty()) {
+            // A compressed response's tag, so the client's stored copy stays valid
+            if (matched != etag) res.header("ETag", std::string(matched));
+            res.status(304);
+            return Selection::done;
+        }
+
+        const auto range_header = req.get_header("Range");
+        if (!ranges_allowed || range_header.empty() || !if_range_matches(req, etag, v.last_modified)) {
+            return Selection::full;
+        }
+        const auto ranges = parse_ranges(range_header, size);
+        if (!ranges) return Selection::full;
+
+        if (ranges->empty()) {
+            res.status(416).header("Content-Range", "bytes */" + std::to_string(size)).send("");
+            return Selection::done;
+        }
+
+        res.status(206);
+        if (ranges->size() == 1) {
+            res.header("Content-Range", content_range(ranges->front(), size));
+            parts.push_back({{}, ranges->front().offset, ranges->front().length});
+            return Selection::partial;
+        }
+
+        const std::string boundary = "blaze-" + v.etag;
+        res.header("Content-Type", "multipart/byteranges; boundary=" + boundary);
+        for (const auto& range : *ranges) {
+            std::string prefix = parts.empty() ? "--" : "\r\n--";
+            prefix.append(boundary).append("\r\nContent-Type: ").append(content_type)
+                  .append("\r\nContent-Range: ").append(content_range(range, size)).append("\r\n\r\n");
+            parts.push_back({std::move(prefix), range.offset, range.length});
+        }
+        trailer = "\r\n--" + boundary + "--\r\n";
+        return Selection::partial;
+    }
+
+    // Only paths without "." or ".." segments, or empty ones bar a trailing slash, are cache
+    // keys. Other spellings of a path still resolve, but can't each add a cache entry.
+    bool is_normal_path(std::string_view path) {
+        if (path.empty() || path.front() != '/') return false;
+        path.remove_prefix(1);
+        while (!path.empty()) {
+            const size_t slash = path.find('/');
+            const std::string_view segment = path.substr(0, slash);
+            if (segment.empty() || segment == "." || segment == "..") return false;
+            if (slash == std::string_view::npos) break;
+            path.remove_prefix(slash + 1);
+        }
+        return true;
+    }
+
+    // Levels for the variants built on the request that loads a file; the top levels cost
+    // several times the CPU for a few percent
+    constexpr int kPrecompressLevel = 6;
+    constexpr int kPrecompressQuality = 5;
+
+    std::chrono::steady_clock::rep steady_now() {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    // Reads and precompresses `file`; nullptr if it changed size or can't be read
+    std::shared_ptr<CachedAsset> load_asset(const fs::path& file, const fs::file_time_type mtime,
+                                            const uintmax_t size, std::string content_type) {
+        auto asset = std::make_shared<CachedAsset>();
+        std::ifstream in(file, std::ios::binary);
+        asset->identity.resize(size);
+        if (!in.read(asset->identity.data(), static_cast<std::streamsize>(size)) || in.peek() != EOF) return nullptr;
+
+        asset->file = file;
+        asset->mtime = mtime;
+        asset->size = size;
+        asset->validators = make_validators(mtime, size);
+
+        // Variants are only kept when they save at least an eighth
+        if (util::is_compressible(content_type) && size >= 256) {
+            const size_t worthwhile = size - size / 8;
+            asset->gzip = util::gzip_compress(asset->identity, kPrecompressLevel);
+            if (asset->gzip.size() > worthwhile) asset->gzip.clear();
+            if (util::brotli_available()) {
+                asset->brotli = util::brotli_compress(asset->identity, kPrecompressQuality);
+                if (asset->brotli.size() > worthwhile) asset->brotli.clear();
+            }
+        }
+        asset->content_type = std::move(content_type);
+        asset->checked = steady_now();
+        return asset;
+    }
+
+    // Still matches the file on disk? Re-checks at most once per `interval`.
+    bool is_fresh(const CachedAsset& asset, const std::chrono::steady_clock::duration interval) {
+        const auto now = steady_now();
+        if (now - asset.checked.load(std::memory_order_relaxed) < interval.count()) return true;
+
+        std::error_code ec;
+        const auto mtime = fs::last_write_time(asset.file, ec);
+        if (ec || mtime != asset.mtime || fs::file_size(asset.file, ec) != asset.size || ec) return false;
+        asset.checked.store(now, std::memory_order_relaxed);
+        return true;
+    }
+
+    void send_asset(const CachedAsset& asset, const Request& req, Response& res) {
+        // Ranges are byte offsets into the identity body, so a Range request is never compressed
+        const std::string_view accept_encoding = req.has_header("Range") ? "" : req.get_header("Accept-Encoding");
+        const std::string* body = &asset.identity;
+        std::string coding;
+        if (!asset.brotli.empty() && util::accepts_encoding(accept_encoding, "br")) {
+            body = &asset.brotli;
+            coding = "br";
+        } else if (!asset.gzip.empty() && util::accepts_encoding(accept_encoding, "gzip")) {
+            body = &asset.gzip;
+            coding = "gzip";
+        }
+
+        res.header("Content-Type", asset.content_type);
+        if (!asset.gzip.empty() || !asset.brotli.empty()) res.header("Vary", "Accept-Encoding");
+        if (!coding.empty()) res.header("Content-Encoding", coding);
+
+        // Each representation needs its own strong validator
+        const Validators& v = asset.validators;
+        const std::string etag = "\"" + v.etag + (coding.empty() ? "" : "-" + coding) + "\"";
+        std::vector<FilePart> parts;
+        std::string trailer;
+        switch (select(req, res, etag, v, asset.size, asset.content_type, coding.empty(), parts, trailer)) {
+            case Selection::done:
+                return;
+            case Selection::full:
+                res.send(*body);
+                return;
+            case Selection::partial: {
+                std::string partial;
+                for (const auto& part : parts) {
+                    partial.append(part.prefix).append(*body, part.offset, part.length);
+                }
+                res.send(partial.append(trailer));
+                return;
+            }
+        }
+    }
+}
+
+Middleware static_files(const std::string& root_dir, bool serve_index, StaticCacheOptions cache_options) {
     auto cache = std::make_shared<FileCache>();
+    auto assets = std::make_shared<AssetCache>(cache_options.max_bytes);
     fs::path abs_root;
     try {
         abs_root = fs::canonical(root_dir);
@@ -77,13 +444,26 @@ Middleware static_files(const std::string& root_dir, bool serve_index) {
         abs_root = fs::absolute(root_dir);
     }
 
-    return [abs_root, serve_index, cache](Request& req, Response& res, auto next) -> Async<void> {
+    return [abs_root, serve_index, cache, assets, cache_options](Request& req, Response& res, auto next) -> Async<void> {
         if (req.method != "GET") {
             co_await next();
             co_return;
         }
 
         std::string decoded_path = util::url_decode(req.path);
+        const bool cacheable = cache_options.max_bytes > 0 && is_normal_path(decoded_path);
+
+        // Hot path: a cached asset, served without touching the filesystem
+        if (cacheable) {
+            if (auto asset = assets->find(decoded_path)) {
+                if (is_fresh(*asset, cache_options.revalidate)) {
+                    send_asset(*asset, req, res);
+                    co_return;
+                }
+                assets->erase(decoded_path);
+            }
+        }
+
         fs::path requested_path = abs_root / decoded_path.substr(1);
 
         std::error_code ec;
@@ -127,12 +507,171 @@ Middleware static_files(const std::string& root_dir, bool serve_index) {
             cache->type_map[file_real_path] = content_type;
         }
 
+        // Small files go into the cache; the rest are streamed from disk, as is a small file
+        // while another request is loading it
+        const auto size = fs::file_size(canonical_path, ec);
+        const auto mtime = ec ? fs::file_time_type() : fs::last_write_time(canonical_path, ec);
+        if (cacheable && !ec && size <= cache_options.max_file_size && size <= cache_options.max_bytes &&
+            assets->claim(decoded_path)) {
+            std::shared_ptr<CachedAsset> asset;
+            try {
+                asset = load_asset(canonical_path, mtime, size, content_type);
+                if (asset) assets->insert(decoded_path, asset);
+            } catch (...) {
+                assets->release(decoded_path);
+                throw;
+            }
+            assets->release(decoded_path);
+            if (asset) {
+                send_asset(*asset, req, res);
+                co_return;
+            }
+        }
+
         res.header("Content-Type", content_type);
-        res.file(file_real_path); // ZERO-COPY STREAMING!
+        if (ec) {
+            res.file(file_real_path); // ZERO-COPY STREAMING!
+            co_return;
+        }
+
+        const Validators v = make_validators(mtime, size);
+        std::vector<FilePart> parts;
+        std::string trailer;
+        switch (select(req, res, "\"" + v.etag + "\"", v, size, content_type, true, parts, trailer)) {
+            case Selection::done:
+                break;
+            case Selection::full:
+                res.file(file_real_path);
+                break;
+            case Selection::partial:
+                res.file(file_real_path, std::move(parts), std::move(trailer));
+                break;
+        }
         co_return;
     };
 }
 
+namespace {
+    // Re-encodes a streamed body on the fly. Event streams flush on every write so each
+    // event reaches the client at once; bulk data lets the compressor buffer.
+    class CompressingWriter : public ResponseWriter {
+    public:
+        CompressingWriter(ResponseWriter& out, util::ContentCoding coding, int level, bool flush)
+            : out_(out), compressor_(coding, level), flush_(flush) {}
+
+        Async<void> write(std::string_view chunk) override {
+            buffer_.clear();
+            compressor_.write(chunk, buffer_, flush_);
+            if (!buffer_.empty()) co_await out_.write(buffer_);
+        }
+
+        Async<void> finish() {
+            buffer_.clear();
+            compressor_.finish(buffer_);
+            co_await out_.write(buffer_);
+        }
+
+    private:
+        ResponseWriter& out_;
+        util::StreamCompressor compressor_;
+        std::string buffer_;
+        bool flush_;
+    };
+
+    // Server preference, among the codings the client accepts
+    util::ContentCoding negotiate(std::string_view accept_encoding, const CompressionOptions& options) {
+        if (accept_encoding.empty()) return util::ContentCoding::identity;
+        if (options.brotli && util::brotli_available() && util::accepts_encoding(accept_encoding, "br")) {
+            return util::ContentCoding::br;
+        }
+        if (util::accepts_encoding(accept_encoding, "gzip")) return util::ContentCoding::gzip;
+        if (util::accepts_encoding(accept_encoding, "deflate")) return util::ContentCoding::deflate;
+        return util::ContentCoding::identity;
+    }
+
+    // "abc" becomes "abc-gzip": the encoded body is a different representation
+    void tag_etag(http::response<http::string_body>& res, std::string_view coding) {
+        const auto it = res.find(http::field::etag);
+        if (it == res.end()) return;
+        std::string etag(it->value());
+        if (etag.size() < 2 || etag.back() != '"') return;
+        etag.insert(etag.size() - 1, "-" + std::string(coding));
+        res.set(http::field::etag, etag);
+    }
+
+    void add_vary(http::response<http::string_body>& res) {
+        const auto it = res.find(http::field::vary);
+        if (it == res.end()) {
+            res.set(http::field::vary, "Accept-Encoding");
+        } else if (it->value().find("Accept-Encoding") == beast::string_view::npos && it->value() != "*") {
+            res.set(http::field::vary, std::string(it->value()) + ", Accept-Encoding");
+        }
+    }
+}
+
+Middleware compression(CompressionOptions options) {
+    return [options](Request& req, Response& res, auto next) -> Async<void> {
+        co_await next();
+
+        auto& beast_res = res.get_beast_response();
+        const unsigned status = beast_res.result_int();
+        if (req.method == "HEAD" || status < 200 || status == 204 || status == 206 || status == 304) co_return;
+        if (beast_res.find(http::field::content_encoding) != beast_res.end()) co_return;
+        if (beast_res[http::field::cache_control].find("no-transform") != beast::string_view::npos) co_return;
+
+        const auto type = beast_res[http::field::content_type];
+        if (!util::is_compressible(std::string_view(type.data(), type.size()))) co_return;
+
+        // Complete bodies below the threshold are never compressed, so they don't vary
+        const bool whole_file = res.is_file() && res.get_file_parts().empty();
+        std::uintmax_t file_size = 0;
+        if (whole_file) {
+            std::error_code ec;
+            file_size = fs::file_size(res.get_file_path(), ec);
+            if (ec || file_size < options.min_size) co_return;
+        } else if (res.is_file() || (!res.is_stream() && beast_res.body().size() < options.min_size)) {
+            co_return;
+        }
+
+        add_vary(beast_res);
+        const auto coding = negotiate(req.get_header("Accept-Encoding"), options);
+        if (coding == util::ContentCoding::identity) co_return;
+
+        const int level = coding == util::ContentCoding::br ? options.brotli_quality : options.level;
+        const std::string name(util::coding_name(coding));
+
+        if (res.is_stream()) {
+            const bool events = type.substr(0, 17) == "text/event-stream";
+            res.stream([producer = res.get_stream(), coding, level, events](ResponseWriter& out) -> Async<void> {
+                CompressingWriter writer(out, coding, level, events);
+                co_await producer(writer);
+                co_await writer.finish();
+            });
+        } else if (whole_file) {
+            res.stream([path = res.get_file_path(), coding, level](ResponseWriter& out) -> Async<void> {
+                std::ifstream in(path, std::ios::binary);
+                if (!in) throw std::runtime_error("compression: cannot open " + path);
+                CompressingWriter writer(out, coding, level, false);
+                std::string chunk(64 * 1024, '\0');
+                while (in.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || in.gcount() > 0) {
+                    co_await writer.write(std::string_view(chunk.data(), static_cast<size_t>(in.gcount())));
+                }
+                co_await writer.finish();
+            });
+            beast_res.erase(http::field::accept_ranges);
+        } else {
+            std::string packed;
+            util::compress(coding, beast_res.body(), level, packed);
+            if (packed.size() >= beast_res.body().size()) co_return;
+            beast_res.body() = std::move(packed);
+            beast_res.prepare_payload();
+        }
+
+        beast_res.set(http::field::content_encoding, name);
+        tag_etag(beast_res, name);
+    };
+}
+
 Middleware limit_body_size(size_t max_bytes) {
     return [max_bytes](Request& req, Response& res, auto next) -> Async<void> {
         if (req.body.size() > max_bytes) {
@@ -147,9 +686,10 @@ Middleware limit_body_size(size_t max_bytes) {
     };
 }
 
-Middleware jwt_auth(const std::string_view secret) {
+Middleware jwt_auth(const std::string_view secret, size_t cache_entries) {
     std::string secret_str(secret);
-    return [secret_str](Request& req, Response& res, auto next) -> Async<void> {
+    auto cache = cache_entries ? std::make_shared<JwtCache>(cache_entries) : nullptr;
+    return [secret_str, cache](Request& req, Response& res, auto next) -> Async<void> {
         if (!req.has_header("Authorization")) {
             co_await next();
             co_return;
@@ -161,54 +701,74 @@ Middleware jwt_auth(const std::string_view secret) {
         }
 
         std::string_view token = auth.substr(7);
-        try {
-            auto payload = crypto::jwt_verify(token, secret_str);
-            req.set_user(Json(payload));
-        } catch (const std::exception& e) {
-            throw Unauthorized(std::string("Invalid Token: ") + e.what());
+        if (auto claims = cache ? cache->find(token) : std::nullopt) {
+            req.set_user(std::move(*claims));
+        } else {
+            // An invalid token leaves the request anonymous rather than failing it
+            JwtError error = JwtError::None;
+            auto payload = crypto::jwt_verify(token, secret_str, &error);
+            if (error == JwtError::None) {
+                if (cache) cache->insert(token, payload);
+                req.set_user(std::move(payload));
+            }
         }
 
         co_await next();
     };
 }
 
-Middleware rate_limit(int max_requests, int window_seconds) {
-    struct ClientState {
-        int count;
-        std::chrono::steady_clock::time_point window_start;
+RateLimitKey key_by_ip() {
+    return [](const Request& req) {
+        return req.client_ip().empty() ? std::string("unknown") : std::string(req.client_ip());
     };
-    
-    auto state = std::make_shared<std::pair<std::mutex, std::unordered_map<std::string, ClientState>>>();
+}
+
+RateLimitKey key_by_header(std::string header) {
+    return [header = std::move(header), by_ip = key_by_ip()](const Request& req) {
+        const std::string_view value = req.get_header(header);
+        return value.empty() ? by_ip(req) : "key:" + std::string(value);
+    };
+}
 
-    return [max_requests, window_seconds, state](Request& req, Response& res, auto next) -> Async<void> {
-        std::string ip = "unknown";
-        if (auto ip_ctx = req.get_opt<std::string>("client_ip")) {
-            ip = *ip_ctx;
+RateLimitKey key_by_user(std::string claim) {
+    return [claim = std::move(claim), by_ip = key_by_ip()](const Request& req) {
+        if (req.is_authenticated() && req.user().has(claim)) {
+            std::string id = req.user()[claim].as<std::string>();
+            if (!id.empty()) return "user:" + id;
         }
+        return by_ip(req);
+    };
+}
 
-        {
-            std::lock_guard lock(state->first);
-            auto& clients = state->second;
-            const auto now = std::chrono::steady_clock::now();
-            auto& client = clients[ip];
-
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - client.window_start).count();
-            if (elapsed > window_seconds) {
-                client.count = 0;
-                client.window_start = now;
-            }
+Middleware rate_limit(RateLimitOptions options) {
+    auto backend = std::make_shared<LocalRateLimitBackend>(options.max_requests, options.window);
+    return rate_limit(std::move(backend), options.key ? std::move(options.key) : key_by_ip());
+}
 
-            if (client.count >= max_requests) {
-                res.status(429).json({
-                    {"error", "Too Many Requests"},
-                    {"retry_after_seconds", window_seconds - elapsed}
-                });
+Middleware rate_limit(std::shared_ptr<RateLimitBackend> backend, RateLimitKey key) {
+    return [backend = std::move(backend), key = std::move(key)](Request& req, Response& res, auto next) -> Async<void> {
+        const std::string client = key(req);
+        if (!client.empty()) {
+            // Local state answers almost every request; only the rest wait on the backend
+            auto decision = backend->try_acquire(client);
+            if (!decision) decision = co_await backend->acquire(client);
+            if (!decision->allowed) {
+                const auto retry = std::chrono::ceil<std::chrono::seconds>(decision->retry_after).count();
+                res.status(429)
+                   .header("Retry-After", std::to_string(retry))
+                   .json({
+                       {"error", "Too Many Requests"},
+                       {"retry_after_seconds", retry}
+                   });
                 co_return;
             }
-            client.count++;
         }
         co_await next();
     };
 }
 
+Middleware rate_limit(int max_requests, int window_seconds) {
+    return rate_limit(RateLimitOptions{max_requests, std::chrono::seconds(window_seconds)});
+}
+
 } // namespace blaze::middleware
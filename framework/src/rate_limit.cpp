@@ -0,0 +1,282 @@
+#include <blaze/rate_limit.h>
+#include <blaze/app.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace blaze {
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+    // RESP array of bulk strings, the form Redis accepts every command in
+    void append_command(std::string& out, std::initializer_list<std::string_view> args) {
+        out += '*';
+        out += std::to_string(args.size());
+        out += "\r\n";
+        for (const std::string_view arg : args) {
+            out += '$';
+            out += std::to_string(arg.size());
+            out += "\r\n";
+            out += arg;
+            out += "\r\n";
+        }
+    }
+
+    // Current fixed window and the time left in it, on the wall clock every instance shares
+    std::pair<int64_t, std::chrono::milliseconds> current_window(std::chrono::seconds window) {
+        const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        const int64_t length = std::chrono::duration_cast<std::chrono::milliseconds>(window).count();
+        const int64_t index = now / length;
+        return {index, std::chrono::milliseconds((index + 1) * length - now)};
+    }
+}
+
+// ---- LocalRateLimitBackend ----
+
+LocalRateLimitBackend::LocalRateLimitBackend(int max_requests, std::chrono::seconds window)
+    : limiter_(max_requests, window) {}
+
+std::optional<RateLimitBackend::Decision> LocalRateLimitBackend::try_acquire(std::string_view key) {
+    return limiter_.acquire(key);
+}
+
+boost::asio::awaitable<RateLimitBackend::Decision> LocalRateLimitBackend::acquire(std::string key) {
+    co_return limiter_.acquire(key);
+}
+
+// ---- RedisRateLimitBackend ----
+
+// The socket, its timeout and every round trip on them run on the connection's own strand,
+// so the timeout can't close the socket while another thread is in a call on it
+struct RedisRateLimitBackend::Connection {
+    explicit Connection(net::io_context& ctx) : strand(net::make_strand(ctx)), socket(strand), timer(strand) {}
+
+    net::strand<net::io_context::executor_type> strand;
+    tcp::socket socket;
+    net::steady_timer timer; // Closes the socket if a round trip overruns
+    std::string buffer;
+
+    void arm(std::chrono::milliseconds timeout, const std::shared_ptr<Connection>& self) {
+        timer.expires_after(timeout);
+        timer.async_wait([self](const boost::system::error_code& ec) {
+            // Cancelled, or disarmed after this wait had already completed
+            if (ec || self->timer.expiry() > std::chrono::steady_clock::now()) return;
+            boost::system::error_code ignored;
+            self->socket.close(ignored);
+        });
+    }
+
+    void disarm() { timer.expires_at(net::steady_timer::time_point::max()); }
+
+    // Reads one reply line; integers and simple strings are all the limiter needs
+    net::awaitable<std::string> read_reply() {
+        const size_t n = co_await net::async_read_until(socket, net::dynamic_buffer(buffer), "\r\n", net::use_awaitable);
+        std::string line = buffer.substr(0, n - 2);
+        buffer.erase(0, n);
+        if (line.empty()) throw std::runtime_error("Redis: empty reply");
+        if (line[0] == '-') throw std::runtime_error("Redis: " + line.substr(1));
+        if (line[0] != ':' && line[0] != '+') throw std::runtime_error("Redis: unexpected reply " + line);
+        co_return line.substr(1);
+    }
+
+    // Sends `request`, connecting first if need be, and returns the first of its `replies`.
+    // Runs on the strand; the timeout covers the whole call.
+    static net::awaitable<std::string> round_trip(std::shared_ptr<Connection> self, const RedisRateLimitOptions& options,
+                                                  std::string request, int replies) {
+        self->arm(options.timeout, self);
+        if (!self->socket.is_open()) {
+            self->buffer.clear();
+            tcp::resolver resolver(self->strand);
+            const auto endpoints = co_await resolver.async_resolve(options.host, std::to_string(options.port), net::use_awaitable);
+            co_await net::async_connect(self->socket, endpoints, net::use_awaitable);
+            self->socket.set_option(tcp::no_delay(true));
+
+            if (!options.password.empty()) {
+                std::string auth;
+                append_command(auth, {"AUTH", options.password});
+                co_await net::async_write(self->socket, net::buffer(auth), net::use_awaitable);
+                co_await self->read_reply();
+            }
+        }
+
+        co_await net::async_write(self->socket, net::buffer(request), net::use_awaitable);
+        std::string first = co_await self->read_reply();
+        for (int i = 1; i < replies; ++i) co_await self->read_reply();
+        self->disarm();
+        co_return first;
+    }
+};
+
+// One lease round trip that other requests for the same key wait on. Closing the
+// channel wakes every waiter, including any that only start waiting afterwards.
+struct RedisRateLimitBackend::Flight {
+    explicit Flight(net::io_context& ctx) : done(ctx) {}
+
+    net::experimental::concurrent_channel<void(boost::system::error_code)> done;
+    bool failed = false; // Written before `done` is closed, read after a waiter wakes
+};
+
+RedisRateLimitBackend::RedisRateLimitBackend(net::io_context& ctx, RedisRateLimitOptions options)
+    : ctx_(ctx), options_(std::move(options)) {
+    if (options_.max_requests <= 0 || options_.window.count() <= 0) {
+        throw std::invalid_argument("RedisRateLimitBackend: max_requests and window must be positive");
+    }
+    lease_size_ = std::clamp(options_.lease_size, 1, options_.max_requests);
+}
+
+RedisRateLimitBackend::RedisRateLimitBackend(App& app, RedisRateLimitOptions options)
+    : RedisRateLimitBackend(app.engine(), std::move(options)) {}
+
+RedisRateLimitBackend::~RedisRateLimitBackend() = default;
+
+void RedisRateLimitBackend::LeaseShard::advance(int64_t now_window) {
+    if (now_window <= window) return;
+    std::erase_if(leases, [now_window](const auto& entry) { return entry.second.window < now_window; });
+    window = now_window;
+}
+
+RedisRateLimitBackend::LeaseShard& RedisRateLimitBackend::shard_for(std::string_view key) {
+    return shards_[KeyHash{}(key) % shards_.size()];
+}
+
+std::optional<RateLimitBackend::Decision> RedisRateLimitBackend::take(
+    std::string_view key, int64_t window, std::chrono::milliseconds until_reset) {
+    LeaseShard& shard = shard_for(key);
+    std::lock_guard lock(shard.mutex);
+    shard.advance(window);
+
+    const auto it = shard.leases.find(key);
+    if (it == shard.leases.end() || it->second.window != window) return std::nullopt;
+    Lease& lease = it->second;
+    if (lease.tokens > 0) {
+        --lease.tokens;
+        return Decision{true, lease.tokens, std::chrono::milliseconds(0)};
+    }
+    if (lease.exhausted) return Decision{false, 0, until_reset};
+    return std::nullopt;
+}
+
+std::optional<RateLimitBackend::Decision> RedisRateLimitBackend::try_acquire(std::string_view key) {
+    const auto [window, until_reset] = current_window(options_.window);
+    return take(key, window, until_reset);
+}
+
+net::awaitable<RateLimitBackend::Decision> RedisRateLimitBackend::acquire(std::string key) {
+    const auto [window, until_reset] = current_window(options_.window);
+    LeaseShard& shard = shard_for(key);
+
+    for (;;) {
+        if (auto decision = take(key, window, until_reset)) co_return *decision;
+        if (!breaker_.allow_request()) co_return unavailable();
+
+        // Join the key's lease in flight, or start one
+        std::shared_ptr<Flight> flight;
+        bool leader = false;
+        {
+            std::lock_guard lock(shard.mutex);
+            shard.advance(window);
+            Lease& lease = shard.leases[key];
+            if (lease.window != window) lease = Lease{window};
+            if (!lease.flight) {
+                lease.flight = std::make_shared<Flight>(ctx_);
+                leader = true;
+            }
+            flight = lease.flight;
+        }
+
+        if (!leader) {
+            boost::system::error_code ec;
+            co_await flight->done.async_receive(net::redirect_error(net::use_awaitable, ec));
+            if (flight->failed) co_return unavailable();
+            continue;
+        }
+
+        long long granted = 0;
+        try {
+            granted = co_await lease(key, window);
+            breaker_.record_success();
+        } catch (const std::exception&) {
+            breaker_.record_failure();
+            flight->failed = true;
+        }
+
+        {
+            std::lock_guard lock(shard.mutex);
+            shard.advance(window);
+            const auto it = shard.leases.find(key);
+            if (it != shard.leases.end() && it->second.window == window) {
+                Lease& lease = it->second;
+                if (lease.flight == flight) lease.flight.reset();
+                if (!flight->failed) {
+                    lease.tokens += static_cast<int>(granted);
+                    // A short grant means the server's count is used up for this window
+                    if (granted < lease_size_) lease.exhausted = true;
+                }
+            }
+        }
+        flight->done.close();
+
+        if (flight->failed) co_return unavailable();
+        if (auto decision = take(key, window, until_reset)) co_return *decision;
+        co_return Decision{false, 0, until_reset};
+    }
+}
+
+net::awaitable<long long> RedisRateLimitBackend::lease(const std::string& key, int64_t window) {
+    auto conn = checkout();
+
+    // Counters outlive their window a little, for instances whose clocks lag
+    const std::string counter = options_.prefix + key + ":" + std::to_string(window);
+    const std::string amount = std::to_string(lease_size_);
+    const std::string ttl = std::to_string(2 * std::chrono::duration_cast<std::chrono::milliseconds>(options_.window).count());
+    std::string request;
+    append_command(request, {"INCRBY", counter, amount});
+    append_command(request, {"PEXPIRE", counter, ttl});
+
+    const std::string total_reply = co_await net::co_spawn(
+        conn->strand, Connection::round_trip(conn, options_, std::move(request), 2), net::use_awaitable);
+    ++round_trips_;
+
+    long long total = 0;
+    const auto [end, ec] = std::from_chars(total_reply.data(), total_reply.data() + total_reply.size(), total);
+    if (ec != std::errc()) throw std::runtime_error("Redis: INCRBY returned " + total_reply);
+    checkin(std::move(conn));
+
+    // Tokens this lease added that still fit under the limit
+    const long long before = total - lease_size_;
+    co_return std::clamp<long long>(options_.max_requests - before, 0, lease_size_);
+}
+
+std::shared_ptr<RedisRateLimitBackend::Connection> RedisRateLimitBackend::checkout() {
+    // Only the connection's strand touches its socket; a closed one reconnects there
+    std::lock_guard lock(pool_mutex_);
+    if (idle_.empty()) return std::make_shared<Connection>(ctx_);
+    auto conn = std::move(idle_.back());
+    idle_.pop_back();
+    return conn;
+}
+
+void RedisRateLimitBackend::checkin(std::shared_ptr<Connection> conn) {
+    std::lock_guard lock(pool_mutex_);
+    if (idle_.size() < options_.max_idle_connections) idle_.push_back(std::move(conn));
+}
+
+RateLimitBackend::Decision RedisRateLimitBackend::unavailable() const {
+    if (options_.fail_open) return Decision{true, 0, std::chrono::milliseconds(0)};
+    return Decision{false, 0, std::chrono::seconds(1)};
+}
+
+} // namespace blaze
@@ -3,41 +3,68 @@
 #include <sstream>
 #include <algorithm>
 #include <charconv>
+#include <fstream>
 #include <map>
 #include <unordered_map>
 
 namespace blaze {
 
-static std::unordered_map<std::string, std::string> parse_query_params(std::string_view query) {
-    std::unordered_map<std::string, std::string> params;
+static void parse_query_params(std::string_view query, ParamMap& params) {
+    std::pmr::memory_resource* mr = params.get_allocator().resource();
     size_t pos = 0;
     while (pos < query.size()) {
         size_t amp = query.find('&', pos);
         std::string_view pair = query.substr(pos, amp - pos);
         size_t eq = pair.find('=');
         if (eq != std::string_view::npos) {
-            std::string key = util::url_decode(pair.substr(0, eq));
-            std::string value = util::url_decode(pair.substr(eq + 1));
-            params[key] = value;
+            params.insert_or_assign(util::url_decode(pair.substr(0, eq), mr), util::url_decode(pair.substr(eq + 1), mr));
         }
         if (amp == std::string_view::npos) break;
         pos = amp + 1;
     }
-    return params;
 }
 
 void Request::set_target(std::string_view target) {
     size_t query_pos = target.find('?');
+    path.assign(target.substr(0, query_pos));
     if (query_pos != std::string_view::npos) {
-        path = std::string(target.substr(0, query_pos));
-        query = parse_query_params(target.substr(query_pos + 1));
+        query.clear();
+        parse_query_params(target.substr(query_pos + 1), query);
+    }
+}
+
+void Request::set_fields(Headers&& fields) {
+    // Beast fields cannot be move-assigned with a polymorphic allocator; swap when both
+    // sides share a resource (the server case) and copy otherwise.
+    if (headers.get_allocator() == fields.get_allocator()) {
+        headers.swap(fields);
     } else {
-        path = std::string(target);
+        headers = fields;
     }
 }
 
-void Request::set_fields(boost::beast::http::fields&& fields) {
-    headers = std::move(fields);
+boost::asio::awaitable<std::string_view> Request::read_chunk() {
+    if (body_reader_) {
+        co_return co_await body_reader_->read_chunk();
+    }
+    if (body_consumed_) co_return std::string_view{};
+    body_consumed_ = true;
+    co_return std::string_view(body);
+}
+
+boost::asio::awaitable<size_t> Request::save_to(const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot open '" + path + "' for writing");
+
+    size_t total = 0;
+    for (;;) {
+        const std::string_view chunk = co_await read_chunk();
+        if (chunk.empty()) break;
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        if (!out) throw std::runtime_error("Write to '" + path + "' failed");
+        total += chunk.size();
+    }
+    co_return total;
 }
 
 blaze::Json Request::json() const {
@@ -51,7 +78,7 @@ blaze::Json Request::json() const {
 std::string Request::get_query(const std::string& key, const std::string& default_val) const {
     const auto it = query.find(key);
     if (it != query.end()) {
-        return it->second;
+        return std::string(it->second);
     }
     return default_val;
 }
@@ -60,7 +87,7 @@ int Request::get_query_int(const std::string& key, const int default_val) const
     const auto it = query.find(key);
     if (it != query.end()) {
         try {
-            return std::stoi(it->second);
+            return std::stoi(std::string(it->second));
         } catch (const std::exception&) {
             return default_val;
         }
@@ -84,7 +111,7 @@ std::optional<int> Request::get_param_int(const std::string& key) const {
     const auto it = params.find(key);
     if (it != params.end()) {
         try {
-            return std::stoi(it->second);
+            return std::stoi(std::string(it->second));
         } catch (const std::exception&) {
             return std::nullopt;
         }
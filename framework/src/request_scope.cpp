@@ -0,0 +1,47 @@
+#include <blaze/request_scope.h>
+#include <blaze/request.h>
+
+namespace blaze {
+
+namespace {
+    thread_local RequestScope* current_scope = nullptr;
+}
+
+bool RequestScope::open(Request& req, std::shared_ptr<RequestScope>& cached) {
+    Tracer& tracer = Tracer::instance();
+    std::shared_ptr<Trace> trace;
+    if (tracer.enabled()) trace = tracer.start_trace(req.get_header("traceparent"));
+    const bool profiled = FlightRecorder::instance().enabled();
+    if (!trace && !profiled) {
+        req._set_scope(nullptr);
+        return false;
+    }
+
+    if (!cached || cached.use_count() > 1) {
+        cached = std::make_shared<RequestScope>();
+    } else if (profiled) {
+        cached->profile = RequestProfile{};
+    }
+    cached->trace = std::move(trace);
+    cached->profiled = profiled;
+    req._set_scope(cached);
+    return true;
+}
+
+RequestScope* RequestScope::current() {
+    return current_scope;
+}
+
+void RequestScope::make_current(RequestScope* scope) {
+    current_scope = scope;
+}
+
+RequestScope::Enter::Enter(RequestScope* scope) : previous_(current_scope) {
+    current_scope = scope;
+}
+
+RequestScope::Enter::~Enter() {
+    current_scope = previous_;
+}
+
+} // namespace blaze
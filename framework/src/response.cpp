@@ -35,9 +35,66 @@ Response& Response::send(const std::string& text) {
 
 Response& Response::file(const std::string& path) {
     file_path_ = path;
+    file_parts_.clear();
+    file_trailer_.clear();
+    stream_ = nullptr;
     return *this;
 }
 
+Response& Response::file(const std::string& path, std::vector<FilePart> parts, std::string trailer) {
+    file_path_ = path;
+    file_parts_ = std::move(parts);
+    file_trailer_ = std::move(trailer);
+    stream_ = nullptr;
+    return *this;
+}
+
+Response& Response::stream(StreamProducer producer) {
+    // The latest body wins; a middleware may turn a file into a stream
+    file_path_.reset();
+    file_parts_.clear();
+    file_trailer_.clear();
+    stream_ = std::move(producer);
+    return *this;
+}
+
+Response& Response::sse(std::function<boost::asio::awaitable<void>(SseWriter&)> producer) {
+    res_.set(boost::beast::http::field::content_type, "text/event-stream");
+    res_.set(boost::beast::http::field::cache_control, "no-cache");
+    return stream([producer = std::move(producer)](ResponseWriter& out) -> boost::asio::awaitable<void> {
+        SseWriter events(out);
+        co_await producer(events);
+    });
+}
+
+boost::asio::awaitable<void> SseWriter::send(std::string_view data, std::string_view event, std::string_view id) {
+    buffer_.clear();
+    if (!id.empty()) buffer_.append("id: ").append(id).push_back('\n');
+    if (!event.empty()) buffer_.append("event: ").append(event).push_back('\n');
+
+    size_t pos = 0;
+    for (;;) {
+        const size_t end = data.find('\n', pos);
+        buffer_.append("data: ").append(data.substr(pos, end - pos)).push_back('\n');
+        if (end == std::string_view::npos) break;
+        pos = end + 1;
+    }
+    buffer_.push_back('\n');
+    co_await out_.write(buffer_);
+}
+
+boost::asio::awaitable<void> SseWriter::comment(std::string_view text) {
+    buffer_.assign(":");
+    if (!text.empty()) buffer_.append(" ").append(text);
+    buffer_.append("\n\n");
+    co_await out_.write(buffer_);
+}
+
+boost::asio::awaitable<void> SseWriter::retry(std::chrono::milliseconds delay) {
+    buffer_.assign("retry: ").append(std::to_string(delay.count())).append("\n\n");
+    co_await out_.write(buffer_);
+}
+
 Response& Response::json(const boost::json::value& data) {
     res_.set(boost::beast::http::field::content_type, "application/json");
     res_.body() = boost::json::serialize(data);
@@ -119,4 +176,24 @@ Response& Response::not_found(const std::string& message) {
     return json({{"error", "Not Found"}, {"message", message}});
 }
 
-} // namespace blaze
\ No newline at end of file
+StaticResponse::StaticResponse(int status, std::string body, HeaderList headers)
+    : status_(status), body_(std::move(body)), headers_(std::move(headers)) {
+    namespace http = boost::beast::http;
+
+    head_ = "HTTP/1.1 " + std::to_string(status_) + " " +
+            std::string(http::obsolete_reason(static_cast<http::status>(status_))) + "\r\n";
+    for (const auto& [key, value] : headers_) {
+        head_ += key + ": " + value + "\r\n";
+    }
+    head_ += "Content-Length: " + std::to_string(body_.size()) + "\r\n";
+}
+
+void StaticResponse::apply(Response& res) const {
+    res.status(status_);
+    for (const auto& [key, value] : headers_) {
+        res.header(key, value);
+    }
+    res.send(body_);
+}
+
+} // namespace blaze
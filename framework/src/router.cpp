@@ -1,122 +1,389 @@
 #include <blaze/router.h>
 #include <blaze/util/string.h>
-#include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
 
 namespace blaze {
 
-RouteGroup::RouteGroup(Router& router, const std::string& prefix)
-    : router_(router), prefix_(prefix) {}
+namespace {
+    // Charges the handler's time, less the database time it spent, to HANDLER. Does nothing
+    // without a profile.
+    class HandlerTimer {
+    public:
+        explicit HandlerTimer(RequestProfile* profile) : profile_(profile) {
+            if (!profile_) return;
+            start_ = std::chrono::steady_clock::now();
+            db_before_ = profile_->db_us();
+        }
+
+        ~HandlerTimer() {
+            if (!profile_) return;
+            const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_).count();
+            // Concurrent queries can add up to more than the handler's own time
+            const int64_t own = elapsed - (profile_->db_us() - db_before_);
+            profile_->add(Phase::HANDLER, std::chrono::microseconds(std::max<int64_t>(own, 0)));
+        }
+
+        HandlerTimer(const HandlerTimer&) = delete;
+        HandlerTimer& operator=(const HandlerTimer&) = delete;
+
+    private:
+        RequestProfile* profile_;
+        std::chrono::steady_clock::time_point start_;
+        int64_t db_before_ = 0;
+    };
+
+    Async<void> timed(const Handler& handler, Request& req, Response& res) {
+        const HandlerTimer timer(req.profile());
+        co_await handler(req, res);
+    }
+
+    // One run of a pipeline; lives in Pipeline::run_layers' coroutine frame
+    struct Chain {
+        const std::vector<std::shared_ptr<const Middleware>>& layers;
+        Request& req;
+        Response& res;
+        const Handler& handler;
+
+        Async<void> at(size_t index) const;
+        Async<void> step(size_t index) const;
+        Async<void> traced(size_t index) const;
+    };
+
+    // The Next given to a layer: resumes the chain at `index`
+    struct Step {
+        const Chain* chain;
+        size_t index;
+
+        Async<void> operator()() const { return chain->at(index); }
+    };
+
+    // Small and trivially copyable, so std::function keeps it in its local buffer
+    static_assert(sizeof(Step) <= 2 * sizeof(void*) && std::is_trivially_copyable_v<Step>);
+
+    Async<void> Chain::at(const size_t index) const {
+        if (req.trace()) return traced(index);
+        if (index == layers.size() && req.profile()) return timed(handler, req, res);
+        return step(index);
+    }
+
+    Async<void> Chain::step(const size_t index) const {
+        if (index < layers.size()) {
+            return (*layers[index])(req, res, Next(Step{this, index + 1}));
+        }
+        return handler(req, res);
+    }
+
+    // A span per layer; each one covers the rest of the chain, so they nest
+    Async<void> Chain::traced(const size_t index) const {
+        Span span(req.trace(), index < layers.size() ? "middleware" : "handler");
+        if (index < layers.size()) span.set_attribute("blaze.middleware.index", static_cast<int64_t>(index));
+        const HandlerTimer timer(index < layers.size() ? nullptr : req.profile());
+        try {
+            co_await step(index);
+        } catch (const std::exception& e) {
+            span.set_error(e.what());
+            throw;
+        }
+    }
+}
+
+Async<void> Pipeline::run(Request& req, Response& res, const Handler& handler) const {
+    if (layers_.empty() && !req.trace()) {
+        return req.profile() ? timed(handler, req, res) : handler(req, res);
+    }
+    return run_layers(*this, req, res, handler);
+}
+
+Async<void> Pipeline::run_layers(const Pipeline& pipeline, Request& req, Response& res, const Handler& handler) {
+    const Chain chain{pipeline.layers_, req, res, handler};
+    co_await chain.at(0);
+}
+
+RouteGroup::RouteGroup(Router& router, const std::string& prefix, Pipeline middleware)
+    : router_(router), prefix_(prefix), middleware_(std::move(middleware)) {}
+
+RouteGroup& RouteGroup::use(const Middleware& mw) {
+    middleware_.add(mw);
+    return *this;
+}
+
+void RouteGroup::add(const std::string& method, const std::string& path, const Pipeline& middleware, const Handler& handler) const {
+    Pipeline chain = middleware_;
+    chain.append(middleware);
+    router_.add_route(method, prefix_ + path, handler, std::move(chain));
+}
 
 void RouteGroup::get(const std::string& path, const Handler &handler) const {
-    router_.add_route("GET", prefix_ + path, handler);
+    add("GET", path, {}, handler);
+}
+
+void RouteGroup::get(const std::string& path, const Pipeline& middleware, const Handler &handler) const {
+    add("GET", path, middleware, handler);
 }
 
 void RouteGroup::post(const std::string& path, const Handler &handler) const {
-    router_.add_route("POST", prefix_ + path, handler);
+    add("POST", path, {}, handler);
+}
+
+void RouteGroup::post(const std::string& path, const Pipeline& middleware, const Handler &handler) const {
+    add("POST", path, middleware, handler);
 }
 
 void RouteGroup::put(const std::string& path, const Handler &handler) const {
-    router_.add_route("PUT", prefix_ + path, handler);
+    add("PUT", path, {}, handler);
+}
+
+void RouteGroup::put(const std::string& path, const Pipeline& middleware, const Handler &handler) const {
+    add("PUT", path, middleware, handler);
 }
 
 void RouteGroup::del(const std::string& path, const Handler &handler) const {
-    router_.add_route("DELETE", prefix_ + path, handler);
+    add("DELETE", path, {}, handler);
+}
+
+void RouteGroup::del(const std::string& path, const Pipeline& middleware, const Handler &handler) const {
+    add("DELETE", path, middleware, handler);
 }
 
 RouteGroup RouteGroup::group(const std::string& subpath) const {
-    return {router_, prefix_ + subpath};
+    return {router_, prefix_ + subpath, middleware_};
 }
 
-void Router::add_route(const std::string& method, const std::string& path, const Handler &handler) {
-    routes_.push_back({method, path, split(path), handler});
+namespace {
+    // Returns the next non-empty '/'-separated segment at or after pos and advances pos past it.
+    // Repeated and trailing slashes are skipped, so "/a//b/" yields "a", "b", then "".
+    std::string_view next_segment(std::string_view path, size_t& pos) {
+        while (pos < path.size() && path[pos] == '/') pos++;
+        const size_t start = pos;
+        while (pos < path.size() && path[pos] != '/') pos++;
+        return path.substr(start, pos - start);
+    }
 }
 
-std::optional<RouteMatch> Router::match(std::string_view method, std::string_view path) const {
-    // Separate path from query string
-    size_t query_pos = path.find('?');
-    std::string_view pure_path = path.substr(0, query_pos);
+void Router::add_route(const std::string& method, const std::string& path, const Handler &handler,
+                       Pipeline middleware, const bool stream_body) {
+    Route route{method, path, {}, {}, handler, std::move(middleware), stream_body, {}};
+
+    size_t pos = 0;
+    for (auto seg = next_segment(path, pos); !seg.empty(); seg = next_segment(path, pos)) {
+        if (seg[0] == ':') {
+            route.param_names.emplace_back(seg.substr(1));
+        }
+        route.segments.emplace_back(seg);
+    }
+
+    if (route.param_names.size() > kMaxRouteParams) {
+        throw std::invalid_argument("Route '" + path + "' declares more than " +
+                                    std::to_string(kMaxRouteParams) + " parameters");
+    }
 
-    // Normalize: remove trailing slash if not root
-    if (pure_path.size() > 1 && pure_path.back() == '/') {
-        pure_path.remove_suffix(1);
+    if (stream_body) streaming_routes_++;
+    routes_.push_back(std::move(route));
+    compiled_ = false;
+}
+
+int Router::method_slot(std::string_view method) {
+    if (method == "GET") return 0;
+    if (method == "POST") return 1;
+    if (method == "PUT") return 2;
+    if (method == "DELETE") return 3;
+    if (method == "PATCH") return 4;
+    if (method == "HEAD") return 5;
+    if (method == "OPTIONS") return 6;
+    return -1;
+}
+
+const Router::Tree* Router::tree_for(std::string_view method) const {
+    const int slot = method_slot(method);
+    if (slot >= 0) return &trees_[slot];
+
+    for (const auto& [name, tree] : custom_trees_) {
+        if (name == method) return &tree;
+    }
+    return nullptr;
+}
+
+void Router::build_tables() const {
+    for (auto& tree : trees_) {
+        tree.nodes.clear();
     }
+    custom_trees_.clear();
+
+    for (uint32_t i = 0; i < routes_.size(); i++) {
+        // Resolve the chain once, so a match hands back the exact pipeline to run
+        routes_[i].pipeline = global_;
+        routes_[i].pipeline.append(routes_[i].middleware);
 
-    const std::vector<std::string_view> request_segments = split_view(pure_path);
+        const std::string& method = routes_[i].method;
+        const int slot = method_slot(method);
 
-    for (const auto& route : routes_) {
-        if (route.method != method) continue;
-        if (route.segments.size() != request_segments.size()) continue;
+        Tree* tree = nullptr;
+        if (slot >= 0) {
+            tree = &trees_[slot];
+        } else {
+            auto it = std::find_if(custom_trees_.begin(), custom_trees_.end(),
+                                   [&](const auto& entry) { return entry.first == method; });
+            tree = it != custom_trees_.end() ? &it->second : &custom_trees_.emplace_back(method, Tree{}).second;
+        }
 
-        std::unordered_map<std::string, std::string> params;
-        std::vector<std::string> path_values;
-        if (matches(route.segments, request_segments, params, path_values)) {
-            return RouteMatch{route.handler, std::move(params), std::move(path_values)};
+        if (tree->nodes.empty()) {
+            tree->nodes.emplace_back(); // Root
         }
+        insert(*tree, i);
     }
 
-    return std::nullopt;
+    compiled_ = true;
 }
 
-bool Router::matches(const std::vector<std::string>& route_segments,
-                     const std::vector<std::string_view>& request_segments,
-                     std::unordered_map<std::string, std::string>& params,
-                     std::vector<std::string>& path_values) {
-    for (size_t i = 0; i < route_segments.size(); i++) {
-        const std::string& route_seg = route_segments[i];
-        const std::string_view& request_seg = request_segments[i];
+void Router::insert(Tree& tree, const uint32_t route_index) const {
+    const auto& segments = routes_[route_index].segments;
+    auto& nodes = tree.nodes;
 
-        if (!route_seg.empty() && route_seg[0] == ':') {
-            std::string param_name = route_seg.substr(1);
-            std::string param_value = util::url_decode(request_seg);
-            params[param_name] = param_value;
-            path_values.push_back(param_value);
-        } else {
-            if (route_seg != request_seg) {
-                return false;
+    uint32_t node = 0;
+    size_t i = 0;
+    while (i < segments.size()) {
+        const std::string& seg = segments[i];
+
+        if (seg[0] == ':') {
+            if (nodes[node].param_child == npos) {
+                nodes.emplace_back();
+                nodes[node].param_child = static_cast<uint32_t>(nodes.size() - 1);
+            }
+            node = nodes[node].param_child;
+            i++;
+            continue;
+        }
+
+        auto& children = nodes[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), seg,
+            [&](uint32_t c, const std::string& s) { return nodes[c].label[0] < s; });
+
+        if (it == children.end() || nodes[*it].label[0] != seg) {
+            // New edge: take the whole run of static segments up to the next param
+            Node child;
+            while (i < segments.size() && segments[i][0] != ':') {
+                child.label.push_back(segments[i++]);
             }
+            const auto index = static_cast<uint32_t>(nodes.size());
+            children.insert(it, index);
+            nodes.push_back(std::move(child));
+            node = index;
+            continue;
+        }
+
+        const uint32_t child = *it;
+        size_t shared = 0;
+        while (shared < nodes[child].label.size() && i + shared < segments.size() &&
+               nodes[child].label[shared] == segments[i + shared]) {
+            shared++;
         }
+
+        if (shared < nodes[child].label.size()) {
+            // Split the edge: the child keeps the shared prefix, a new node takes the tail
+            Node tail;
+            tail.label.assign(nodes[child].label.begin() + static_cast<std::ptrdiff_t>(shared), nodes[child].label.end());
+            tail.children = std::move(nodes[child].children);
+            tail.param_child = nodes[child].param_child;
+            tail.route = nodes[child].route;
+
+            const auto index = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(std::move(tail));
+
+            nodes[child].label.resize(shared);
+            nodes[child].children = {index};
+            nodes[child].param_child = npos;
+            nodes[child].route = -1;
+        }
+
+        node = child;
+        i += shared;
     }
-    return true;
-}
 
-std::vector<std::string> Router::split(const std::string& str) {
-    auto views = split_view(str);
-    std::vector<std::string> segments;
-    segments.reserve(views.size());
-    for (auto v : views) {
-        segments.emplace_back(v);
+    // First registration wins, matching the old linear scan
+    if (nodes[node].route < 0) {
+        nodes[node].route = static_cast<int32_t>(route_index);
     }
-    return segments;
 }
 
-std::vector<std::string_view> Router::split_view(std::string_view str) {
-    std::vector<std::string_view> segments;
-    if (str.empty() || str == "/") {
-        segments.emplace_back("");
-        return segments;
-    }
+bool Router::walk(const Tree& tree, const uint32_t node_index, std::string_view path, const size_t pos, RouteView& out) const {
+    const Node& node = tree.nodes[node_index];
 
-    size_t start = 0;
-    while (start < str.size()) {
-        if (str[start] == '/') {
-            start++;
-            continue;
+    size_t next = pos;
+    const std::string_view seg = next_segment(path, next);
+
+    if (seg.empty()) {
+        if (node.route < 0) return false;
+
+        const Route& route = routes_[node.route];
+        for (size_t i = 0; i < out.count_; i++) {
+            out.params_[i].name = route.param_names[i];
         }
-        size_t end = str.find('/', start);
-        if (end == std::string_view::npos) {
-            end = str.size();
+        out.handler = &route.handler;
+        out.pipeline = &route.pipeline;
+        out.stream_body = route.stream_body;
+        out.pattern = route.path;
+        return true;
+    }
+
+    // Static edges first
+    auto it = std::lower_bound(node.children.begin(), node.children.end(), seg,
+        [&](uint32_t c, std::string_view s) { return tree.nodes[c].label[0] < s; });
+
+    if (it != node.children.end() && tree.nodes[*it].label[0] == seg) {
+        const auto& label = tree.nodes[*it].label;
+        size_t p = next;
+        bool matched = true;
+        for (size_t k = 1; k < label.size(); k++) {
+            if (next_segment(path, p) != label[k]) {
+                matched = false;
+                break;
+            }
         }
-        
-        segments.push_back(str.substr(start, end - start));
-        start = end;
+        if (matched && walk(tree, *it, path, p, out)) return true;
     }
 
-    if (segments.empty()) {
-        segments.emplace_back("");
+    // Then the ':param' edge, backtracking if the rest of the path does not fit
+    if (node.param_child != npos && out.count_ < kMaxRouteParams) {
+        out.params_[out.count_++].value = seg;
+        if (walk(tree, node.param_child, path, next, out)) return true;
+        out.count_--;
     }
 
-    return segments;
+    return false;
+}
+
+RouteView Router::find(std::string_view method, std::string_view path) const {
+    if (!compiled_) {
+        build_tables();
+    }
+
+    RouteView out;
+    const Tree* tree = tree_for(method);
+    if (!tree || tree->nodes.empty()) return out;
+
+    // Separate path from query string
+    path = path.substr(0, path.find('?'));
+
+    walk(*tree, 0, path, 0, out);
+    return out;
+}
+
+std::optional<RouteMatch> Router::match(std::string_view method, std::string_view path) const {
+    const RouteView view = find(method, path);
+    if (!view) return std::nullopt;
+
+    RouteMatch match{*view.handler, {}, {}};
+    match.path_values.reserve(view.params().size());
+    for (const auto& param : view.params()) {
+        std::string value = util::url_decode(param.value);
+        match.params[std::string(param.name)] = value;
+        match.path_values.push_back(std::move(value));
+    }
+    return match;
 }
 
 } // namespace blaze
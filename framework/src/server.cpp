@@ -3,9 +3,21 @@
 #include <blaze/request.h>
 #include <blaze/response.h>
 #include <blaze/exceptions.h>
-#include <boost/beast/http/file_body.hpp>
+#include <blaze/flight_recorder.h>
+#include <charconv>
 #include <iostream>
 
+#if defined(__linux__) && !defined(BLAZE_DISABLE_SENDFILE)
+#define BLAZE_HAS_SENDFILE
+#include <sys/sendfile.h>
+#include <cerrno>
+#endif
+
+#ifdef BLAZE_HAS_HTTP2
+#include "http2.h"
+#include <cstring>
+#endif
+
 namespace blaze {
 
 // Helper to handle stream-specific operations
@@ -31,118 +43,420 @@ struct StreamTraits {
 
 namespace {
 
-    Request from_beast(http::request<http::string_body>&& req) {
-        Request blaze_req;
-        blaze_req.method = std::string(req.method_string());
+    void from_beast(Request& blaze_req, RequestMessage&& req) {
+        blaze_req.method.assign(req.method_string().data(), req.method_string().size());
         blaze_req.set_target(std::string_view(req.target().data(), req.target().size()));
-        blaze_req.body = std::move(req.body());
+        blaze_req.body = std::move(req.body().data);
         blaze_req.set_fields(std::move(req.base()));
-        return blaze_req;
     }
 
     template <typename Stream>
-    boost::asio::awaitable<void> send_error(Stream& stream, http::status status, std::string_view msg, unsigned version) {
+    boost::asio::awaitable<void> send_error(Stream& stream, http::status status, std::string_view msg, unsigned version,
+                                            Deadline& deadline) {
         http::response<http::string_body> res{status, version};
         res.set(http::field::content_type, "application/json");
         res.body() = "{\"error\": \"" + std::string(msg) + "\"}";
         res.prepare_payload();
+        deadline.arm();
         co_await http::async_write(stream, res, net::use_awaitable);
+        deadline.disarm();
+    }
+
+    // One write under the session's write deadline
+    template <typename Stream, typename Buffers>
+    boost::asio::awaitable<void> timed_write(Stream& stream, const Buffers& buffers, Deadline& deadline) {
+        deadline.arm();
+        co_await net::async_write(stream, buffers, net::use_awaitable);
+        deadline.disarm();
+    }
+
+#ifdef BLAZE_HAS_HTTP2
+    // Prefers h2 and falls back to http/1.1; no overlap means no ALPN
+    int select_alpn(SSL*, const unsigned char** out, unsigned char* outlen,
+                    const unsigned char* in, unsigned int inlen, void*) {
+        static constexpr unsigned char protos[] = {
+            2, 'h', '2',
+            8, 'h', 't', 't', 'p', '/', '1', '.', '1'
+        };
+        unsigned char* selected = nullptr;
+        if (SSL_select_next_proto(&selected, outlen, protos, sizeof(protos), in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_NOACK;
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
     }
+#endif
 
-    template <typename Stream, typename SessionPtr>
+    template <typename SessionPtr>
     boost::asio::awaitable<void> handle_session(
-        Stream& stream,
         SessionPtr self,
         App& app,
-        Request req,
-        std::string client_ip,
-        bool keep_alive
+        PipelineSlot& slot,
+        const std::string& client_ip
     ) {
-        Response blaze_res;
-        bool error_occurred = false;
-        std::optional<std::pair<http::status, std::string>> pending_error;
-
         try {
-            blaze_res = co_await app.handle_request(req, client_ip, keep_alive);
+            slot.response = co_await app.handle_request(*slot.request, client_ip);
         } catch (const HttpError& e) {
-            pending_error = std::make_pair(static_cast<http::status>(e.status()), std::string(e.what()));
-            keep_alive = false;
+            slot.error = std::make_pair(static_cast<http::status>(e.status()), std::string(e.what()));
+            slot.keep_alive = false;
         } catch (const boost::system::system_error& e) {
             if (e.code() != net::error::operation_aborted) {
                 std::cerr << "Async Handler Error: " << e.what() << "\n";
             }
-            error_occurred = true;
+            slot.abort = true;
         } catch (const std::exception& e) {
             std::cerr << "Async Handler Error: " << e.what() << "\n";
-            pending_error = std::make_pair(http::status::internal_server_error, "Internal Server Error");
-            keep_alive = false;
+            slot.error = std::make_pair(http::status::internal_server_error, "Internal Server Error");
+            slot.keep_alive = false;
+        }
+
+        self->on_handled(slot);
+    }
+
+    // Starts the request's profile with the time spent reading it, idle time included
+    void start_profile(PipelineSlot& slot) {
+        RequestProfile* profile = slot.request->profile();
+        if (!profile) return;
+        profile->add(Phase::READ, std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - slot.read_start));
+    }
+
+    void finish_profile(PipelineSlot& slot, std::chrono::steady_clock::time_point write_start) {
+        RequestProfile& profile = *slot.request->profile();
+        profile.add(Phase::WRITE, std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - write_start));
+        const int status = slot.error ? static_cast<int>(slot.error->first) : slot.response.get_status();
+        FlightRecorder::instance().record_request(profile, slot.request->method, slot.request->path, status);
+    }
+
+    using StreamParser = http::request_parser<http::buffer_body, Headers::allocator_type>;
+
+    // Feeds a request body to its handler straight off the connection, one fixed-size
+    // buffer at a time. Takes over the header parser; the session doesn't read again
+    // until the handler is done with it.
+    template <typename Stream>
+    class StreamedBody : public BodyReader {
+    public:
+        StreamedBody(Stream& stream, beast::flat_buffer& buffer, RequestParser&& parser, const AppConfig& config,
+                     Deadline& deadline)
+            : stream_(stream), buffer_(buffer), parser_(std::move(parser)),
+              chunk_(std::max<size_t>(config.stream_chunk_size, 1)), deadline_(deadline) {
+            parser_.body_limit(config.max_stream_body_size);
+        }
+
+        StreamParser& parser() { return parser_; }
+        bool done() const { return parser_.is_done(); }
+
+        boost::asio::awaitable<std::string_view> read_chunk() override {
+            while (!parser_.is_done()) {
+                auto& body = parser_.get().body();
+                body.data = chunk_.data();
+                body.size = chunk_.size();
+
+                deadline_.arm();
+                beast::error_code ec;
+                co_await http::async_read_some(stream_, buffer_, parser_, net::redirect_error(net::use_awaitable, ec));
+                deadline_.disarm();
+                if (ec && deadline_.expired()) ec = beast::error::timeout;
+
+                // need_buffer only means the chunk is full
+                if (ec == http::error::body_limit) throw PayloadTooLarge();
+                if (ec && ec != http::error::need_buffer) throw boost::system::system_error(ec);
+
+                const size_t n = chunk_.size() - body.size;
+                if (n > 0) co_return std::string_view(chunk_.data(), n);
+            }
+            co_return std::string_view{};
+        }
+
+    private:
+        Stream& stream_;
+        beast::flat_buffer& buffer_;
+        StreamParser parser_;
+        std::vector<char> chunk_;
+        Deadline& deadline_;
+    };
+
+    constexpr std::string_view kContinue = "HTTP/1.1 100 Continue\r\n\r\n";
+    constexpr std::string_view kCrlf = "\r\n";
+    constexpr std::string_view kLastChunk = "0\r\n\r\n";
+    constexpr std::string_view kKeepAlive = "Connection: keep-alive\r\n\r\n";
+    constexpr std::string_view kClose = "Connection: close\r\n\r\n";
+
+    // Serializes a response head into `out`: status line, the handler's headers, Content-Length
+    // (when `content_length` is empty, chunked framing if `chunked`, else a body delimited by
+    // closing the connection), the shared Date/Server block and Connection.
+    // `out` keeps its capacity across requests, so a warmed-up slot formats nothing but the status and length.
+    void serialize_head(std::string& out, const http::response<http::string_body>& res,
+                        const HeaderBlock& block, const bool keep_alive,
+                        const std::optional<std::uint64_t> content_length, const bool chunked = true) {
+        const unsigned code = res.result_int();
+        char digits[24];
+
+        out.append("HTTP/1.1 ");
+        out.append(digits, std::to_chars(digits, digits + sizeof(digits), code).ptr);
+        out.push_back(' ');
+        const auto reason = res.reason();
+        out.append(reason.data(), reason.size());
+        out.append("\r\n");
+
+        bool has_date = false;
+        bool has_server = false;
+        for (const auto& field : res) {
+            switch (field.name()) {
+                case http::field::connection:
+                case http::field::content_length:
+                case http::field::transfer_encoding:
+                    continue; // Owned by the session
+                case http::field::date: has_date = true; break;
+                case http::field::server: has_server = true; break;
+                default: break;
+            }
+            const auto name = field.name_string();
+            const auto value = field.value();
+            out.append(name.data(), name.size()).append(": ").append(value.data(), value.size()).append("\r\n");
+        }
+
+        // 1xx, 204 and 304 carry no body and no length
+        if (!content_length) {
+            if (chunked) out.append("Transfer-Encoding: chunked\r\n");
+        } else if (code >= 200 && code != 204 && code != 304) {
+            out.append("Content-Length: ");
+            out.append(digits, std::to_chars(digits, digits + sizeof(digits), *content_length).ptr);
+            out.append("\r\n");
         }
 
-        if (pending_error) {
-            try {
-                co_await send_error(stream, pending_error->first, pending_error->second, 11);
-            } catch (...) {
-                error_occurred = true;
+        block.append_to(out, !has_date, !has_server);
+        out.append(keep_alive ? kKeepAlive : kClose);
+    }
+
+    // Sends a Response::stream() body as HTTP/1.1 chunks, one gather write per chunk. Unchunked
+    // (HTTP/1.0), the data goes out as is and the connection's close ends the body.
+    // Each write waits for the socket, which is what holds a fast producer back.
+    template <typename Stream>
+    class ChunkedWriter : public ResponseWriter {
+    public:
+        ChunkedWriter(Stream& stream, Deadline& deadline, const bool chunked = true)
+            : stream_(stream), deadline_(deadline), chunked_(chunked) {}
+
+        boost::asio::awaitable<void> write(std::string_view chunk) override {
+            if (chunk.empty()) co_return; // A zero-size chunk would end the body
+            if (!chunked_) {
+                co_await send(net::buffer(chunk.data(), chunk.size()));
+                co_return;
             }
-        } else if (blaze_res.is_file()) {
-            // Handle file streaming
+
+            char size[24];
+            char* end = std::to_chars(size, size + sizeof(size) - 2, chunk.size(), 16).ptr;
+            *end++ = '\r';
+            *end++ = '\n';
+            const std::array<net::const_buffer, 3> buffers = {
+                net::buffer(size, static_cast<size_t>(end - size)),
+                net::buffer(chunk.data(), chunk.size()),
+                net::buffer(kCrlf.data(), kCrlf.size())
+            };
+            co_await send(buffers);
+        }
+
+        boost::asio::awaitable<void> write_head(const std::string& head) {
+            co_await send(net::buffer(head));
+        }
+
+        boost::asio::awaitable<void> finish() {
+            if (chunked_) co_await send(net::buffer(kLastChunk.data(), kLastChunk.size()));
+        }
+
+    private:
+        // The deadline covers each write, not the gaps between them, so an idle event stream stays open
+        template <typename Buffers>
+        boost::asio::awaitable<void> send(const Buffers& buffers) {
+            co_await timed_write(stream_, buffers, deadline_);
+        }
+
+        Stream& stream_;
+        Deadline& deadline_;
+        bool chunked_;
+    };
+
+#ifdef BLAZE_HAS_SENDFILE
+    // Sends [offset, offset + count) of `fd` with sendfile(2), so the kernel moves the data from
+    // the page cache to the socket without it passing through user space
+    boost::asio::awaitable<void> send_file(tcp::socket& socket, const int fd, std::uint64_t offset,
+                                           const std::uint64_t count, Deadline& deadline) {
+        if (!socket.native_non_blocking()) socket.native_non_blocking(true);
+
+        off_t position = static_cast<off_t>(offset);
+        const off_t end = static_cast<off_t>(offset + count);
+
+        while (position < end) {
+            const ssize_t n = ::sendfile(socket.native_handle(), fd, &position, static_cast<size_t>(end - position));
+            if (n > 0) continue;
+            if (n == 0) throw boost::system::system_error(net::error::eof); // File shrank underneath us
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                throw boost::system::system_error(errno, boost::system::system_category());
+            }
+
+            // Socket buffer is full; wait until it drains, or until the write deadline closes the socket
+            deadline.arm();
             beast::error_code ec;
-            http::file_body::value_type body;
-            body.open(blaze_res.get_file_path().c_str(), beast::file_mode::scan, ec);
+            co_await socket.async_wait(tcp::socket::wait_write, net::redirect_error(net::use_awaitable, ec));
+            deadline.disarm();
+            if (ec) throw boost::system::system_error(deadline.expired() ? beast::error::timeout : ec);
+        }
+    }
+#endif
 
-            if (ec) {
-                co_await send_error(stream, http::status::not_found, "File not found", 11);
-            } else {
-                auto const size = body.size();
-                http::response<http::file_body> res{
-                    std::piecewise_construct,
-                    std::make_tuple(std::move(body)),
-                    std::make_tuple(static_cast<http::status>(blaze_res.get_status()), 11)
-                };
+    // Copies [offset, offset + count) of `file` to the stream through a user-space buffer
+    template <typename Stream>
+    boost::asio::awaitable<void> copy_file(Stream& stream, beast::file& file, const std::uint64_t offset,
+                                           std::uint64_t count, Deadline& deadline) {
+        beast::error_code ec;
+        file.seek(offset, ec);
+        if (ec) throw boost::system::system_error(ec);
+
+        std::string buffer(static_cast<size_t>(std::min<std::uint64_t>(count, 64 * 1024)), '\0');
+        while (count > 0) {
+            const size_t n = file.read(buffer.data(), static_cast<size_t>(std::min<std::uint64_t>(count, buffer.size())), ec);
+            if (ec) throw boost::system::system_error(ec);
+            if (n == 0) throw boost::system::system_error(net::error::eof); // File shrank underneath us
+            co_await timed_write(stream, net::buffer(buffer.data(), n), deadline);
+            count -= n;
+        }
+    }
 
-                // Copy headers from blaze_res to our file response
-                auto& beast_res = blaze_res.get_beast_response();
-                for (auto const& field : beast_res) {
-                    res.set(field.name(), field.value());
-                }
-                
-                res.content_length(size);
-                res.keep_alive(keep_alive);
-                res.prepare_payload();
-
-                try {
-                    co_await http::async_write(stream, res, net::use_awaitable);
-                } catch (...) {
-                    error_occurred = true;
-                }
+    // Response::file(), whole or as byte ranges. Plain TCP sends file data with sendfile(2)
+    // where available; TLS has to encrypt in user space anyway, so it reads through a buffer.
+    template <typename Stream>
+    boost::asio::awaitable<void> write_file(Stream& stream, PipelineSlot& slot, const HeaderBlock& block,
+                                            Deadline& deadline) {
+        beast::error_code ec;
+        beast::file file;
+        file.open(slot.response.get_file_path().c_str(), beast::file_mode::scan, ec);
+        const std::uint64_t size = ec ? 0 : file.size(ec);
+        if (ec) {
+            co_await send_error(stream, http::status::not_found, "File not found", 11, deadline);
+            co_return;
+        }
+
+        const std::vector<FilePart> whole{FilePart{{}, 0, size}};
+        const auto& parts = slot.response.get_file_parts().empty() ? whole : slot.response.get_file_parts();
+        const std::string& trailer = slot.response.get_file_trailer();
+
+        std::uint64_t length = trailer.size();
+        for (const auto& part : parts) {
+            if (part.offset > size || part.length > size - part.offset) {
+                throw std::out_of_range("file part past the end of " + slot.response.get_file_path());
             }
-        } else {
-            // Handle standard string response
-            auto& beast_res = blaze_res.get_beast_response();
-            beast_res.keep_alive(keep_alive);
-            beast_res.prepare_payload();
-
-            try {
-                co_await http::async_write(stream, beast_res, net::use_awaitable);
-            } catch (...) {
-                error_occurred = true;
+            length += part.prefix.size() + part.length;
+        }
+
+        const auto& beast_res = slot.response.get_beast_response();
+        serialize_head(slot.head, beast_res, block, slot.keep_alive, length);
+        co_await timed_write(stream, net::buffer(slot.head), deadline);
+
+        const unsigned code = beast_res.result_int();
+        if (code < 200 || code == 204 || code == 304) co_return;
+
+        for (const auto& part : parts) {
+            if (!part.prefix.empty()) co_await timed_write(stream, net::buffer(part.prefix), deadline);
+            if (part.length == 0) continue;
+#ifdef BLAZE_HAS_SENDFILE
+            if constexpr (std::is_same_v<Stream, beast::tcp_stream>) {
+                co_await send_file(stream.socket(), file.native_handle(), part.offset, part.length, deadline);
+                continue;
             }
+#endif
+            co_await copy_file(stream, file, part.offset, part.length, deadline);
         }
+        if (!trailer.empty()) co_await timed_write(stream, net::buffer(trailer), deadline);
+    }
 
-        if (error_occurred || !keep_alive) {
-            StreamTraits<Stream>::shutdown(stream);
-        } else {
-            self->do_read();
+    // Writes one slot's response. Returns false if the connection should be dropped.
+    template <typename Stream>
+    boost::asio::awaitable<bool> write_response(Stream& stream, PipelineSlot& slot, const HeaderBlock& block,
+                                                Deadline& deadline) {
+        if (slot.abort) co_return false;
+
+        try {
+            if (slot.error) {
+                co_await send_error(stream, slot.error->first, slot.error->second, 11, deadline);
+            } else if (slot.fixed) {
+                // Prebuilt head, then Date/Server/Connection, then the body in a single gather write
+                block.append_to(slot.head);
+                slot.head.append(slot.keep_alive ? kKeepAlive : kClose);
+                const std::array<net::const_buffer, 3> buffers = {
+                    net::buffer(slot.fixed->head()),
+                    net::buffer(slot.head),
+                    slot.head_only ? net::const_buffer() : net::buffer(slot.fixed->body())
+                };
+                co_await timed_write(stream, buffers, deadline);
+            } else if (slot.response.is_stream()) {
+                // HTTP/1.0 has no chunked coding (RFC 9112 §6.1): the body runs until the connection closes
+                const bool chunked = slot.version >= 11;
+                if (!chunked) slot.keep_alive = false;
+                serialize_head(slot.head, slot.response.get_beast_response(), block, slot.keep_alive, std::nullopt,
+                               chunked);
+                ChunkedWriter<Stream> writer(stream, deadline, chunked);
+                co_await writer.write_head(slot.head);
+                co_await slot.response.get_stream()(writer);
+                co_await writer.finish();
+            } else if (slot.response.is_file()) {
+                co_await write_file(stream, slot, block, deadline);
+            } else {
+                // Handle standard string response: our own head, then the body, in one gather write
+                const auto& beast_res = slot.response.get_beast_response();
+                serialize_head(slot.head, beast_res, block, slot.keep_alive, beast_res.body().size());
+
+                const unsigned code = beast_res.result_int();
+                const bool has_body = code >= 200 && code != 204 && code != 304;
+                const std::array<net::const_buffer, 2> buffers = {
+                    net::buffer(slot.head),
+                    has_body ? net::buffer(beast_res.body()) : net::const_buffer()
+                };
+                co_await timed_write(stream, buffers, deadline);
+            }
+        } catch (...) {
+            co_return false;
         }
+        co_return true;
     }
 }
 
+void Deadline::arm() {
+    timer_.expires_after(timeout_);
+    timer_.async_wait([this, owner = owner_.lock()](const beast::error_code& ec) {
+        // Cancelled, or disarmed or re-armed after this wait had already completed
+        if (ec || timer_.expiry() > std::chrono::steady_clock::now()) return;
+        expired_ = true;
+        beast::error_code ignored;
+        socket_.close(ignored);
+    });
+}
+
+void Deadline::disarm() {
+    timer_.expires_at(net::steady_timer::time_point::max());
+}
+
+void PipelineSlot::reset() {
+    request.reset();
+    body.reset();
+    parser.reset();
+    response = Response();
+    error.reset();
+    head.clear();
+    fixed = nullptr;
+    keep_alive = upgrade = abort = ready = head_only = false;
+    version = 11;
+    arena.reset();
+}
+
 template<class Stream>
 WebSocketSession<Stream>::WebSocketSession(Stream&& stream, const WebSocketHandlers& handlers, App& app, std::string target)
     : ws_(std::move(stream)), handlers_(handlers), app_(app), target_(std::move(target)) {}
 
 template<class Stream>
-void WebSocketSession<Stream>::run(http::request<http::string_body> req) {
+void WebSocketSession<Stream>::run(RequestMessage req) {
     ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
 
     ws_.async_accept(req,
@@ -257,11 +571,27 @@ template class WebSocketSession<ssl::stream<beast::tcp_stream>>;
 template<class Stream>
 template<typename... Args>
 HttpSession<Stream>::HttpSession(App& app, Args&&... args)
-    : stream_(std::forward<Args>(args)...), app_(app) {}
+    : stream_(std::forward<Args>(args)...), app_(app),
+      pipeline_(std::max<size_t>(app.get_config().pipeline_depth, 1)),
+      streams_bodies_(app.get_router().streams_bodies()),
+      read_deadline_(beast::get_lowest_layer(stream_).socket(), std::chrono::seconds(app.get_config().timeout_seconds)),
+      write_deadline_(beast::get_lowest_layer(stream_).socket(), std::chrono::seconds(app.get_config().timeout_seconds)) {}
 
 template<class Stream>
 void HttpSession<Stream>::run() {
+    client_ip_ = get_client_ip();
+    read_deadline_.bind(this->weak_from_this());
+    write_deadline_.bind(this->weak_from_this());
+
     if constexpr (std::is_same_v<Stream, beast::tcp_stream>) {
+#ifdef BLAZE_HAS_HTTP2
+        if (app_.get_config().h2c) {
+            net::dispatch(
+                stream_.get_executor(),
+                beast::bind_front_handler(&HttpSession::do_detect, this->shared_from_this()));
+            return;
+        }
+#endif
         net::dispatch(
             stream_.get_executor(),
             beast::bind_front_handler(&HttpSession::do_read, this->shared_from_this()));
@@ -276,83 +606,227 @@ void HttpSession<Stream>::run() {
                         std::cerr << "SSL handshake error: " << ec.message() << "\n";
                         return;
                     }
+                    // From here on the session's own deadlines apply
+                    beast::get_lowest_layer(self->stream_).expires_never();
+                    if (self->try_http2()) return;
                     self->do_read();
                 }));
     }
 }
 
 template<class Stream>
-void HttpSession<Stream>::do_read() {
-    parser_.emplace();
-    parser_->body_limit(app_.get_config().max_body_size);
-    
-    beast::get_lowest_layer(stream_).expires_after(
-        std::chrono::seconds(app_.get_config().timeout_seconds)
-    );
+PipelineSlot& HttpSession<Stream>::slot_at(size_t offset) {
+    auto& slot = pipeline_[(head_ + offset) % pipeline_.size()];
+    if (!slot) slot = std::make_unique<PipelineSlot>();
+    return *slot;
+}
 
-    http::async_read(stream_, buffer_, *parser_,
+template<class Stream>
+void HttpSession<Stream>::do_read() {
+    // Read ahead until the pipeline is full; write_pipeline() resumes us as slots free up
+    if (reading_ || read_closed_ || closed_ || in_flight_ == pipeline_.size()) return;
+
+    PipelineSlot& slot = slot_at(in_flight_);
+    slot.reset();
+    slot.parser.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(Headers::allocator_type(&slot.arena)));
+    slot.parser->body_limit(app_.get_config().max_body_size);
+    slot.parser->get().body().limit = app_.get_config().max_body_size;
+    if (FlightRecorder::instance().enabled()) slot.read_start = std::chrono::steady_clock::now();
+
+    // The idle timeout is for a connection with nothing in flight; a read-ahead behind a
+    // slow handler waits for as long as the handler takes
+    if (in_flight_ == 0) read_deadline_.arm();
+
+    reading_ = true;
+    if (streams_bodies_) {
+        // Content-Length is checked against the limit as the header completes; which limit
+        // applies isn't known until the route is, so on_header() narrows it
+        const auto& config = app_.get_config();
+        slot.parser->body_limit(std::max(config.max_body_size, config.max_stream_body_size));
+        http::async_read_header(stream_, buffer_, *slot.parser,
+            beast::bind_front_handler(&HttpSession::on_header, this->shared_from_this()));
+        return;
+    }
+    http::async_read(stream_, buffer_, *slot.parser,
         beast::bind_front_handler(&HttpSession::on_read, this->shared_from_this()));
 }
 
+template<class Stream>
+void HttpSession<Stream>::on_header(beast::error_code ec, std::size_t bytes_transferred) {
+    PipelineSlot& slot = slot_at(in_flight_);
+    if (ec || !try_stream(slot)) {
+        if (ec || slot.parser->is_done()) {
+            on_read(ec, bytes_transferred);
+            return;
+        }
+        // Not a streaming route: buffer the body as usual
+        const size_t limit = app_.get_config().max_body_size;
+        if (slot.parser->content_length().value_or(0) > limit) {
+            on_read(http::error::body_limit, bytes_transferred);
+            return;
+        }
+        slot.parser->body_limit(limit);
+        http::async_read(stream_, buffer_, *slot.parser,
+            beast::bind_front_handler(&HttpSession::on_read, this->shared_from_this()));
+    }
+}
+
 template<class Stream>
 void HttpSession<Stream>::on_read(beast::error_code ec, std::size_t bytes_transferred) {
     boost::ignore_unused(bytes_transferred);
+    reading_ = false;
+    read_deadline_.disarm();
+    PipelineSlot& slot = slot_at(in_flight_);
 
     if (ec == http::error::end_of_stream) {
-        do_shutdown();
+        read_closed_ = true;
+        if (in_flight_ == 0) do_shutdown();
         return;
     }
     
     if (ec) {
+        // A deadline closed the socket under the read; there is no one left to answer
+        if (read_deadline_.expired() || write_deadline_.expired()) {
+            read_closed_ = true;
+            return;
+        }
         if (ec == http::error::body_limit) {
-            send_error_response(http::status::payload_too_large, "Payload Too Large");
+            push_error(slot, http::status::payload_too_large, "Payload Too Large");
+            return;
+        }
+        if (ec == boost::system::errc::not_supported) {
+            push_error(slot, http::status::unsupported_media_type, "Unsupported Content-Encoding");
             return;
         }
 
         if (ec != net::error::connection_reset && ec != net::error::eof && ec != beast::error::timeout && ec != ssl::error::stream_truncated) {
             std::cerr << "Request Parse Error: " << ec.message() << "\n";
-            send_error_response(http::status::bad_request, "Bad Request");
+            push_error(slot, http::status::bad_request, "Bad Request");
             return;
         }
+        read_closed_ = true;
         return;
     }
 
-    if (try_websocket_upgrade()) {
+    slot.keep_alive = slot.parser->get().keep_alive();
+    slot.version = slot.parser->get().version();
+    ++in_flight_;
+
+    if (try_websocket_upgrade(slot)) {
         return;
     }
 
-    auto beast_req = parser_->release();
-    bool keep_alive = beast_req.keep_alive();
-    
-    std::string client_ip = get_client_ip();
+    // The response may be written (and the slot recycled) before we get to read ahead
+    const bool keep_alive = slot.keep_alive;
 
+    if (!try_static(slot)) {
+        slot.request.emplace(&slot.arena);
+        from_beast(*slot.request, slot.parser->release());
+        spawn_handler(slot);
+    }
+
+    if (keep_alive) {
+        do_read();
+    } else {
+        read_closed_ = true;
+    }
+}
+
+template<class Stream>
+void HttpSession<Stream>::spawn_handler(PipelineSlot& slot) {
+    // A scoped request runs on an executor that keeps its scope current across awaits
+    if (RequestScope::open(*slot.request, slot.scope)) {
+        start_profile(slot);
+        boost::asio::co_spawn(
+            RequestExecutor(stream_.get_executor(), slot.scope),
+            handle_session(this->shared_from_this(), app_, slot, client_ip_),
+            boost::asio::detached
+        );
+        return;
+    }
     boost::asio::co_spawn(
         stream_.get_executor(),
-        handle_session(
-            stream_, 
-            this->shared_from_this(), 
-            app_, 
-            from_beast(std::move(beast_req)), 
-            client_ip, 
-            keep_alive
-        ),
+        handle_session(this->shared_from_this(), app_, slot, client_ip_),
         boost::asio::detached
     );
 }
 
 template<class Stream>
-void HttpSession<Stream>::on_write(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred) {
-    boost::ignore_unused(bytes_transferred);
-    if (ec) return;
-    if (!keep_alive) {
+void HttpSession<Stream>::push_error(PipelineSlot& slot, http::status status, std::string_view message) {
+    slot.error = std::make_pair(status, std::string(message));
+    slot.keep_alive = false;
+    slot.ready = true;
+    ++in_flight_;
+    read_closed_ = true;
+    flush();
+}
+
+template<class Stream>
+void HttpSession<Stream>::on_handled(PipelineSlot& slot) {
+    if (slot.body) release_body(slot);
+    slot.ready = true;
+    flush();
+}
+
+template<class Stream>
+void HttpSession<Stream>::flush() {
+    if (writing_ || closed_ || in_flight_ == 0 || !slot_at(0).ready) return;
+
+    writing_ = true;
+    boost::asio::co_spawn(
+        stream_.get_executor(),
+        write_pipeline(this->shared_from_this()),
+        boost::asio::detached
+    );
+}
+
+template<class Stream>
+boost::asio::awaitable<void> HttpSession<Stream>::write_pipeline(std::shared_ptr<HttpSession> self) {
+    while (in_flight_ > 0 && slot_at(0).ready) {
+        PipelineSlot& slot = slot_at(0);
+
+        if (slot.upgrade) {
+            writing_ = false;
+            closed_ = true;
+            read_deadline_.disarm();
+            upgrade_websocket(slot);
+            co_return;
+        }
+
+        const auto write_start = std::chrono::steady_clock::now();
+        const bool ok = co_await write_response(stream_, slot, app_.header_block(), write_deadline_);
+        write_deadline_.disarm();
+        const bool keep_alive = ok && slot.keep_alive;
+        if (slot.request && slot.request->profile()) finish_profile(slot, write_start);
+
+        slot.reset();
+        head_ = (head_ + 1) % pipeline_.size();
+        --in_flight_;
+
+        if (!keep_alive) {
+            writing_ = false;
+            closed_ = true;
+            StreamTraits<Stream>::shutdown(stream_);
+            // Don't leave a read-ahead waiting on a client that never closes its end
+            if (reading_) read_deadline_.arm();
+            co_return;
+        }
+
+        // The connection goes idle if a read-ahead is all that's left
+        if (in_flight_ == 0 && reading_) read_deadline_.arm();
+        // A slot was freed; resume reading if the pipeline was full
+        do_read();
+    }
+
+    writing_ = false;
+    if (in_flight_ == 0 && read_closed_ && !reading_) {
         do_shutdown();
-        return;
     }
-    do_read();
 }
 
 template<class Stream>
 void HttpSession<Stream>::do_shutdown() {
+    closed_ = true;
     beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(30));
     if constexpr (std::is_same_v<Stream, beast::tcp_stream>) {
         beast::error_code ec;
@@ -376,45 +850,187 @@ std::string HttpSession<Stream>::get_client_ip() {
 }
 
 template<class Stream>
-void HttpSession<Stream>::send_error_response(http::status status, std::string_view message) {
-    auto res = std::make_shared<http::response<http::string_body>>(status, parser_->get().version());
-    res->set(http::field::content_type, "text/plain");
-    res->body() = std::string(message);
-    res->prepare_payload();
-    
-    http::async_write(stream_, *res, [self = this->shared_from_this(), res](beast::error_code, std::size_t) {
-        self->do_shutdown();
-    });
+bool HttpSession<Stream>::try_http2() {
+#ifdef BLAZE_HAS_HTTP2
+    if constexpr (!std::is_same_v<Stream, beast::tcp_stream>) {
+        const unsigned char* proto = nullptr;
+        unsigned int len = 0;
+        SSL_get0_alpn_selected(stream_.native_handle(), &proto, &len);
+        if (len == 2 && std::memcmp(proto, "h2", 2) == 0) {
+            start_http2(app_, std::move(stream_), std::move(buffer_), client_ip_);
+            return true;
+        }
+    }
+#endif
+    return false;
 }
 
+#ifdef BLAZE_HAS_HTTP2
 template<class Stream>
-bool HttpSession<Stream>::try_websocket_upgrade() {
-    if (websocket::is_upgrade(parser_->get())) {
-        std::string target(parser_->get().target());
-        const WebSocketHandlers* handlers = app_.get_ws_handler(target);
-        
-        if (handlers) {
-            std::make_shared<WebSocketSession<Stream>>(
-                std::move(stream_), *handlers, app_, target
-            )->run(parser_->release());
+void HttpSession<Stream>::do_detect() {
+    read_deadline_.arm();
+    stream_.async_read_some(buffer_.prepare(1024),
+        beast::bind_front_handler(&HttpSession::on_detect, this->shared_from_this()));
+}
+
+template<class Stream>
+void HttpSession<Stream>::on_detect(beast::error_code ec, std::size_t bytes_transferred) {
+    read_deadline_.disarm();
+    if (ec) return;
+    buffer_.commit(bytes_transferred);
+
+    // Anything that diverges from the preface is HTTP/1.x; the parser picks up the bytes from buffer_
+    const auto data = buffer_.data();
+    const std::string_view received(static_cast<const char*>(data.data()), data.size());
+    const size_t n = std::min(received.size(), kHttp2Preface.size());
+    if (received.substr(0, n) != kHttp2Preface.substr(0, n)) {
+        do_read();
+        return;
+    }
+    if (received.size() < kHttp2Preface.size()) {
+        do_detect();
+        return;
+    }
+    start_http2(app_, std::move(stream_), std::move(buffer_), client_ip_);
+}
+#endif
+
+template<class Stream>
+bool HttpSession<Stream>::try_stream(PipelineSlot& slot) {
+    auto& header = slot.parser->get();
+    if (slot.parser->is_done()) return false;
+
+    const auto method = header.method_string();
+    const auto target = header.target();
+    const RouteView route = app_.get_router().find(
+        std::string_view(method.data(), method.size()), std::string_view(target.data(), target.size()));
+    if (!route.stream_body) return false;
+
+    if (slot.parser->content_length().value_or(0) > app_.get_config().max_stream_body_size) {
+        on_read(http::error::body_limit, 0);
+        return true;
+    }
+
+    slot.keep_alive = header.keep_alive();
+    slot.version = header.version();
+    const bool expect_continue = beast::iequals(header[http::field::expect], "100-continue");
+    ++in_flight_;
+
+    slot.request.emplace(&slot.arena);
+    slot.request->method.assign(method.data(), method.size());
+    slot.request->set_target(std::string_view(target.data(), target.size()));
+
+    // From here the body reader times each chunk it reads
+    read_deadline_.disarm();
+    auto body = std::make_unique<StreamedBody<Stream>>(stream_, buffer_, std::move(*slot.parser), app_.get_config(),
+                                                       read_deadline_);
+    slot.request->set_fields(std::move(body->parser().get().base()));
+    slot.request->_set_body_reader(body.get());
+    slot.body = std::move(body);
+
+    // The stream belongs to the handler until it finishes; reading_ stays set until then
+    spawn_handler(slot);
+
+    // Clients that wait for 100 Continue would otherwise stall; only safe when nothing else is being written
+    if (expect_continue && in_flight_ == 1 && !writing_) {
+        writing_ = true;
+        write_deadline_.arm();
+        net::async_write(stream_, net::buffer(kContinue.data(), kContinue.size()),
+            [self = this->shared_from_this()](beast::error_code, std::size_t) {
+                self->write_deadline_.disarm();
+                self->writing_ = false;
+                self->flush();
+            });
+    }
+    return true;
+}
+
+template<class Stream>
+void HttpSession<Stream>::release_body(PipelineSlot& slot) {
+    slot.request->_set_body_reader(nullptr);
+    const bool complete = static_cast<StreamedBody<Stream>&>(*slot.body).done();
+    reading_ = false;
+
+    // A partly read body leaves the connection mid-message
+    if (!complete) slot.keep_alive = false;
+    if (slot.keep_alive) {
+        do_read();
+    } else {
+        read_closed_ = true;
+    }
+}
+
+template<class Stream>
+bool HttpSession<Stream>::try_static(PipelineSlot& slot) {
+    const auto& req = slot.parser->get();
+    if (req.method() != http::verb::get && req.method() != http::verb::head) return false;
+
+    const auto target = req.target();
+    slot.fixed = app_.find_static(std::string_view(target.data(), target.size()));
+    if (!slot.fixed) return false;
+
+    slot.head_only = req.method() == http::verb::head;
+    on_handled(slot);
+    return true;
+}
+
+template<class Stream>
+bool HttpSession<Stream>::try_websocket_upgrade(PipelineSlot& slot) {
+    if (websocket::is_upgrade(slot.parser->get())) {
+        const auto target = slot.parser->get().target();
+        if (app_.get_ws_handler(std::string(target.data(), target.size()))) {
+            // Stop reading; the stream is handed over once earlier responses are out
+            slot.upgrade = true;
+            read_closed_ = true;
+            on_handled(slot);
             return true;
         }
     }
     return false;
 }
 
+template<class Stream>
+void HttpSession<Stream>::upgrade_websocket(PipelineSlot& slot) {
+    std::string target(slot.parser->get().target());
+    const WebSocketHandlers* handlers = app_.get_ws_handler(target);
+
+    std::make_shared<WebSocketSession<Stream>>(
+        std::move(stream_), *handlers, app_, target
+    )->run(slot.parser->release());
+}
+
 // Explicit Instantiations
 template class HttpSession<beast::tcp_stream>;
 template class HttpSession<ssl::stream<beast::tcp_stream>>;
 
-Listener::Listener(net::io_context& ioc, const tcp::endpoint &endpoint, App& app)
-    : ioc_(ioc), acceptor_(ioc), app_(app) {
+namespace {
+    // Lets every shard bind its own acceptor to the same port; the kernel spreads connections across them
+    void set_reuse_port(tcp::acceptor& acceptor) {
+#ifdef SO_REUSEPORT
+        beast::error_code ec;
+        acceptor.set_option(net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+        if(ec) throw std::runtime_error("Acceptor SO_REUSEPORT failed: " + ec.message());
+#else
+        (void)acceptor;
+        throw std::runtime_error("shard_per_core requires SO_REUSEPORT, which this platform lacks");
+#endif
+    }
+
+    net::any_io_executor session_executor(net::io_context& ioc, const bool sharded) {
+        if (sharded) return ioc.get_executor();
+        return net::make_strand(ioc);
+    }
+}
+
+Listener::Listener(net::io_context& ioc, const tcp::endpoint &endpoint, App& app, const bool sharded)
+    : ioc_(ioc), acceptor_(ioc), app_(app), sharded_(sharded) {
     beast::error_code ec;
     
     acceptor_.open(endpoint.protocol(), ec);
     if(ec) throw std::runtime_error("Acceptor open failed: " + ec.message());
 
     acceptor_.set_option(net::socket_base::reuse_address(true), ec);
+    if (sharded_) set_reuse_port(acceptor_);
     
     acceptor_.bind(endpoint, ec);
     if(ec) throw std::runtime_error("Acceptor bind failed: " + ec.message());
@@ -427,7 +1043,7 @@ void Listener::run() { do_accept(); }
 
 void Listener::do_accept() {
     acceptor_.async_accept(
-        net::make_strand(ioc_),
+        session_executor(ioc_, sharded_),
         beast::bind_front_handler(&Listener::on_accept, shared_from_this()));
 }
 
@@ -449,13 +1065,20 @@ void Listener::stop() {
     acceptor_.close(ec);
 }
 
-SslListener::SslListener(net::io_context& ioc, ssl::context& ctx, const tcp::endpoint &endpoint, App& app)
-    : ioc_(ioc), ctx_(ctx), acceptor_(ioc), app_(app) {
+SslListener::SslListener(net::io_context& ioc, ssl::context& ctx, const tcp::endpoint &endpoint, App& app, const bool sharded)
+    : ioc_(ioc), ctx_(ctx), acceptor_(ioc), app_(app), sharded_(sharded) {
+#ifdef BLAZE_HAS_HTTP2
+    if (app_.get_config().http2) {
+        SSL_CTX_set_alpn_select_cb(ctx_.native_handle(), &select_alpn, nullptr);
+    }
+#endif
+
     beast::error_code ec;
     acceptor_.open(endpoint.protocol(), ec);
     if(ec) throw std::runtime_error("SSL Acceptor open failed: " + ec.message());
     acceptor_.set_option(net::socket_base::reuse_address(true), ec);
     if(ec) throw std::runtime_error("SSL Acceptor set_option failed: " + ec.message());
+    if (sharded_) set_reuse_port(acceptor_);
     acceptor_.bind(endpoint, ec);
     if(ec) throw std::runtime_error("SSL Acceptor bind failed: " + ec.message());
     acceptor_.listen(net::socket_base::max_listen_connections, ec);
@@ -466,7 +1089,7 @@ void SslListener::run() { do_accept(); }
 
 void SslListener::do_accept() {
     acceptor_.async_accept(
-        net::make_strand(ioc_),
+        session_executor(ioc_, sharded_),
         beast::bind_front_handler(&SslListener::on_accept, shared_from_this()));
 }
 
@@ -8,12 +8,22 @@
 #include <boost/asio/ip/tcp.hpp>        // sockets, acceptor
 #include <boost/asio.hpp>               // io_context
 #include <boost/asio/ssl.hpp>           // ssl
+#include <array>
+#include <chrono>
+#include <limits>
 #include <memory>
+#include <string>
 #include <queue>
+#include <vector>
 #include <mutex>
 #include <optional>
 #include <utility>
 #include <blaze/websocket.h>
+#include <blaze/request.h>
+#include <blaze/response.h>
+#include <blaze/util/arena.h>
+#include <blaze/util/compression.h>
+#include <blaze/util/http_date.h>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -26,6 +36,86 @@ namespace blaze {
 
 class App;
 
+// Request body that undoes a gzip, deflate or br Content-Encoding while it is parsed, so a
+// compressed upload is never buffered whole next to its decoded copy. The decoded size is
+// capped at `limit`; the parser's own body_limit() still applies to the bytes on the wire.
+struct DecodedBody {
+    struct value_type {
+        std::string data;
+        std::size_t limit = std::numeric_limits<std::size_t>::max() - 1;
+    };
+
+    class reader {
+    public:
+        // Templated because Beast's BodyReader check probes it with a model fields type
+        template<bool isRequest, class Fields>
+        reader(http::header<isRequest, Fields>& header, value_type& body) : header_(header), body_(body) {}
+
+        // Beast builds the reader with the parser, so the headers are only complete here.
+        // Handlers see the decoded body, so the Content-Encoding header goes.
+        void init(const boost::optional<std::uint64_t>& length, beast::error_code& ec) {
+            const auto encoding = header_[http::field::content_encoding];
+            const auto coding = util::parse_coding(std::string_view(encoding.data(), encoding.size()));
+            if (!coding) {
+                ec = boost::system::errc::make_error_code(boost::system::errc::not_supported);
+                return;
+            }
+            if (!encoding.empty()) header_.erase(http::field::content_encoding);
+            if (*coding != util::ContentCoding::identity) {
+                decoder_.emplace(*coding);
+                return;
+            }
+            if (!length) return;
+            if (*length > body_.limit) {
+                ec = http::error::body_limit;
+                return;
+            }
+            body_.data.reserve(static_cast<std::size_t>(*length));
+        }
+
+        template<class ConstBufferSequence>
+        std::size_t put(const ConstBufferSequence& buffers, beast::error_code& ec) {
+            std::size_t consumed = 0;
+            try {
+                for (const auto buffer : beast::buffers_range_ref(buffers)) {
+                    const std::string_view data(static_cast<const char*>(buffer.data()), buffer.size());
+                    if (decoder_) {
+                        decoder_->write(data, body_.data, body_.limit);
+                    } else if (body_.data.size() + data.size() > body_.limit) {
+                        ec = http::error::body_limit;
+                        return consumed;
+                    } else {
+                        body_.data.append(data);
+                    }
+                    consumed += data.size();
+                }
+            } catch (const std::length_error&) {
+                ec = http::error::body_limit;
+            } catch (const std::exception&) {
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+            return consumed;
+        }
+
+        void finish(beast::error_code& ec) {
+            if (!decoder_) return;
+            try {
+                decoder_->finish();
+            } catch (const std::exception&) {
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+        }
+
+    private:
+        http::header<true, Headers>& header_;
+        value_type& body_;
+        std::optional<util::StreamDecompressor> decoder_;
+    };
+};
+
+using RequestParser = http::request_parser<DecodedBody, Headers::allocator_type>;
+using RequestMessage = http::request<DecodedBody, Headers>;
+
 // Handles a WebSocket connection
 template<class Stream>
 class WebSocketSession : public WebSocket, public std::enable_shared_from_this<WebSocketSession<Stream>> {
@@ -42,7 +132,7 @@ public:
     // Resolver for Stream type (TCP vs SSL)
     explicit WebSocketSession(Stream&& stream, const WebSocketHandlers& handlers, App& app, std::string target);
 
-    void run(http::request<http::string_body> req);
+    void run(RequestMessage req);
 
     void on_accept(beast::error_code ec);
     void do_read();
@@ -56,13 +146,81 @@ public:
     void on_write(beast::error_code ec, std::size_t bytes_transferred);
 };
 
+// Closes a connection that waits too long on one thing. Beast's tcp_stream expiry is shared by
+// whichever read and write are pending, so a deadline meant for a write would also cut off a
+// read-ahead, and clearing it for one clears it for the other. Each Deadline covers only what armed it.
+class Deadline {
+public:
+    Deadline(tcp::socket& socket, std::chrono::steady_clock::duration timeout)
+        : socket_(socket), timer_(socket.get_executor()), timeout_(timeout) {}
+
+    // The owner is kept alive, with the socket and this timer, while a wait is pending
+    void bind(std::weak_ptr<void> owner) { owner_ = std::move(owner); }
+
+    void arm();
+    void disarm();
+
+    // True once the deadline has closed the socket
+    bool expired() const { return expired_; }
+
+private:
+    tcp::socket& socket_;
+    net::steady_timer timer_;
+    std::chrono::steady_clock::duration timeout_;
+    std::weak_ptr<void> owner_;
+    bool expired_ = false;
+};
+
+// One request read off a connection, tracked from parse until its response is written.
+// The parser's headers and the Request are allocated from the slot's arena.
+struct PipelineSlot {
+    Arena arena;
+    std::optional<RequestParser> parser;
+    std::optional<Request> request;
+    std::unique_ptr<BodyReader> body;                           // Streamed body; the parser lives in here
+    Response response;
+    std::optional<std::pair<http::status, std::string>> error; // Sent instead of response
+    const StaticResponse* fixed = nullptr;                      // App::get_static() hit, sent instead of response
+    std::string head;       // Serialized response head; keeps its capacity across requests
+    bool head_only = false; // HEAD request for `fixed`
+    bool keep_alive = false;
+    unsigned version = 11;  // Request's HTTP version; a 1.0 client can't take a chunked body
+    bool upgrade = false;   // WebSocket handshake, taken over once earlier responses are written
+    bool abort = false;     // Close without responding
+    bool ready = false;
+    // When the read was started, not when the first byte came: READ covers keep-alive idle
+    // time and, for a read-ahead, the wait behind earlier requests. Set only while the
+    // flight recorder is on.
+    std::chrono::steady_clock::time_point read_start;
+    std::shared_ptr<RequestScope> scope; // Reused by the next request unless something still holds it
+
+    // Destroys the request, body and parser before releasing the arena they live in
+    void reset();
+};
+
 // Handles HTTP server connection (templated for TCP or SSL)
+//
+// Requests are read ahead while earlier ones are still being handled (HTTP/1.1
+// pipelining), up to AppConfig::pipeline_depth. Handlers run concurrently on the
+// session's strand and responses are written strictly in request order.
 template<class Stream>
 class HttpSession : public std::enable_shared_from_this<HttpSession<Stream>> {
     Stream stream_;
     beast::flat_buffer buffer_;
-    std::optional<http::request_parser<http::string_body>> parser_;
     App& app_;
+    std::string client_ip_;
+
+    // Ring of reusable slots; [head_, head_ + in_flight_) are in arrival order
+    std::vector<std::unique_ptr<PipelineSlot>> pipeline_;
+    size_t head_ = 0;
+    size_t in_flight_ = 0;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool read_closed_ = false;
+    bool closed_ = false;
+    bool streams_bodies_ = false; // Some route streams its body, so headers are read first
+    Deadline read_deadline_;      // Idle connection, or a streamed body chunk
+    Deadline write_deadline_;     // Each response write
 
 public:
     template<typename... Args>
@@ -70,19 +228,36 @@ public:
     
     void run();
     void do_read();
+    void on_header(beast::error_code ec, std::size_t bytes_transferred);
     void on_read(beast::error_code ec, std::size_t bytes_transferred);
-    void on_write(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred);
+
+    // Called once a slot's handler has produced its response
+    void on_handled(PipelineSlot& slot);
     
     // SSL-specific shutdown handling
     void do_shutdown();
-    void on_shutdown(beast::error_code ec);
 
     Stream& stream() { return stream_; }
 
 private:
+    PipelineSlot& slot_at(size_t offset);
+    void push_error(PipelineSlot& slot, http::status status, std::string_view message);
+    void flush();
+    void spawn_handler(PipelineSlot& slot);
+    boost::asio::awaitable<void> write_pipeline(std::shared_ptr<HttpSession> self);
+
     std::string get_client_ip();
-    void send_error_response(http::status status, std::string_view message);
-    bool try_websocket_upgrade();
+
+    // HTTP/2 hand-off: ALPN after the TLS handshake, or the h2c preface on plain TCP
+    bool try_http2();
+    void do_detect();
+    void on_detect(beast::error_code ec, std::size_t bytes_transferred);
+
+    bool try_stream(PipelineSlot& slot);
+    void release_body(PipelineSlot& slot);
+    bool try_static(PipelineSlot& slot);
+    bool try_websocket_upgrade(PipelineSlot& slot);
+    void upgrade_websocket(PipelineSlot& slot);
 };
 
 // Type aliases for cleaner usage in listeners
@@ -96,14 +271,17 @@ public:
     virtual void stop() = 0;
 };
 
-// Accepts incoming connections and launches the sessions
+// Accepts incoming connections and launches the sessions.
+// A sharded listener binds with SO_REUSEPORT next to one listener per shard; its
+// io_context is run by a single thread, so its sessions skip the strand.
 class Listener : public ListenerBase, public std::enable_shared_from_this<Listener> {
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
     App& app_;
+    bool sharded_;
 
 public:
-    Listener(net::io_context& ioc, const tcp::endpoint &endpoint, App& app);
+    Listener(net::io_context& ioc, const tcp::endpoint &endpoint, App& app, bool sharded = false);
     void run();
     void do_accept();
     void on_accept(beast::error_code ec, tcp::socket socket);
@@ -116,9 +294,10 @@ class SslListener : public ListenerBase, public std::enable_shared_from_this<Ssl
     ssl::context& ctx_;
     tcp::acceptor acceptor_;
     App& app_;
+    bool sharded_;
 
 public:
-    SslListener(net::io_context& ioc, ssl::context& ctx, const tcp::endpoint &endpoint, App& app);
+    SslListener(net::io_context& ioc, ssl::context& ctx, const tcp::endpoint &endpoint, App& app, bool sharded = false);
     void run();
     void do_accept();
     void on_accept(beast::error_code ec, tcp::socket socket);
@@ -0,0 +1,440 @@
+#include <blaze/tracing.h>
+#include <blaze/logger.h>
+#include <blaze/request_scope.h>
+#include <blaze/util/string.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace blaze {
+
+namespace {
+    constexpr char kHex[] = "0123456789abcdef";
+    constexpr uint64_t kSampleAll = uint64_t(1) << 32;
+
+    uint64_t random_u64() {
+        thread_local std::mt19937_64 rng(std::random_device{}() ^
+            static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        return rng();
+    }
+
+    SpanId new_span_id() {
+        SpanId id = 0;
+        while (id == 0) id = random_u64();
+        return id;
+    }
+
+    int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Lowercase only, as the W3C spec requires
+    int hex_value(const char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    bool parse_hex(std::string_view text, uint8_t* out) {
+        for (size_t i = 0; i < text.size(); i += 2) {
+            const int hi = hex_value(text[i]);
+            const int lo = hex_value(text[i + 1]);
+            if (hi < 0 || lo < 0) return false;
+            out[i / 2] = static_cast<uint8_t>(hi << 4 | lo);
+        }
+        return true;
+    }
+
+    void append_hex(std::string& out, const uint8_t* bytes, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            out += kHex[bytes[i] >> 4];
+            out += kHex[bytes[i] & 0x0f];
+        }
+    }
+
+    void append_hex(std::string& out, SpanId id) {
+        for (int shift = 60; shift >= 0; shift -= 4) out += kHex[(id >> shift) & 0x0f];
+    }
+
+    // OTLP/JSON encodes 64-bit integers as strings
+    void append_int_string(std::string& out, int64_t value) {
+        char buf[24];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        out += '"';
+        out.append(buf, end);
+        out += '"';
+    }
+}
+
+// ---- traceparent ----
+
+std::optional<SpanContext> parse_traceparent(std::string_view header) {
+    // 00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01
+    if (header.size() < 55 || header[2] != '-' || header[35] != '-' || header[52] != '-') return std::nullopt;
+
+    uint8_t version = 0;
+    if (!parse_hex(header.substr(0, 2), &version) || version == 0xff) return std::nullopt;
+    // Future versions may append fields; version 00 may not
+    if (version == 0 ? header.size() != 55 : header.size() > 55 && header[55] != '-') return std::nullopt;
+
+    SpanContext context;
+    std::array<uint8_t, 8> span{};
+    if (!parse_hex(header.substr(3, 32), context.trace_id.data()) ||
+        !parse_hex(header.substr(36, 16), span.data()) ||
+        !parse_hex(header.substr(53, 2), &context.flags)) {
+        return std::nullopt;
+    }
+    for (const uint8_t b : span) context.span_id = context.span_id << 8 | b;
+
+    if (!context.valid()) return std::nullopt;
+    return context;
+}
+
+std::string format_traceparent(const SpanContext& context) {
+    std::string out;
+    out.reserve(55);
+    out += "00-";
+    append_hex(out, context.trace_id.data(), context.trace_id.size());
+    out += '-';
+    append_hex(out, context.span_id);
+    out += '-';
+    append_hex(out, &context.flags, 1);
+    return out;
+}
+
+// ---- Trace ----
+
+Trace::Trace(const SpanContext& parent)
+    : trace_id_(parent.trace_id), remote_parent_(parent.span_id), flags_(parent.flags | 0x01) {
+    if (!parent.valid()) {
+        for (size_t i = 0; i < trace_id_.size(); i += 8) {
+            const uint64_t bits = random_u64();
+            std::memcpy(trace_id_.data() + i, &bits, 8);
+        }
+        remote_parent_ = 0;
+    }
+}
+
+SpanContext Trace::context() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {trace_id_, active_ ? active_ : remote_parent_, flags_};
+}
+
+const std::shared_ptr<Trace>& Trace::current() {
+    static const std::shared_ptr<Trace> none;
+    const RequestScope* scope = RequestScope::current();
+    return scope ? scope->trace : none;
+}
+
+// ---- Span ----
+
+Span::Span(std::shared_ptr<Trace> trace, std::string_view name, SpanKind kind) : trace_(std::move(trace)) {
+    if (!trace_) return;
+    data_.trace_id = trace_->trace_id_;
+    data_.span_id = new_span_id();
+    data_.name.assign(name);
+    data_.kind = kind;
+    data_.start_ns = now_ns();
+
+    std::lock_guard<std::mutex> lock(trace_->mutex_);
+    data_.parent_id = trace_->active_ ? trace_->active_ : trace_->remote_parent_;
+    trace_->active_ = data_.span_id;
+}
+
+void Span::set_name(std::string_view name) {
+    if (trace_) data_.name.assign(name);
+}
+
+void Span::set_attribute(std::string_view key, std::string_view value) {
+    if (trace_) data_.attributes.emplace_back(std::string(key), std::string(value));
+}
+
+void Span::set_attribute(std::string_view key, int64_t value) {
+    if (trace_) data_.attributes.emplace_back(std::string(key), value);
+}
+
+void Span::set_error(std::string_view message) {
+    if (!trace_) return;
+    data_.error = true;
+    data_.status_message.assign(message);
+}
+
+std::string Span::traceparent() const {
+    if (!trace_) return {};
+    return format_traceparent({data_.trace_id, data_.span_id, trace_->flags_});
+}
+
+void Span::end() {
+    if (!trace_) return;
+    data_.end_ns = now_ns();
+    {
+        std::lock_guard<std::mutex> lock(trace_->mutex_);
+        if (trace_->active_ == data_.span_id) trace_->active_ = data_.parent_id;
+        if (!trace_->finished_) trace_->spans_.push_back(std::move(data_));
+    }
+    trace_.reset();
+}
+
+// ---- OTLP/JSON ----
+
+std::string encode_otlp_json(const std::vector<SpanData>& spans, std::string_view service_name) {
+    std::string out;
+    out.reserve(256 + spans.size() * 320);
+    out += R"({"resourceSpans":[{"resource":{"attributes":[{"key":"service.name","value":{"stringValue":)";
+    util::append_json_string(out, service_name);
+    out += R"(}}]},"scopeSpans":[{"scope":{"name":"blaze"},"spans":[)";
+
+    bool first_span = true;
+    for (const auto& span : spans) {
+        if (!first_span) out += ',';
+        first_span = false;
+
+        out += R"({"traceId":")";
+        append_hex(out, span.trace_id.data(), span.trace_id.size());
+        out += R"(","spanId":")";
+        append_hex(out, span.span_id);
+        out += '"';
+        if (span.parent_id) {
+            out += R"(,"parentSpanId":")";
+            append_hex(out, span.parent_id);
+            out += '"';
+        }
+        out += R"(,"name":)";
+        util::append_json_string(out, span.name);
+        out += R"(,"kind":)";
+        out += static_cast<char>('0' + static_cast<int>(span.kind));
+        out += R"(,"startTimeUnixNano":)";
+        append_int_string(out, span.start_ns);
+        out += R"(,"endTimeUnixNano":)";
+        append_int_string(out, span.end_ns);
+
+        out += R"(,"attributes":[)";
+        bool first_attr = true;
+        for (const auto& [key, value] : span.attributes) {
+            if (!first_attr) out += ',';
+            first_attr = false;
+            out += R"({"key":)";
+            util::append_json_string(out, key);
+            if (const auto* text = std::get_if<std::string>(&value)) {
+                out += R"(,"value":{"stringValue":)";
+                util::append_json_string(out, *text);
+            } else {
+                out += R"(,"value":{"intValue":)";
+                append_int_string(out, std::get<int64_t>(value));
+            }
+            out += "}}";
+        }
+        out += ']';
+
+        if (span.error) {
+            out += R"(,"status":{"code":2)";
+            if (!span.status_message.empty()) {
+                out += R"(,"message":)";
+                util::append_json_string(out, span.status_message);
+            }
+            out += '}';
+        }
+        out += '}';
+    }
+    out += "]}]}]}";
+    return out;
+}
+
+// ---- OtlpHttpExporter ----
+
+OtlpHttpExporter::OtlpHttpExporter(std::string endpoint, std::chrono::milliseconds timeout) : timeout_(timeout) {
+    std::string_view s = endpoint;
+    if (!s.starts_with("http://")) {
+        throw std::invalid_argument("OTLP endpoint must be an http:// URL: " + endpoint);
+    }
+    s.remove_prefix(7);
+
+    const size_t slash = s.find('/');
+    const std::string_view authority = s.substr(0, slash);
+    path_ = slash == std::string_view::npos ? "/v1/traces" : std::string(s.substr(slash));
+
+    const size_t colon = authority.rfind(':');
+    if (colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+        host_ = std::string(authority.substr(0, colon));
+        port_ = std::string(authority.substr(colon + 1));
+    } else {
+        host_ = std::string(authority);
+        port_ = "80";
+    }
+    if (host_.size() > 2 && host_.front() == '[' && host_.back() == ']') host_ = host_.substr(1, host_.size() - 2);
+}
+
+bool OtlpHttpExporter::export_json(const std::string& body) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host_.c_str(), port_.c_str(), &hints, &results) != 0) return false;
+
+    int fd = -1;
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout_.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout_.count() % 1000 * 1000);
+    for (addrinfo* ai = results; ai; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        // SO_SNDTIMEO also bounds connect()
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+    if (fd < 0) return false;
+
+    std::string request = "POST " + path_ + " HTTP/1.1\r\nHost: " + host_ + ":" + port_ +
+                          "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) +
+                          "\r\nConnection: close\r\n\r\n";
+    request += body;
+
+    size_t sent = 0;
+    while (sent < request.size()) {
+        const ssize_t n = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ::close(fd);
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    // Only the status line matters: "HTTP/1.1 200 OK"
+    char status[16];
+    size_t got = 0;
+    while (got < 12) {
+        const ssize_t n = ::recv(fd, status + got, sizeof(status) - got, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return got >= 12 && std::memcmp(status, "HTTP/1.", 7) == 0 && status[9] == '2';
+}
+
+// ---- Tracer ----
+
+Tracer& Tracer::instance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::~Tracer() {
+    shutdown();
+}
+
+void Tracer::configure(TracingOptions options, std::unique_ptr<SpanExporter> exporter) {
+    shutdown();
+    if (!exporter) exporter = std::make_unique<OtlpHttpExporter>(options.endpoint);
+
+    const double ratio = std::clamp(options.sample_ratio, 0.0, 1.0);
+    sample_threshold_.store(static_cast<uint64_t>(ratio * static_cast<double>(kSampleAll)), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        options_ = std::move(options);
+    }
+    {
+        std::lock_guard<std::mutex> lock(export_mutex_);
+        exporter_ = std::move(exporter);
+        export_failing_ = false;
+    }
+    enabled_.store(true, std::memory_order_relaxed);
+    worker_ = std::thread(&Tracer::run, this);
+}
+
+std::shared_ptr<Trace> Tracer::start_trace(std::string_view traceparent) {
+    if (!enabled()) return nullptr;
+
+    // Parent-based: follow the caller's decision when there is one
+    if (!traceparent.empty()) {
+        if (const auto parent = parse_traceparent(traceparent)) {
+            if (!parent->sampled()) return nullptr;
+            return std::make_shared<Trace>(*parent);
+        }
+    }
+
+    const uint64_t threshold = sample_threshold_.load(std::memory_order_relaxed);
+    if (threshold < kSampleAll && (random_u64() & (kSampleAll - 1)) >= threshold) return nullptr;
+    return std::make_shared<Trace>(SpanContext{});
+}
+
+void Tracer::finish(const std::shared_ptr<Trace>& trace) {
+    if (!trace) return;
+    std::vector<SpanData> spans;
+    {
+        std::lock_guard<std::mutex> lock(trace->mutex_);
+        trace->finished_ = true;
+        spans.swap(trace->spans_);
+    }
+    if (spans.empty()) return;
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queue_.size() + spans.size() > options_.max_queued_spans) {
+        dropped_.fetch_add(spans.size(), std::memory_order_relaxed);
+        return;
+    }
+    queue_.insert(queue_.end(), std::make_move_iterator(spans.begin()), std::make_move_iterator(spans.end()));
+}
+
+void Tracer::flush() {
+    export_queued(true);
+}
+
+void Tracer::export_queued(const bool report) {
+    std::lock_guard<std::mutex> export_lock(export_mutex_);
+    std::vector<SpanData> batch;
+    std::string service_name;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        batch.swap(queue_);
+        service_name = options_.service_name;
+    }
+    if (batch.empty() || !exporter_) return;
+
+    const bool ok = exporter_->export_json(encode_otlp_json(batch, service_name));
+    // Report the first failure of a run, not every batch
+    if (!ok && !export_failing_ && report) {
+        Logger::instance().warn("Trace export failed; dropping " + std::to_string(batch.size()) + " spans until the collector recovers");
+    }
+    export_failing_ = !ok;
+}
+
+void Tracer::run() {
+    std::unique_lock<std::mutex> lock(worker_mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, options_.export_interval, [this] { return stopping_; });
+        lock.unlock();
+        export_queued(true);
+        lock.lock();
+    }
+    // Last batch; the logger may already be gone at exit, so failures go unreported
+    lock.unlock();
+    export_queued(false);
+}
+
+void Tracer::shutdown() {
+    if (!worker_.joinable()) return;
+    enabled_.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+    stopping_ = false;
+}
+
+} // namespace blaze
@@ -0,0 +1,63 @@
+#include <blaze/util/arena.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <new>
+
+namespace blaze {
+
+namespace {
+    constexpr std::size_t align_up(std::size_t n, std::size_t align) {
+        return (n + align - 1) & ~(align - 1);
+    }
+}
+
+Arena::Arena(std::size_t capacity) : capacity_(capacity) {
+    if (capacity_ > 0) {
+        block_ = static_cast<std::byte*>(::operator new(capacity_));
+    }
+}
+
+Arena::~Arena() {
+    release_spills();
+    ::operator delete(block_);
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    const auto base = reinterpret_cast<std::uintptr_t>(block_);
+    const std::size_t start = align_up(base + offset_, alignment) - base;
+    if (block_ && start + bytes <= capacity_) {
+        offset_ = start + bytes;
+        return block_ + start;
+    }
+
+    // Spill to the heap; reset() folds this into the next block size
+    const std::size_t align = std::max(alignment, alignof(Spill));
+    const std::size_t header = align_up(sizeof(Spill), align);
+    auto* raw = static_cast<std::byte*>(::operator new(header + bytes, std::align_val_t{align}));
+    spills_ = new (raw) Spill{spills_, align};
+    spilled_ += bytes + alignment;
+    return raw + header;
+}
+
+void Arena::release_spills() {
+    while (spills_) {
+        Spill* next = spills_->next;
+        ::operator delete(spills_, std::align_val_t{spills_->align});
+        spills_ = next;
+    }
+    spilled_ = 0;
+}
+
+void Arena::reset() {
+    if (spills_) {
+        const std::size_t wanted = std::bit_ceil(offset_ + spilled_);
+        release_spills();
+        ::operator delete(block_);
+        block_ = static_cast<std::byte*>(::operator new(wanted));
+        capacity_ = wanted;
+    }
+    offset_ = 0;
+}
+
+} // namespace blaze
@@ -0,0 +1,558 @@
+#include <blaze/util/compression.h>
+#include <boost/beast/zlib/deflate_stream.hpp>
+#include <boost/beast/zlib/inflate_stream.hpp>
+#include <boost/crc.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef BLAZE_HAS_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+
+namespace blaze::util {
+
+namespace zlib = boost::beast::zlib;
+
+namespace {
+    // Fixed gzip header: magic, deflate, no flags, no mtime, no extra flags, unknown OS
+    constexpr unsigned char kGzipHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+
+    constexpr size_t kOutputStep = 16 * 1024;
+
+    // gzip headers can carry a file name and comment; anything longer than this is garbage
+    constexpr size_t kMaxGzipHeader = 64 * 1024;
+
+    std::uint32_t read_le32(std::string_view in) {
+        std::uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = (value << 8) | static_cast<unsigned char>(in[i]);
+        return value;
+    }
+
+    std::uint32_t read_be32(std::string_view in) {
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value = (value << 8) | static_cast<unsigned char>(in[i]);
+        return value;
+    }
+
+    // Length of the gzip member header at the front of `in`; 0 while more bytes are needed
+    size_t gzip_header_length(std::string_view in) {
+        if (in.size() < 10) return 0;
+        const auto byte = [&](size_t i) { return static_cast<unsigned char>(in[i]); };
+        if (byte(0) != 0x1f || byte(1) != 0x8b || byte(2) != 8 || (byte(3) & 0xe0)) {
+            throw std::runtime_error("gzip: bad header");
+        }
+        const unsigned flags = byte(3);
+        size_t length = 10;
+        if (flags & 0x04) { // FEXTRA
+            if (in.size() < length + 2) return 0;
+            length += 2 + (byte(length) | (byte(length + 1) << 8));
+        }
+        for (const unsigned flag : {0x08u, 0x10u}) { // FNAME, FCOMMENT: zero-terminated
+            if (!(flags & flag)) continue;
+            if (length >= in.size()) return 0;
+            const size_t end = in.find('\0', length);
+            if (end == std::string_view::npos) return 0;
+            length = end + 1;
+        }
+        if (flags & 0x02) length += 2; // FHCRC
+        return in.size() >= length ? length : 0;
+    }
+
+    // RFC 1950 header: deflate method, a check that makes the pair divisible by 31, no preset dictionary
+    bool is_zlib_header(unsigned char cmf, unsigned char flg) {
+        return (cmf & 0x0f) == 8 && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0 && !(flg & 0x20);
+    }
+
+    void append_le32(std::string& out, std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    void append_be32(std::string& out, std::uint32_t value) {
+        for (int i = 3; i >= 0; --i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    // Running checksum for the trailer: CRC-32 and length for gzip, Adler-32 for zlib
+    class Checksum {
+    public:
+        explicit Checksum(ContentCoding coding) : coding_(coding) {}
+
+        void update(std::string_view data) {
+            size_ += static_cast<std::uint32_t>(data.size());
+            if (coding_ == ContentCoding::gzip) {
+                crc_.process_bytes(data.data(), data.size());
+                return;
+            }
+            // Reduced every 5552 bytes so the sums can't overflow 32 bits
+            while (!data.empty()) {
+                const size_t n = std::min<size_t>(data.size(), 5552);
+                for (size_t i = 0; i < n; ++i) {
+                    a_ += static_cast<unsigned char>(data[i]);
+                    b_ += a_;
+                }
+                a_ %= 65521;
+                b_ %= 65521;
+                data.remove_prefix(n);
+            }
+        }
+
+        std::uint32_t crc() const { return crc_.checksum(); }
+        std::uint32_t adler() const { return (b_ << 16) | a_; }
+        std::uint32_t size() const { return size_; } // Modulo 2^32, as gzip's ISIZE is
+
+    private:
+        ContentCoding coding_;
+        boost::crc_32_type crc_;
+        std::uint32_t a_ = 1;
+        std::uint32_t b_ = 0;
+        std::uint32_t size_ = 0;
+    };
+
+    void append_header(ContentCoding coding, int level, std::string& out) {
+        if (coding == ContentCoding::gzip) {
+            out.append(reinterpret_cast<const char*>(kGzipHeader), sizeof(kGzipHeader));
+        } else if (coding == ContentCoding::deflate) {
+            // CMF 0x78 (32K window), FLG carries the level hint and makes the pair divisible by 31
+            out.push_back(static_cast<char>(0x78));
+            out.push_back(static_cast<char>(level <= 1 ? 0x01 : level <= 5 ? 0x5e : level <= 6 ? 0x9c : 0xda));
+        }
+    }
+
+    void append_trailer(ContentCoding coding, const Checksum& sum, std::string& out) {
+        if (coding == ContentCoding::gzip) {
+            append_le32(out, sum.crc());
+            append_le32(out, sum.size());
+        } else if (coding == ContentCoding::deflate) {
+            append_be32(out, sum.adler());
+        }
+    }
+
+    // Feeds `data` through `deflate`, growing `out` as needed
+    void run_deflate(zlib::deflate_stream& deflate, std::string_view data, zlib::Flush flush, std::string& out) {
+        zlib::z_params zs;
+        zs.next_in = data.data();
+        zs.avail_in = data.size();
+        for (;;) {
+            const size_t used = out.size();
+            out.resize(used + std::max(kOutputStep, deflate.upper_bound(zs.avail_in) / 2));
+            zs.next_out = out.data() + used;
+            zs.avail_out = out.size() - used;
+
+            boost::system::error_code ec;
+            deflate.write(zs, flush, ec);
+            const bool full = zs.avail_out == 0;
+            out.resize(out.size() - zs.avail_out);
+
+            if (ec == zlib::error::end_of_stream) return;
+            if (ec && ec != zlib::error::need_buffers) throw std::runtime_error("deflate: " + ec.message());
+            if (!full && zs.avail_in == 0 && flush != zlib::Flush::finish) return;
+        }
+    }
+
+    // Contexts are reset, not rebuilt, between uses on a thread; Beast keeps the buffers
+    zlib::deflate_stream& thread_deflate(int level) {
+        thread_local zlib::deflate_stream deflate;
+        deflate.reset(std::clamp(level, 1, 9), 15, 8, zlib::Strategy::normal);
+        return deflate;
+    }
+
+    bool iequals(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    // "q=0", "q=0.0" and "q=0.000" all mean "not acceptable"
+    bool is_refusal(std::string_view params) {
+        const size_t q = params.find("q=");
+        if (q == std::string_view::npos) return false;
+        std::string_view value = trim(params.substr(q + 2));
+        value = value.substr(0, value.find(';'));
+        return !value.empty() && value.find_first_not_of("0.") == std::string_view::npos;
+    }
+}
+
+std::string_view coding_name(ContentCoding coding) {
+    switch (coding) {
+        case ContentCoding::gzip: return "gzip";
+        case ContentCoding::deflate: return "deflate";
+        case ContentCoding::br: return "br";
+        default: return {};
+    }
+}
+
+std::string gzip_compress(std::string_view data, int level) {
+    std::string out;
+    compress(ContentCoding::gzip, data, level, out);
+    return out;
+}
+
+bool brotli_available() {
+#ifdef BLAZE_HAS_BROTLI
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string brotli_compress(std::string_view data, int quality) {
+#ifdef BLAZE_HAS_BROTLI
+    std::string out(BrotliEncoderMaxCompressedSize(data.size()), '\0');
+    size_t size = out.size();
+    if (out.empty() ||
+        !BrotliEncoderCompress(std::clamp(quality, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY), BROTLI_DEFAULT_WINDOW,
+                               BROTLI_MODE_GENERIC, data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+                               &size, reinterpret_cast<uint8_t*>(out.data()))) {
+        throw std::runtime_error("brotli: compression failed");
+    }
+    out.resize(size);
+    return out;
+#else
+    (void)data;
+    (void)quality;
+    throw std::runtime_error("brotli: Blaze was built without libbrotlienc");
+#endif
+}
+
+void compress(ContentCoding coding, std::string_view data, int level, std::string& out) {
+    if (coding == ContentCoding::identity) {
+        out.append(data);
+        return;
+    }
+    if (coding == ContentCoding::br) {
+        out.append(brotli_compress(data, level));
+        return;
+    }
+
+    zlib::deflate_stream& deflate = thread_deflate(level);
+    out.reserve(out.size() + deflate.upper_bound(data.size()) + 18);
+    append_header(coding, level, out);
+    run_deflate(deflate, data, zlib::Flush::finish, out);
+
+    Checksum sum(coding);
+    sum.update(data);
+    append_trailer(coding, sum, out);
+}
+
+struct StreamCompressor::Impl {
+    Impl(ContentCoding coding, int level) : coding(coding), level(level) {}
+
+    ContentCoding coding;
+    int level;
+    bool started = false;
+    zlib::deflate_stream deflate;
+    Checksum sum{coding};
+#ifdef BLAZE_HAS_BROTLI
+    BrotliEncoderState* brotli = nullptr;
+
+    void run_brotli(std::string_view data, BrotliEncoderOperation op, std::string& out) {
+        const uint8_t* next_in = reinterpret_cast<const uint8_t*>(data.data());
+        size_t avail_in = data.size();
+        for (;;) {
+            size_t avail_out = 0;
+            if (!BrotliEncoderCompressStream(brotli, op, &avail_in, &next_in, &avail_out, nullptr, nullptr)) {
+                throw std::runtime_error("brotli: compression failed");
+            }
+            size_t size = 0;
+            const uint8_t* output = BrotliEncoderTakeOutput(brotli, &size);
+            out.append(reinterpret_cast<const char*>(output), size);
+
+            if (avail_in == 0 && !BrotliEncoderHasMoreOutput(brotli) &&
+                (op != BROTLI_OPERATION_FINISH || BrotliEncoderIsFinished(brotli))) {
+                return;
+            }
+        }
+    }
+#endif
+};
+
+StreamCompressor::StreamCompressor(ContentCoding coding, int level) : impl_(std::make_unique<Impl>(coding, level)) {
+    if (coding == ContentCoding::gzip || coding == ContentCoding::deflate) {
+        impl_->deflate.reset(std::clamp(level, 1, 9), 15, 8, zlib::Strategy::normal);
+    } else if (coding == ContentCoding::br) {
+#ifdef BLAZE_HAS_BROTLI
+        impl_->brotli = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!impl_->brotli) throw std::bad_alloc();
+        BrotliEncoderSetParameter(impl_->brotli, BROTLI_PARAM_QUALITY,
+                                  static_cast<uint32_t>(std::clamp(level, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY)));
+#else
+        throw std::runtime_error("brotli: Blaze was built without libbrotlienc");
+#endif
+    }
+}
+
+StreamCompressor::~StreamCompressor() {
+#ifdef BLAZE_HAS_BROTLI
+    if (impl_->brotli) BrotliEncoderDestroyInstance(impl_->brotli);
+#endif
+}
+
+void StreamCompressor::write(std::string_view data, std::string& out, bool flush) {
+    switch (impl_->coding) {
+        case ContentCoding::identity:
+            out.append(data);
+            return;
+        case ContentCoding::br:
+#ifdef BLAZE_HAS_BROTLI
+            impl_->run_brotli(data, flush ? BROTLI_OPERATION_FLUSH : BROTLI_OPERATION_PROCESS, out);
+#endif
+            return;
+        default:
+            if (!impl_->started) append_header(impl_->coding, impl_->level, out);
+            impl_->started = true;
+            impl_->sum.update(data);
+            run_deflate(impl_->deflate, data, flush ? zlib::Flush::sync : zlib::Flush::none, out);
+            return;
+    }
+}
+
+void StreamCompressor::finish(std::string& out) {
+    switch (impl_->coding) {
+        case ContentCoding::identity:
+            return;
+        case ContentCoding::br:
+#ifdef BLAZE_HAS_BROTLI
+            impl_->run_brotli({}, BROTLI_OPERATION_FINISH, out);
+#endif
+            return;
+        default:
+            if (!impl_->started) append_header(impl_->coding, impl_->level, out);
+            impl_->started = true;
+            run_deflate(impl_->deflate, {}, zlib::Flush::finish, out);
+            append_trailer(impl_->coding, impl_->sum, out);
+            return;
+    }
+}
+
+struct StreamDecompressor::Impl {
+    enum class Stage { header, body, trailer, done };
+
+    explicit Impl(ContentCoding coding) : coding(coding) {}
+
+    ContentCoding coding;
+    Stage stage = Stage::header;
+    bool raw = false;    // "deflate" sent without the zlib wrapper
+    std::string pending; // Header or trailer bytes seen so far
+    zlib::inflate_stream inflate;
+    Checksum sum{coding};
+#ifdef BLAZE_HAS_BROTLI
+    BrotliDecoderState* brotli = nullptr;
+#endif
+
+    size_t trailer_size() const {
+        if (raw) return 0;
+        return coding == ContentCoding::gzip ? 8 : 4;
+    }
+
+    // Consumes header bytes; returns the input that follows the header once it is complete
+    std::string_view read_header(std::string_view data, std::string& rest) {
+        pending.append(data);
+        size_t length = 0;
+        if (coding == ContentCoding::gzip) {
+            length = gzip_header_length(pending);
+            if (length == 0 && pending.size() > kMaxGzipHeader) throw std::runtime_error("gzip: bad header");
+        } else if (pending.size() >= 2) {
+            raw = !is_zlib_header(static_cast<unsigned char>(pending[0]), static_cast<unsigned char>(pending[1]));
+            length = raw ? 0 : 2;
+        } else {
+            return {};
+        }
+        if (length == 0 && !raw) return {};
+
+        rest = pending.substr(length);
+        pending.clear();
+        stage = Stage::body;
+        return rest;
+    }
+
+    // Inflates as much of `data` as it can; returns the bytes consumed
+    size_t run_inflate(std::string_view data, std::string& out, size_t limit) {
+        zlib::z_params zs;
+        zs.next_in = data.data();
+        zs.avail_in = data.size();
+        for (;;) {
+            const size_t used = out.size();
+            if (used > limit) throw std::length_error("decompressed body exceeds the size limit");
+            // One byte of headroom past the limit tells "exactly at the limit" from "over it"
+            out.resize(used + std::min(std::max(kOutputStep, zs.avail_in * 4), limit - used + 1));
+            zs.next_out = out.data() + used;
+            zs.avail_out = out.size() - used;
+
+            boost::system::error_code ec;
+            inflate.write(zs, zlib::Flush::none, ec);
+            const bool full = zs.avail_out == 0;
+            out.resize(out.size() - zs.avail_out);
+            sum.update(std::string_view(out).substr(used));
+
+            if (out.size() > limit) throw std::length_error("decompressed body exceeds the size limit");
+            if (ec == zlib::error::end_of_stream) {
+                stage = trailer_size() ? Stage::trailer : Stage::done;
+                break;
+            }
+            if (ec && ec != zlib::error::need_buffers) throw std::runtime_error("inflate: " + ec.message());
+            if (!full) break;
+        }
+        return data.size() - zs.avail_in;
+    }
+
+    // Consumes trailer bytes; returns how many
+    size_t read_trailer(std::string_view data) {
+        const size_t n = std::min(data.size(), trailer_size() - pending.size());
+        pending.append(data.substr(0, n));
+        if (pending.size() < trailer_size()) return n;
+
+        const bool valid = coding == ContentCoding::gzip
+            ? read_le32(pending) == sum.crc() && read_le32(std::string_view(pending).substr(4)) == sum.size()
+            : read_be32(pending) == sum.adler();
+        if (!valid) throw std::runtime_error(std::string(coding_name(coding)) + ": checksum mismatch");
+        pending.clear();
+        stage = Stage::done;
+        return n;
+    }
+
+#ifdef BLAZE_HAS_BROTLI
+    void run_brotli(std::string_view data, std::string& out, size_t limit) {
+        const uint8_t* next_in = reinterpret_cast<const uint8_t*>(data.data());
+        size_t avail_in = data.size();
+        for (;;) {
+            size_t avail_out = 0;
+            const BrotliDecoderResult result =
+                BrotliDecoderDecompressStream(brotli, &avail_in, &next_in, &avail_out, nullptr, nullptr);
+            if (result == BROTLI_DECODER_RESULT_ERROR) throw std::runtime_error("brotli: malformed input");
+
+            while (BrotliDecoderHasMoreOutput(brotli)) {
+                if (out.size() > limit) throw std::length_error("decompressed body exceeds the size limit");
+                size_t size = limit - out.size() + 1;
+                const uint8_t* output = BrotliDecoderTakeOutput(brotli, &size);
+                out.append(reinterpret_cast<const char*>(output), size);
+            }
+            if (out.size() > limit) throw std::length_error("decompressed body exceeds the size limit");
+
+            if (result == BROTLI_DECODER_RESULT_SUCCESS) {
+                if (avail_in > 0) throw std::runtime_error("brotli: data after the end of the stream");
+                stage = Stage::done;
+                return;
+            }
+            if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) return;
+        }
+    }
+#endif
+};
+
+std::optional<ContentCoding> parse_coding(std::string_view content_encoding) {
+    content_encoding = trim(content_encoding);
+    if (content_encoding.empty() || iequals(content_encoding, "identity")) return ContentCoding::identity;
+    if (iequals(content_encoding, "gzip") || iequals(content_encoding, "x-gzip")) return ContentCoding::gzip;
+    if (iequals(content_encoding, "deflate")) return ContentCoding::deflate;
+    if (iequals(content_encoding, "br") && brotli_available()) return ContentCoding::br;
+    return std::nullopt;
+}
+
+StreamDecompressor::StreamDecompressor(ContentCoding coding) : impl_(std::make_unique<Impl>(coding)) {
+    if (coding == ContentCoding::gzip || coding == ContentCoding::deflate) {
+        impl_->inflate.reset(15);
+    } else if (coding == ContentCoding::br) {
+#ifdef BLAZE_HAS_BROTLI
+        impl_->brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!impl_->brotli) throw std::bad_alloc();
+        impl_->stage = Impl::Stage::body;
+#else
+        throw std::runtime_error("brotli: Blaze was built without libbrotlidec");
+#endif
+    } else {
+        impl_->stage = Impl::Stage::body;
+    }
+}
+
+StreamDecompressor::~StreamDecompressor() {
+#ifdef BLAZE_HAS_BROTLI
+    if (impl_->brotli) BrotliDecoderDestroyInstance(impl_->brotli);
+#endif
+}
+
+void StreamDecompressor::write(std::string_view data, std::string& out, std::size_t limit) {
+    Impl& s = *impl_;
+    if (s.coding == ContentCoding::identity) {
+        if (out.size() + data.size() > limit) throw std::length_error("decompressed body exceeds the size limit");
+        out.append(data);
+        return;
+    }
+#ifdef BLAZE_HAS_BROTLI
+    if (s.coding == ContentCoding::br) {
+        if (s.stage == Impl::Stage::done && !data.empty()) {
+            throw std::runtime_error("brotli: data after the end of the stream");
+        }
+        if (!data.empty()) s.run_brotli(data, out, limit);
+        return;
+    }
+#endif
+
+    std::string rest; // Input that arrived together with a header
+    while (!data.empty()) {
+        switch (s.stage) {
+            case Impl::Stage::header:
+                data = s.read_header(data, rest);
+                break;
+            case Impl::Stage::body: {
+                const size_t used = s.run_inflate(data, out, limit);
+                data.remove_prefix(used);
+                if (s.stage == Impl::Stage::body && !data.empty()) throw std::runtime_error("inflate: stalled");
+                break;
+            }
+            case Impl::Stage::trailer:
+                data.remove_prefix(s.read_trailer(data));
+                break;
+            case Impl::Stage::done:
+                // gzip bodies may be several members back to back
+                if (s.coding != ContentCoding::gzip) {
+                    throw std::runtime_error(std::string(coding_name(s.coding)) + ": data after the end of the stream");
+                }
+                s.stage = Impl::Stage::header;
+                s.inflate.reset(15);
+                s.sum = Checksum(s.coding);
+                break;
+        }
+    }
+}
+
+void StreamDecompressor::finish() {
+    if (impl_->coding != ContentCoding::identity && impl_->stage != Impl::Stage::done) {
+        throw std::runtime_error(std::string(coding_name(impl_->coding)) + ": truncated body");
+    }
+}
+
+bool accepts_encoding(std::string_view accept_encoding, std::string_view coding) {
+    bool wildcard = false;
+    while (!accept_encoding.empty()) {
+        const size_t comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view() : accept_encoding.substr(comma + 1);
+
+        const size_t semi = item.find(';');
+        const std::string_view name = trim(item.substr(0, semi));
+        const std::string_view params = semi == std::string_view::npos ? std::string_view() : item.substr(semi + 1);
+
+        // An explicit entry wins over "*"
+        if (iequals(name, coding)) return !is_refusal(params);
+        if (name == "*") wildcard = !is_refusal(params);
+    }
+    return wildcard;
+}
+
+bool is_compressible(std::string_view content_type) {
+    content_type = content_type.substr(0, content_type.find(';'));
+    if (content_type.substr(0, 5) == "text/") return true;
+    return content_type == "application/json" || content_type == "application/javascript" ||
+           content_type == "application/xml" || content_type == "image/svg+xml" ||
+           content_type == "application/wasm";
+}
+
+} // namespace blaze::util
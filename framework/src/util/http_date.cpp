@@ -0,0 +1,138 @@
+#include <blaze/util/http_date.h>
+#include <cstring>
+
+namespace blaze {
+
+namespace {
+    constexpr char kDays[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    constexpr char kMonths[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    char* put2(char* out, int value) {
+        *out++ = static_cast<char>('0' + value / 10);
+        *out++ = static_cast<char>('0' + value % 10);
+        return out;
+    }
+}
+
+// Hand-rolled instead of strftime so the output never depends on the C locale
+void HttpDate::format(const std::time_t t, char* out) {
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+
+    std::memcpy(out, kDays[tm.tm_wday], 3);
+    out += 3;
+    *out++ = ',';
+    *out++ = ' ';
+    out = put2(out, tm.tm_mday);
+    *out++ = ' ';
+    std::memcpy(out, kMonths[tm.tm_mon], 3);
+    out += 3;
+    *out++ = ' ';
+    const int year = tm.tm_year + 1900;
+    out = put2(out, year / 100);
+    out = put2(out, year % 100);
+    *out++ = ' ';
+    out = put2(out, tm.tm_hour);
+    *out++ = ':';
+    out = put2(out, tm.tm_min);
+    *out++ = ':';
+    out = put2(out, tm.tm_sec);
+    std::memcpy(out, " GMT", 4);
+}
+
+std::optional<std::time_t> HttpDate::parse(std::string_view text) {
+    // "Sun, 06 Nov 1994 08:49:37 GMT"
+    if (text.size() != kLength || text.substr(3, 2) != ", " || text.substr(25) != " GMT") return std::nullopt;
+
+    bool ok = true;
+    auto number = [&](std::size_t at, std::size_t digits) {
+        int value = 0;
+        for (std::size_t i = at; i < at + digits; ++i) {
+            if (text[i] < '0' || text[i] > '9') ok = false;
+            value = value * 10 + (text[i] - '0');
+        }
+        return value;
+    };
+
+    std::tm tm{};
+    tm.tm_mday = number(5, 2);
+    tm.tm_year = number(12, 4) - 1900;
+    tm.tm_hour = number(17, 2);
+    tm.tm_min = number(20, 2);
+    tm.tm_sec = number(23, 2);
+    tm.tm_mon = -1;
+    for (int m = 0; m < 12; ++m) {
+        if (text.substr(8, 3) == kMonths[m]) tm.tm_mon = m;
+    }
+    if (!ok || tm.tm_mon < 0 || text[7] != ' ' || text[11] != ' ' || text[16] != ' ' ||
+        text[19] != ':' || text[22] != ':' || tm.tm_mday < 1 || tm.tm_mday > 31 ||
+        tm.tm_hour > 23 || tm.tm_min > 59 || tm.tm_sec > 60) {
+        return std::nullopt;
+    }
+    return timegm(&tm);
+}
+
+HeaderBlock::HeaderBlock(std::string_view server_name) {
+    set_server(server_name);
+}
+
+void HeaderBlock::set_server(std::string_view server_name) {
+    server_ = server_name;
+    server_line_.assign("Server: ").append(server_).append("\r\n");
+    formatted_ = std::time(nullptr);
+    store_date(formatted_);
+}
+
+// The date is stored as relaxed atomic words, so a reader that overlaps a store reads
+// stale or mixed words rather than racing; the sequence check then throws them away
+void HeaderBlock::store_date(const std::time_t t) {
+    char text[kDateWords * 8] = {};
+    HttpDate::format(t, text);
+
+    const std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kDateWords; ++i) {
+        std::uint64_t word;
+        std::memcpy(&word, text + i * 8, 8);
+        date_[i].store(word, std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void HeaderBlock::refresh() {
+    const std::time_t now = std::time(nullptr);
+    if (now == formatted_) return;
+    store_date(now);
+    formatted_ = now;
+}
+
+void HeaderBlock::append_to(std::string& out, const bool date, const bool server) const {
+    if (date) {
+        char line[kDateLine];
+        std::memcpy(line, "Date: ", kDateAt);
+        const DateText text = this->date();
+        std::memcpy(line + kDateAt, text.data(), text.size());
+        std::memcpy(line + kDateAt + text.size(), "\r\n", 2);
+        out.append(line, kDateLine);
+    }
+    if (server) out.append(server_line_);
+}
+
+HeaderBlock::DateText HeaderBlock::date() const {
+    std::array<std::uint64_t, kDateWords> words;
+    for (;;) {
+        const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < kDateWords; ++i) {
+            words[i] = date_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && sequence_.load(std::memory_order_relaxed) == before) break;
+    }
+    DateText text;
+    std::memcpy(text.data(), words.data(), text.size());
+    return text;
+}
+
+} // namespace blaze
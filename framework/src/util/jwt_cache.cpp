@@ -0,0 +1,87 @@
+#include <blaze/util/jwt_cache.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace blaze {
+
+namespace {
+    // Splits "<header>.<payload>.<signature>" at its last dot
+    std::optional<std::pair<std::string_view, std::string_view>> split_token(std::string_view token) {
+        const size_t dot = token.rfind('.');
+        if (dot == std::string_view::npos || dot == 0 || dot + 1 == token.size()) return std::nullopt;
+        return std::pair{token.substr(0, dot), token.substr(dot + 1)};
+    }
+
+    int64_t expiry_of(const Json& claims) {
+        const boost::json::value& value = claims.value();
+        if (!value.is_object()) return 0;
+        const auto* exp = value.as_object().if_contains("exp");
+        if (!exp || !exp->is_number()) return 0;
+        // Fractional or huge values are valid NumericDates; compared with a whole `now`,
+        // the floor expires at the same second jwt_verify() does
+        const double seconds = std::floor(exp->to_number<double>());
+        if (seconds < 1) return 1;
+        if (seconds >= 9.2e18) return std::numeric_limits<int64_t>::max();
+        return static_cast<int64_t>(seconds);
+    }
+}
+
+JwtCache::JwtCache(size_t capacity, size_t shards) {
+    if (shards == 0) shards = std::max<size_t>(8, 2 * std::thread::hardware_concurrency());
+    shards = std::bit_ceil(shards);
+    mask_ = shards - 1;
+    per_shard_ = std::max<size_t>(1, capacity / shards);
+    shards_ = std::make_unique<Shard[]>(shards);
+}
+
+JwtCache::~JwtCache() = default;
+
+JwtCache::Shard& JwtCache::shard_for(std::string_view signature) const {
+    return shards_[Hash{}(signature) & mask_];
+}
+
+std::optional<Json> JwtCache::find(std::string_view token, std::time_t now) const {
+    const auto parts = split_token(token);
+    if (!parts) return std::nullopt;
+    const auto [signed_part, signature] = *parts;
+
+    Shard& shard = shard_for(signature);
+    std::shared_lock lock(shard.mutex);
+    const auto it = shard.entries.find(signature);
+    if (it == shard.entries.end()) return std::nullopt;
+    const Entry& entry = it->second;
+    if (entry.signed_part != signed_part) return std::nullopt;
+    if (entry.exp != 0 && now > entry.exp) return std::nullopt;
+    return entry.claims;
+}
+
+void JwtCache::insert(std::string_view token, Json claims) {
+    const auto parts = split_token(token);
+    if (!parts) return;
+    const auto [signed_part, signature] = *parts;
+    const int64_t exp = expiry_of(claims);
+
+    Shard& shard = shard_for(signature);
+    std::unique_lock lock(shard.mutex);
+    if (shard.entries.size() >= per_shard_ && !shard.entries.contains(signature)) {
+        const int64_t now = std::time(nullptr);
+        std::erase_if(shard.entries, [now](const auto& e) { return e.second.exp != 0 && now > e.second.exp; });
+        if (shard.entries.size() >= per_shard_) shard.entries.erase(shard.entries.begin());
+    }
+    shard.entries.insert_or_assign(std::string(signature), Entry{std::string(signed_part), std::move(claims), exp});
+}
+
+size_t JwtCache::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+        std::shared_lock lock(shards_[i].mutex);
+        total += shards_[i].entries.size();
+    }
+    return total;
+}
+
+} // namespace blaze
@@ -0,0 +1,78 @@
+#include <blaze/util/rate_limiter.h>
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace blaze {
+
+namespace {
+    int64_t to_ns(RateLimiter::Clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+}
+
+RateLimiter::RateLimiter(int limit, std::chrono::nanoseconds window, size_t shards)
+    : limit_(limit), window_ns_(window.count()) {
+    if (limit <= 0 || window.count() <= 0) {
+        throw std::invalid_argument("RateLimiter: limit and window must be positive");
+    }
+    interval_ns_ = std::max<int64_t>(window_ns_ / limit, 1);
+
+    if (shards == 0) shards = std::max<size_t>(16, 4 * std::thread::hardware_concurrency());
+    shards = std::bit_ceil(shards);
+    mask_ = shards - 1;
+    shards_ = std::make_unique<Shard[]>(shards);
+}
+
+RateLimiter::~RateLimiter() = default;
+
+RateLimiter::Decision RateLimiter::acquire(std::string_view key, Clock::time_point now) {
+    const int64_t t = to_ns(now);
+    const Probe probe{key, Hash{}(key)};
+    Shard& shard = shards_[probe.hash & mask_];
+    {
+        std::shared_lock lock(shard.mutex);
+        if (auto it = shard.clients.find(probe); it != shard.clients.end()) return update(it->second, t);
+    }
+
+    std::unique_lock lock(shard.mutex);
+    if (t >= shard.next_sweep) sweep(shard, t);
+    auto it = shard.clients.find(probe);
+    if (it == shard.clients.end()) it = shard.clients.try_emplace(std::string(key), 0).first;
+    return update(it->second, t);
+}
+
+RateLimiter::Decision RateLimiter::update(std::atomic<int64_t>& tat, int64_t now) const {
+    int64_t current = tat.load(std::memory_order_relaxed);
+    for (;;) {
+        const int64_t next = std::max(current, now) + interval_ns_;
+        if (next - now > window_ns_) {
+            const auto wait = std::chrono::nanoseconds(next - window_ns_ - now);
+            return {false, 0, std::chrono::ceil<std::chrono::milliseconds>(wait)};
+        }
+        if (tat.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+            return {true, static_cast<int>((now + window_ns_ - next) / interval_ns_), std::chrono::milliseconds(0)};
+        }
+    }
+}
+
+void RateLimiter::sweep(Shard& shard, int64_t now) {
+    // Caller holds the unique lock, so no update is in flight
+    std::erase_if(shard.clients, [now](const auto& entry) {
+        return entry.second.load(std::memory_order_relaxed) <= now;
+    });
+    shard.next_sweep = now + window_ns_;
+}
+
+size_t RateLimiter::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+        std::shared_lock lock(shards_[i].mutex);
+        total += shards_[i].clients.size();
+    }
+    return total;
+}
+
+} // namespace blaze
@@ -13,27 +13,38 @@ namespace {
         if (c >= 'A' && c <= 'F') return c - 'A' + 10;
         return -1;
     }
-}
 
-std::string url_decode(std::string_view str) {
-    std::string result;
-    result.reserve(str.size());
-    for (size_t i = 0; i < str.size(); ++i) {
-        if (str[i] == '+') {
-            result += ' ';
-        } else if (str[i] == '%' && i + 2 < str.size()) {
-            int hi = hex_to_int(str[i + 1]);
-            int lo = hex_to_int(str[i + 2]);
-            if (hi != -1 && lo != -1) {
-                result += static_cast<char>((hi << 4) | lo);
-                i += 2;
+    template<typename String>
+    void decode_into(std::string_view str, String& result) {
+        result.reserve(str.size());
+        for (size_t i = 0; i < str.size(); ++i) {
+            if (str[i] == '+') {
+                result += ' ';
+            } else if (str[i] == '%' && i + 2 < str.size()) {
+                int hi = hex_to_int(str[i + 1]);
+                int lo = hex_to_int(str[i + 2]);
+                if (hi != -1 && lo != -1) {
+                    result += static_cast<char>((hi << 4) | lo);
+                    i += 2;
+                } else {
+                    result += '%';
+                }
             } else {
-                result += '%';
+                result += str[i];
             }
-        } else {
-            result += str[i];
         }
     }
+}
+
+std::string url_decode(std::string_view str) {
+    std::string result;
+    decode_into(str, result);
+    return result;
+}
+
+std::pmr::string url_decode(std::string_view str, std::pmr::memory_resource* mr) {
+    std::pmr::string result(mr);
+    decode_into(str, result);
     return result;
 }
 
@@ -49,6 +60,29 @@ std::string hex_encode(std::string_view input) {
     return result;
 }
 
+void append_json_string(std::string& out, std::string_view value) {
+    static constexpr char hex_chars[] = "0123456789abcdef";
+    out += '"';
+    for (const char c : value) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += hex_chars[(c >> 4) & 0x0f];
+                    out += hex_chars[c & 0x0f];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
 std::string to_snake_case(std::string_view name) {
     // Strip namespace if present (e.g. "blaze::User" -> "User")
     size_t last_colon = name.find_last_of(':');
@@ -197,6 +197,9 @@ int main() {
         co_return;
     });
 
+    // Same body as /health, served from the pre-serialized fast path
+    app.get_static("/health/static", "OK");
+
     // NEW: Test Implicit JSON Conversion
     app.get("/modern-json", []() -> Async<Json> {
         co_return Json{{"status", "modern"}, {"version", 2}};
@@ -243,6 +246,10 @@ int main() {
         }
     });
 
+#ifdef BLAZE_HAS_HTTP2
+    app.h2c(true); // Lets tools/benchmark.sh compare HTTP/2 against HTTP/1.1
+#endif
+
     blaze::info("Integration App running on :8080");
     app.listen(8080);
 
@@ -0,0 +1,529 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/util/compression.h>
+#include <blaze/app.h>
+#include <blaze/middleware.h>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/zlib/inflate_stream.hpp>
+#include <boost/crc.hpp>
+
+#ifdef BLAZE_HAS_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace blaze;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+    std::string inflate_raw(std::string_view data) {
+        namespace zlib = boost::beast::zlib;
+        std::string out(4 << 20, '\0');
+        zlib::inflate_stream inflate;
+        zlib::z_params zs;
+        zs.next_in = data.data();
+        zs.avail_in = data.size();
+        zs.next_out = out.data();
+        zs.avail_out = out.size();
+        boost::system::error_code ec;
+        inflate.write(zs, zlib::Flush::finish, ec);
+        out.resize(zs.total_out);
+        return out;
+    }
+
+    uint32_t read32(std::string_view data, bool big_endian) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const uint32_t byte = static_cast<unsigned char>(data[big_endian ? i : 3 - i]);
+            value = (value << 8) | byte;
+        }
+        return value;
+    }
+
+    // Unwraps a gzip member produced by gzip_compress() (fixed 10-byte header)
+    std::string gunzip(const std::string& data) {
+        REQUIRE(data.size() >= 18);
+        REQUIRE(static_cast<unsigned char>(data[0]) == 0x1f);
+        REQUIRE(static_cast<unsigned char>(data[1]) == 0x8b);
+
+        std::string out = inflate_raw(std::string_view(data).substr(10, data.size() - 18));
+        boost::crc_32_type check;
+        check.process_bytes(out.data(), out.size());
+        CHECK(read32(std::string_view(data).substr(data.size() - 8), false) == check.checksum());
+        CHECK(read32(std::string_view(data).substr(data.size() - 4), false) == out.size());
+        return out;
+    }
+
+    // Unwraps a zlib stream (the "deflate" content coding)
+    std::string unzlib(const std::string& data) {
+        REQUIRE(data.size() >= 6);
+        REQUIRE(static_cast<unsigned char>(data[0]) == 0x78);
+        REQUIRE((static_cast<unsigned char>(data[0]) * 256 + static_cast<unsigned char>(data[1])) % 31 == 0);
+
+        std::string out = inflate_raw(std::string_view(data).substr(2, data.size() - 6));
+        uint32_t a = 1, b = 0;
+        for (unsigned char c : out) {
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+        CHECK(read32(std::string_view(data).substr(data.size() - 4), true) == ((b << 16) | a));
+        return out;
+    }
+
+#ifdef BLAZE_HAS_BROTLI
+    std::string unbrotli(const std::string& data) {
+        std::string out(4 << 20, '\0');
+        size_t size = out.size();
+        REQUIRE(BrotliDecoderDecompress(data.size(), reinterpret_cast<const uint8_t*>(data.data()), &size,
+                                        reinterpret_cast<uint8_t*>(out.data())) == BROTLI_DECODER_RESULT_SUCCESS);
+        out.resize(size);
+        return out;
+    }
+#endif
+
+    std::string decode(std::string_view coding, const std::string& data) {
+        if (coding == "gzip") return gunzip(data);
+        if (coding == "deflate") return unzlib(data);
+#ifdef BLAZE_HAS_BROTLI
+        if (coding == "br") return unbrotli(data);
+#endif
+        return data;
+    }
+}
+
+TEST_CASE("Compression: gzip and brotli", "[compression]") {
+    std::string text;
+    for (int i = 0; i < 2000; ++i) text += "line " + std::to_string(i % 17) + " of some repetitive text\n";
+
+    SECTION("gzip round-trips and shrinks repetitive input") {
+        const std::string packed = util::gzip_compress(text);
+        CHECK(packed.size() < text.size() / 4);
+        CHECK(gunzip(packed) == text);
+        CHECK(gunzip(util::gzip_compress("")).empty());
+    }
+
+#ifdef BLAZE_HAS_BROTLI
+    SECTION("brotli round-trips") {
+        REQUIRE(util::brotli_available());
+        const std::string packed = util::brotli_compress(text);
+        CHECK(packed.size() < text.size() / 4);
+        CHECK(unbrotli(packed) == text);
+    }
+#else
+    SECTION("brotli reports that it is unavailable") {
+        CHECK_FALSE(util::brotli_available());
+        CHECK_THROWS(util::brotli_compress(text));
+    }
+#endif
+}
+
+TEST_CASE("Compression: One-shot and Streaming Compressors", "[compression]") {
+    std::string text;
+    for (int i = 0; i < 5000; ++i) text += "{\"id\": " + std::to_string(i) + ", \"name\": \"user\"},";
+
+    std::vector<util::ContentCoding> codings = {util::ContentCoding::gzip, util::ContentCoding::deflate};
+    if (util::brotli_available()) codings.push_back(util::ContentCoding::br);
+
+    for (const auto coding : codings) {
+        const auto name = util::coding_name(coding);
+        CAPTURE(name);
+
+        // The per-thread context is reused across calls and levels
+        for (int level : {1, 6, 9}) {
+            std::string packed;
+            util::compress(coding, text, level, packed);
+            CHECK(packed.size() < text.size() / 4);
+            CHECK(decode(name, packed) == text);
+        }
+
+        util::StreamCompressor stream(coding, 6);
+        std::string out;
+        for (size_t at = 0; at < text.size(); at += 7000) stream.write(std::string_view(text).substr(at, 7000), out);
+        stream.finish(out);
+        CHECK(decode(name, out) == text);
+
+        // A flushed write is decodable on its own, before the stream ends
+        util::StreamCompressor events(coding, 6);
+        std::string first;
+        events.write("data: hello\n\n", first, true);
+        CHECK(!first.empty());
+        std::string rest = first;
+        events.write("data: world\n\n", rest, true);
+        events.finish(rest);
+        CHECK(decode(name, rest) == "data: hello\n\ndata: world\n\n");
+        if (coding != util::ContentCoding::br) {
+            // Raw inflate of the flushed prefix yields the first event
+            const size_t header = coding == util::ContentCoding::gzip ? 10 : 2;
+            CHECK(inflate_raw(std::string_view(first).substr(header)) == "data: hello\n\n");
+        }
+    }
+}
+
+TEST_CASE("Compression: Streaming Decompressor", "[compression]") {
+    std::string text;
+    for (int i = 0; i < 5000; ++i) text += "{\"id\": " + std::to_string(i) + ", \"name\": \"user\"},";
+
+    auto unpack = [](util::ContentCoding coding, std::string_view packed, size_t piece,
+                     size_t limit = 1 << 20) {
+        util::StreamDecompressor decoder(coding);
+        std::string out;
+        for (size_t at = 0; at < packed.size(); at += piece) decoder.write(packed.substr(at, piece), out, limit);
+        decoder.finish();
+        return out;
+    };
+
+    std::vector<util::ContentCoding> codings = {util::ContentCoding::gzip, util::ContentCoding::deflate};
+    if (util::brotli_available()) codings.push_back(util::ContentCoding::br);
+
+    for (const auto coding : codings) {
+        CAPTURE(util::coding_name(coding));
+        std::string packed;
+        util::compress(coding, text, 6, packed);
+
+        // Whole, in network-sized pieces, and a byte at a time through headers and trailers
+        CHECK(unpack(coding, packed, packed.size()) == text);
+        CHECK(unpack(coding, packed, 1400) == text);
+        CHECK(unpack(coding, packed, 1) == text);
+
+        CHECK_THROWS_AS(unpack(coding, packed.substr(0, packed.size() - 3), 1400), std::runtime_error);
+        CHECK_THROWS_AS(unpack(coding, packed + "junk", 1400), std::runtime_error);
+        CHECK_THROWS_AS(unpack(coding, packed, 1400, text.size() - 1), std::length_error);
+        CHECK(unpack(coding, packed, 1400, text.size()) == text);
+    }
+
+    SECTION("gzip members, optional header fields and checksums") {
+        const std::string one = util::gzip_compress("first ");
+        const std::string two = util::gzip_compress("second");
+        CHECK(unpack(util::ContentCoding::gzip, one + two, 3) == "first second");
+
+        // FNAME set, as the gzip tool writes it
+        std::string named = one;
+        named[3] = 0x08;
+        named.insert(10, std::string("upload.json\0", 12));
+        CHECK(unpack(util::ContentCoding::gzip, named, 1) == "first ");
+
+        std::string corrupt = one;
+        corrupt[corrupt.size() - 8] ^= 0x01;
+        CHECK_THROWS_AS(unpack(util::ContentCoding::gzip, corrupt, 1400), std::runtime_error);
+        CHECK_THROWS_AS(unpack(util::ContentCoding::gzip, "not gzip at all", 1400), std::runtime_error);
+    }
+
+    SECTION("deflate also accepts a bare deflate stream") {
+        std::string wrapped;
+        util::compress(util::ContentCoding::deflate, text, 6, wrapped);
+        const std::string raw = wrapped.substr(2, wrapped.size() - 6);
+        CHECK(unpack(util::ContentCoding::deflate, raw, 1400) == text);
+    }
+
+    SECTION("Decompression bombs stop at the limit") {
+        // 64 MB of zeros packs into about 64 KB
+        util::StreamCompressor bomb(util::ContentCoding::gzip, 9);
+        std::string packed;
+        const std::string zeros(1 << 20, '\0');
+        for (int i = 0; i < 64; ++i) bomb.write(zeros, packed);
+        bomb.finish(packed);
+        REQUIRE(packed.size() < (1 << 20));
+
+        util::StreamDecompressor decoder(util::ContentCoding::gzip);
+        std::string out;
+        CHECK_THROWS_AS(decoder.write(packed, out, 4 << 20), std::length_error);
+        CHECK(out.size() <= (4 << 20) + 1);
+    }
+
+    CHECK(util::parse_coding("GZIP") == util::ContentCoding::gzip);
+    CHECK(util::parse_coding("x-gzip") == util::ContentCoding::gzip);
+    CHECK(util::parse_coding(" deflate ") == util::ContentCoding::deflate);
+    CHECK(util::parse_coding("") == util::ContentCoding::identity);
+    CHECK_FALSE(util::parse_coding("compress"));
+    CHECK_FALSE(util::parse_coding("gzip, br"));
+}
+
+TEST_CASE("Compression: Accept-Encoding negotiation", "[compression]") {
+    CHECK(util::accepts_encoding("gzip, deflate, br", "br"));
+    CHECK(util::accepts_encoding("GZIP", "gzip"));
+    CHECK(util::accepts_encoding("br;q=0.5, gzip;q=1.0", "gzip"));
+    CHECK_FALSE(util::accepts_encoding("deflate", "gzip"));
+    CHECK_FALSE(util::accepts_encoding("", "gzip"));
+    CHECK_FALSE(util::accepts_encoding("gzip;q=0", "gzip"));
+    CHECK_FALSE(util::accepts_encoding("gzip; q=0.000, br", "gzip"));
+    CHECK(util::accepts_encoding("*", "br"));
+    CHECK_FALSE(util::accepts_encoding("*, br;q=0", "br"));
+    CHECK(util::accepts_encoding("gzip;q=0.01", "gzip"));
+
+    CHECK(util::is_compressible("text/html; charset=utf-8"));
+    CHECK(util::is_compressible("application/json"));
+    CHECK_FALSE(util::is_compressible("image/png"));
+}
+
+TEST_CASE("Middleware: Response Compression", "[compression][middleware][integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.use(middleware::compression({.min_size = 512}));
+
+    std::string list = "[";
+    for (int i = 0; i < 3000; ++i) list += "{\"id\": " + std::to_string(i) + ", \"name\": \"user\"},";
+    list += "{}]";
+
+    app.get("/list", [&](Response& res) -> Async<void> {
+        res.header("ETag", "\"v1\"").json_raw(list);
+        co_return;
+    });
+    app.get("/small", [](Response& res) -> Async<void> {
+        res.json_raw("{\"ok\": true}");
+        co_return;
+    });
+    app.get("/png", [&](Response& res) -> Async<void> {
+        res.header("Content-Type", "image/png").send(list);
+        co_return;
+    });
+    app.get("/events", [](Response& res) -> Async<void> {
+        res.sse([](SseWriter& sse) -> Async<void> {
+            for (int i = 0; i < 3; ++i) co_await sse.send("event " + std::to_string(i));
+        });
+        co_return;
+    });
+
+    const std::string file = "/tmp/blaze_compress_test.txt";
+    {
+        std::ofstream out(file, std::ios::binary);
+        for (int i = 0; i < 20000; ++i) out << "line " << i << "\n";
+    }
+    app.get("/file", [&](Response& res) -> Async<void> {
+        res.header("Content-Type", "text/plain").file(file);
+        co_return;
+    });
+
+    // Over the static cache's max_file_size, so it is streamed and compressed on the way out
+    const std::filesystem::path assets_dir = "/tmp/blaze_compress_assets";
+    std::filesystem::create_directories(assets_dir);
+    {
+        std::ofstream out(assets_dir / "bundle.js", std::ios::binary);
+        for (int i = 0; i < 40000; ++i) out << "var v" << i << " = " << i << ";\n";
+    }
+    app.use(middleware::static_files(assets_dir.string(), false));
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9983);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9983");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    namespace http = boost::beast::http;
+    auto fetch = [&](const std::string& target, const std::string& accept, const std::string& extra = "") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer("GET " + target + " HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: " +
+                                       accept + "\r\n" + extra + "\r\n"));
+        http::response_parser<http::string_body> parser;
+        parser.body_limit(8 << 20);
+        boost::beast::flat_buffer buffer;
+        http::read(socket, buffer, parser);
+        return parser.release();
+    };
+
+    SECTION("Large JSON bodies are compressed with the negotiated coding") {
+        for (const std::string coding : {"gzip", "deflate", "br"}) {
+            if (coding == "br" && !util::brotli_available()) continue;
+            auto res = fetch("/list", coding);
+            CHECK(res[http::field::content_encoding] == coding);
+            CHECK(res[http::field::vary] == "Accept-Encoding");
+            CHECK(res[http::field::etag] == "\"v1-" + coding + "\"");
+            CHECK(res.body().size() < list.size() / 4);
+            CHECK(decode(coding, res.body()) == list);
+        }
+
+        auto plain = fetch("/list", "identity");
+        CHECK(plain.count(http::field::content_encoding) == 0);
+        CHECK(plain.body() == list);
+    }
+
+    SECTION("Small bodies and incompressible types are left alone") {
+        auto small = fetch("/small", "gzip");
+        CHECK(small.count(http::field::content_encoding) == 0);
+        CHECK(small.count(http::field::vary) == 0);
+
+        auto png = fetch("/png", "gzip");
+        CHECK(png.count(http::field::content_encoding) == 0);
+        CHECK(png.body() == list);
+    }
+
+    SECTION("Streams and files are compressed as they are sent") {
+        auto events = fetch("/events", "gzip");
+        CHECK(events[http::field::content_encoding] == "gzip");
+        CHECK(decode("gzip", events.body()) == "data: event 0\n\ndata: event 1\n\ndata: event 2\n\n");
+
+        std::ifstream in(file, std::ios::binary);
+        const std::string expected(std::istreambuf_iterator<char>(in), {});
+        auto whole = fetch("/file", "gzip");
+        CHECK(whole[http::field::content_encoding] == "gzip");
+        CHECK(whole.chunked());
+        CHECK(decode("gzip", whole.body()) == expected);
+    }
+
+    SECTION("A compressed static file revalidates against its tagged ETag") {
+        auto first = fetch("/bundle.js", "gzip");
+        REQUIRE(first.result_int() == 200);
+        CHECK(first[http::field::content_encoding] == "gzip");
+        const std::string etag(first[http::field::etag]);
+        REQUIRE(etag.ends_with("-gzip\""));
+
+        auto again = fetch("/bundle.js", "gzip", "If-None-Match: " + etag + "\r\n");
+        CHECK(again.result_int() == 304);
+        CHECK(again[http::field::etag] == etag);
+        CHECK(again.body().empty());
+
+        auto changed = fetch("/bundle.js", "gzip", "If-None-Match: \"0-0-gzip\"\r\n");
+        CHECK(changed.result_int() == 200);
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+    std::filesystem::remove(file);
+    std::filesystem::remove_all(assets_dir);
+}
+
+TEST_CASE("Server: Compressed Request Bodies", "[compression][integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.max_body_size(1 << 20);
+
+    app.post("/ingest", [](Request& req) -> Async<std::string> {
+        const int count = req.json()["count"].as<int>();
+        co_return std::to_string(count) + " " + std::to_string(req.body.size()) + " " +
+                  (req.has_header("Content-Encoding") ? "encoded" : "decoded");
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9982);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9982");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    namespace http = boost::beast::http;
+    auto post = [&](const std::string& encoding, const std::string& body, bool chunked = false) {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        http::request<http::string_body> req{http::verb::post, "/ingest", 11};
+        req.set(http::field::host, "localhost");
+        req.set(http::field::content_type, "application/json");
+        if (!encoding.empty()) req.set(http::field::content_encoding, encoding);
+        req.body() = body;
+        if (chunked) req.chunked(true);
+        else req.prepare_payload();
+        http::write(socket, req);
+
+        http::response<http::string_body> res;
+        boost::beast::flat_buffer buffer;
+        boost::beast::error_code ec;
+        http::read(socket, buffer, res, ec);
+        return res;
+    };
+
+    std::string json = "{\"count\": 3, \"items\": [";
+    for (int i = 0; i < 2000; ++i) json += "\"item " + std::to_string(i) + "\",";
+    json += "\"end\"]}";
+    const std::string expected = "3 " + std::to_string(json.size()) + " decoded";
+
+    SECTION("gzip and deflate uploads reach the handler decoded") {
+        std::vector<util::ContentCoding> codings = {util::ContentCoding::gzip, util::ContentCoding::deflate};
+        if (util::brotli_available()) codings.push_back(util::ContentCoding::br);
+        for (const auto coding : codings) {
+            std::string packed;
+            util::compress(coding, json, 6, packed);
+            CHECK(post(std::string(util::coding_name(coding)), packed).body() == expected);
+            CHECK(post(std::string(util::coding_name(coding)), packed, true).body() == expected);
+        }
+        CHECK(post("", json).body() == expected);
+        CHECK(post("identity", json).body() == expected);
+    }
+
+    SECTION("Oversized, malformed and unknown encodings are refused") {
+        // Well under the limit on the wire, far over it decoded
+        const std::string packed = util::gzip_compress(std::string(8 << 20, ' '), 9);
+        REQUIRE(packed.size() < (1 << 20));
+        CHECK(post("gzip", packed).result_int() == 413);
+
+        CHECK(post("gzip", json).result_int() == 400);
+        CHECK(post("gzip", util::gzip_compress(json).substr(0, 100)).result_int() == 400);
+        CHECK(post("compress", json).result_int() == 415);
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+// Not run by default: ./blaze_tests "[benchmark]" prints CPU cost against output size per level
+TEST_CASE("Compression: Level Tradeoffs", "[.][benchmark][compression]") {
+    std::string body = "[";
+    for (int i = 0; i < 12000; ++i) {
+        body += "{\"id\": " + std::to_string(i) + ", \"email\": \"user" + std::to_string(i * 7919 % 100000) +
+                "@example.com\", \"active\": " + (i % 3 ? "true" : "false") + ", \"score\": " +
+                std::to_string(i * 31 % 997) + "},";
+    }
+    body += "{}]";
+
+    struct Run { util::ContentCoding coding; int level; };
+    std::vector<Run> runs = {
+        {util::ContentCoding::gzip, 1}, {util::ContentCoding::gzip, 4}, {util::ContentCoding::gzip, 6},
+        {util::ContentCoding::gzip, 9}
+    };
+    if (util::brotli_available()) {
+        for (int quality : {1, 4, 5, 6, 9, 11}) runs.push_back({util::ContentCoding::br, quality});
+    }
+
+    std::printf("\n%zu KB JSON body\n%-8s %5s %10s %8s %10s\n", body.size() / 1024, "coding", "level", "bytes", "ratio", "MB/s");
+    for (const auto& run : runs) {
+        std::string out;
+        const int iterations = run.level >= 9 && run.coding == util::ContentCoding::br ? 2 : 10;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            out.clear();
+            util::compress(run.coding, body, run.level, out);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double mbps = body.size() * iterations / elapsed.count() / (1024 * 1024);
+        std::printf("%-8s %5d %10zu %7.1f%% %10.1f\n", std::string(util::coding_name(run.coding)).c_str(), run.level,
+                    out.size(), 100.0 * out.size() / body.size(), mbps);
+        CHECK(out.size() < body.size());
+    }
+}
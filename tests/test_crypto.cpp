@@ -1,8 +1,18 @@
 #include <catch2/catch_test_macros.hpp>
 #include <blaze/crypto.h>
+#include <blaze/util/jwt_cache.h>
+#include <ctime>
 
 using namespace blaze::crypto;
 
+namespace {
+    // Signs a raw payload, for claims jwt_sign() wouldn't produce
+    std::string sign_raw(const std::string& payload, const std::string& secret) {
+        const std::string data = base64url_encode(R"({"alg":"HS256","typ":"JWT"})") + "." + base64url_encode(payload);
+        return data + "." + base64url_encode(hmac_sha256(secret, data));
+    }
+}
+
 TEST_CASE("Crypto: Base64 and Hex", "[crypto]") {
     std::string raw = "Blaze Framework";
     
@@ -50,8 +60,104 @@ TEST_CASE("Crypto: JWT Signing and Verification", "[crypto]") {
 
     SECTION("Expired Token") {
         std::string token = jwt_sign(payload, secret, -10); // Expired 10s ago
-        auto verified = jwt_verify(token, secret);
+        JwtError error = JwtError::None;
+        auto verified = jwt_verify(token, secret, &error);
         CHECK_FALSE(verified.is_ok());
+        CHECK(error == JwtError::Expired);
+    }
+
+    SECTION("Fractional and out-of-range exp") {
+        const long long now = std::time(nullptr);
+        JwtError error = JwtError::None;
+
+        auto live = jwt_verify(sign_raw(R"({"id":1,"exp":)" + std::to_string(now + 60) + ".5}", secret), secret, &error);
+        CHECK(live.is_ok());
+        CHECK(error == JwtError::None);
+
+        CHECK_FALSE(jwt_verify(sign_raw(R"({"exp":)" + std::to_string(now - 60) + ".5}", secret), secret, &error).is_ok());
+        CHECK(error == JwtError::Expired);
+
+        CHECK(jwt_verify(sign_raw(R"({"exp":1e30})", secret), secret).is_ok());
+    }
+
+    SECTION("Tampered and Malformed Tokens") {
+        std::string token = jwt_sign(payload, secret, 3600);
+        const size_t first_dot = token.find('.');
+        const size_t last_dot = token.rfind('.');
+        std::string forged = token.substr(0, first_dot + 1) +
+            base64url_encode(R"({"user_id":1,"role":"admin"})") + token.substr(last_dot);
+
+        JwtError error = JwtError::None;
+        CHECK_FALSE(jwt_verify(forged, secret, &error).is_ok());
+        CHECK(error == JwtError::InvalidSignature);
+
+        CHECK_FALSE(jwt_verify(token + "!", secret, &error).is_ok());
+        CHECK(error == JwtError::InvalidSignature);
+
+        CHECK_FALSE(jwt_verify("not-a-token", secret, &error).is_ok());
+        CHECK(error == JwtError::Malformed);
+
+        // Correctly signed, but the payload isn't JSON
+        std::string data = base64url_encode(R"({"alg":"HS256"})") + "." + base64url_encode("{oops");
+        CHECK_FALSE(jwt_verify(data + "." + base64url_encode(hmac_sha256(secret, data)), secret, &error).is_ok());
+        CHECK(error == JwtError::Malformed);
+    }
+
+    SECTION("Large Payloads") {
+        std::string token = jwt_sign({{"blob", std::string(4000, 'x')}}, secret);
+        CHECK(jwt_verify(token, secret)["blob"].as<std::string>().size() == 4000);
+    }
+}
+
+TEST_CASE("Crypto: JWT Cache", "[crypto]") {
+    const std::string secret = "super-secret-key";
+    blaze::JwtCache cache(64, 4);
+
+    SECTION("Hits share the verified claims") {
+        std::string token = jwt_sign({{"sub", "alice"}}, secret);
+        CHECK_FALSE(cache.find(token));
+        cache.insert(token, jwt_verify(token, secret));
+
+        auto claims = cache.find(token);
+        REQUIRE(claims);
+        CHECK((*claims)["sub"].as<std::string>() == "alice");
+        CHECK(&claims->value() == &cache.find(token)->value());
+    }
+
+    SECTION("A known signature with a different payload misses") {
+        std::string token = jwt_sign({{"sub", "alice"}}, secret);
+        cache.insert(token, jwt_verify(token, secret));
+        std::string forged = token.substr(0, token.find('.') + 1) + base64url_encode(R"({"sub":"mallory"})") +
+            token.substr(token.rfind('.'));
+        CHECK_FALSE(cache.find(forged));
+    }
+
+    SECTION("Expired entries are not returned") {
+        std::string token = jwt_sign({{"sub", "alice"}}, secret, 60);
+        cache.insert(token, jwt_verify(token, secret));
+        CHECK(cache.find(token, std::time(nullptr)));
+        CHECK_FALSE(cache.find(token, std::time(nullptr) + 120));
+    }
+
+    SECTION("Fractional exp") {
+        const std::time_t now = std::time(nullptr);
+        std::string token = sign_raw(R"({"sub":"alice","exp":)" + std::to_string(now + 60) + ".5}", secret);
+        cache.insert(token, jwt_verify(token, secret));
+        CHECK(cache.find(token, now + 60));
+        CHECK_FALSE(cache.find(token, now + 61));
+
+        std::string forever = sign_raw(R"({"sub":"bob","exp":1e30})", secret);
+        cache.insert(forever, jwt_verify(forever, secret));
+        CHECK(cache.find(forever, now + 1'000'000'000));
+    }
+
+    SECTION("Size is bounded") {
+        for (int i = 0; i < 500; ++i) {
+            std::string token = jwt_sign({{"id", i}}, secret);
+            cache.insert(token, jwt_verify(token, secret));
+        }
+        CHECK(cache.size() <= 64);
+        CHECK(cache.size() > 0);
     }
 }
 
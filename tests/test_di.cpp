@@ -1,6 +1,9 @@
 #include <catch2/catch_test_macros.hpp>
 #include <blaze/di.h>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 
 using namespace blaze;
 
@@ -55,4 +58,55 @@ TEST_CASE("DI: Transient Services", "[di]") {
         CHECK(counter == 2);
         CHECK(d1 != d2); // Should be different pointers
     }
-}
\ No newline at end of file
+}
+TEST_CASE("DI: Per-shard Services", "[di]") {
+    ServiceProvider sp;
+    int created = 0;
+
+    sp.provide_per_shard<Database>([&](ServiceProvider&) {
+        created++;
+        return std::make_shared<Database>();
+    });
+    sp.set_shard_count(2);
+
+    auto s0 = sp.resolve<Database>();
+    CHECK(sp.resolve<Database>() == s0);
+
+    // Resolve as if from shard 1's thread
+    std::shared_ptr<Database> s1;
+    std::thread([&] {
+        this_shard() = 1;
+        s1 = sp.resolve<Database>();
+    }).join();
+
+    CHECK(s1 != s0);
+    CHECK(created == 2);
+
+    // Shards beyond the configured count are rejected
+    bool threw = false;
+    std::thread([&] {
+        this_shard() = 2;
+        try { sp.resolve<Database>(); } catch (const std::runtime_error&) { threw = true; }
+    }).join();
+    CHECK(threw);
+}
+
+TEST_CASE("DI: Per-shard Service Created Once Under Contention", "[di]") {
+    ServiceProvider sp;
+    std::atomic<int> created{0};
+    sp.provide_per_shard<Database>([&](ServiceProvider&) {
+        created++;
+        return std::make_shared<Database>();
+    });
+
+    // Threads outside the shards all resolve as shard 0
+    std::vector<std::shared_ptr<Database>> seen(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < seen.size(); ++i) {
+        threads.emplace_back([&, i] { seen[i] = sp.resolve<Database>(); });
+    }
+    for (auto& t : threads) t.join();
+
+    CHECK(created == 1);
+    for (const auto& db : seen) CHECK(db == seen[0]);
+}
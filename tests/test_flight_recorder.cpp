@@ -0,0 +1,219 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/app.h>
+#include <blaze/flight_recorder.h>
+#include <blaze/request_scope.h>
+#include <boost/asio.hpp>
+
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace blaze;
+namespace net = boost::asio;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace {
+    size_t count(const std::string& text, const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) ++n;
+        return n;
+    }
+}
+
+TEST_CASE("Flight Recorder: Slow Requests", "[flight_recorder]") {
+    FlightRecorder& recorder = FlightRecorder::instance();
+    recorder.configure({.request_threshold = milliseconds(10), .capacity = 2});
+    CHECK(recorder.dump() == R"({"slow_requests":[],"slow_queries":[]})");
+
+    RequestProfile fast;
+    fast.add(Phase::READ, milliseconds(50));     // Idle keep-alive time doesn't count
+    fast.add(Phase::HANDLER, milliseconds(5));
+    recorder.record_request(fast, "GET", "/fast", 200);
+    CHECK(recorder.dump().find("/fast") == std::string::npos);
+
+    RequestProfile slow;
+    slow.route = "/users/:id";
+    slow.add(Phase::READ, microseconds(100));
+    slow.add(Phase::MIDDLEWARE, milliseconds(3));
+    slow.add(Phase::HANDLER, milliseconds(8));
+    slow.add(Phase::WRITE, microseconds(250));
+    CHECK(slow.server_us() == 11250);
+    recorder.record_request(slow, "GET", "/users/7", 503);
+
+    const std::string dump = recorder.dump();
+    CHECK(dump.find(R"("method":"GET","path":"/users/7","route":"/users/:id","status":503,"total_us":11350)") != std::string::npos);
+    CHECK(dump.find(R"("phases_us":{"read":100,"route":0,"middleware":3000,"handler":8000,"db_wait":0,"db_exec":0,"write":250})") != std::string::npos);
+    CHECK(dump.find(R"("queries":0})") != std::string::npos);
+
+    SECTION("The ring keeps the newest records") {
+        recorder.record_request(slow, "GET", "/second", 200);
+        recorder.record_request(slow, "GET", "/third", 200);
+        const std::string ring = recorder.dump();
+        CHECK(ring.find("/users/7") == std::string::npos);
+        REQUIRE(ring.find("/third") != std::string::npos);
+        CHECK(ring.find("/third") < ring.find("/second"));
+    }
+
+    recorder.disable();
+}
+
+TEST_CASE("Flight Recorder: Slow Queries", "[flight_recorder]") {
+    FlightRecorder& recorder = FlightRecorder::instance();
+    recorder.configure({.request_threshold = milliseconds(10), .query_threshold = milliseconds(5)});
+
+    RequestProfile profile;
+    profile.route = "/orders";
+    recorder.record_query(&profile, "postgres", "SELECT 1", microseconds(100), microseconds(200));
+    recorder.record_query(&profile, "postgres", "SELECT * FROM \"orders\"", milliseconds(2), milliseconds(9));
+    recorder.record_query(nullptr, "mysql", "SELECT 2", microseconds(0), milliseconds(6));
+
+    CHECK(profile.queries == 2);
+    CHECK(profile.get(Phase::DB_WAIT) == 2100);
+    CHECK(profile.get(Phase::DB_EXEC) == 9200);
+    CHECK(profile.slowest_query_us == 11000);
+    CHECK(profile.slowest_sql.view() == "SELECT * FROM \"orders\"");
+
+    recorder.record_request(profile, "POST", "/orders", 201);
+    const std::string dump = recorder.dump();
+    CHECK(count(dump, R"("driver":)") == 2);
+    CHECK(dump.find(R"("driver":"mysql","route":"","wait_us":0,"exec_us":6000,"sql":"SELECT 2")") != std::string::npos);
+    CHECK(dump.find(R"("driver":"postgres","route":"/orders","wait_us":2000,"exec_us":9000,"sql":"SELECT * FROM \"orders\"")") != std::string::npos);
+    CHECK(dump.find(R"("queries":2,"slowest_query_us":11000,"slowest_sql":"SELECT * FROM \"orders\"")") != std::string::npos);
+    CHECK(dump.find("SELECT 1") == std::string::npos);
+
+    recorder.disable();
+}
+
+TEST_CASE("Flight Recorder: Query Timer", "[flight_recorder]") {
+    FlightRecorder::instance().configure({.query_threshold = milliseconds(0)});
+
+    auto scope = std::make_shared<RequestScope>();
+    scope->profiled = true;
+    std::optional<QueryTimer> timer;
+    {
+        RequestScope::Enter enter(scope.get());
+        timer.emplace("postgres", "SELECT now()");
+    }
+    {
+        RequestScope::Enter other(nullptr);  // The pool resumes while another request is current
+        timer->acquired();
+        timer.reset();
+    }
+    CHECK(RequestScope::current() == nullptr);
+    CHECK(scope->profile.queries == 1);
+    CHECK(scope->profile.slowest_sql.view() == "SELECT now()");
+    CHECK(FlightRecorder::instance().dump().find("\"sql\":\"SELECT now()\"") != std::string::npos);
+
+    const std::string long_sql(4096, 'x');
+    {
+        RequestScope::Enter enter(scope.get());
+        QueryTimer timer("mysql", long_sql);
+        timer.acquired();
+    }
+    CHECK(scope->profile.slowest_sql.size == 512);
+
+    // Outside a request the query is still recorded, against no profile
+    { QueryTimer timer("mysql", "SELECT 3"); timer.acquired(); }
+    CHECK(scope->profile.queries == 2);
+
+    FlightRecorder::instance().disable();
+}
+
+TEST_CASE("Flight Recorder: Request Phases", "[flight_recorder]") {
+    FlightRecorder::instance().configure({});
+
+    App app;
+    app.use([](Request& req, Response& res, Next next) -> Async<void> {
+        std::this_thread::sleep_for(milliseconds(2));
+        co_await next();
+    });
+    app.get("/slow/:id", [](Request& req, Response& res) -> Async<void> {
+        std::this_thread::sleep_for(milliseconds(5));
+        res.send("ok");
+        co_return;
+    });
+
+    net::io_context ioc;
+    Request req;
+    req.method = "GET";
+    req.path = "/slow/7";
+    net::co_spawn(ioc, app.handle_request(req, "127.0.0.1"), net::detached);
+    ioc.run();
+
+    CHECK(RequestScope::current() == nullptr);
+    REQUIRE(req.profile());
+    const RequestProfile& profile = *req.profile();
+    CHECK(profile.route == "/slow/:id");
+    CHECK(profile.get(Phase::MIDDLEWARE) >= 2000);
+    CHECK(profile.get(Phase::HANDLER) >= 5000);
+    CHECK(profile.db_us() == 0);
+
+    FlightRecorder::instance().disable();
+}
+
+TEST_CASE("Flight Recorder: Overlapping Queries", "[flight_recorder]") {
+    FlightRecorder::instance().configure({});
+
+    App app;
+    app.get("/parallel", [](Request& req, Response& res) -> Async<void> {
+        // Two queries in flight at once count their time twice
+        QueryTimer first("postgres", "SELECT 1");
+        QueryTimer second("postgres", "SELECT 2");
+        first.acquired();
+        second.acquired();
+        std::this_thread::sleep_for(milliseconds(5));
+        res.send("ok");
+        co_return;
+    });
+
+    net::io_context ioc;
+    Request req;
+    req.method = "GET";
+    req.path = "/parallel";
+    net::co_spawn(ioc, app.handle_request(req, "127.0.0.1"), net::detached);
+    ioc.run();
+
+    REQUIRE(req.profile());
+    const RequestProfile& profile = *req.profile();
+    CHECK(profile.queries == 2);
+    CHECK(profile.get(Phase::DB_EXEC) >= 10000);
+    CHECK(profile.get(Phase::HANDLER) == 0);
+    CHECK(profile.get(Phase::MIDDLEWARE) == 0);
+
+    FlightRecorder::instance().disable();
+}
+
+TEST_CASE("Flight Recorder: Interleaved Requests", "[flight_recorder]") {
+    FlightRecorder::instance().configure({});
+
+    App app;
+    app.get("/query/:delay", [](Request& req, Response& res) -> Async<void> {
+        // A raw timer knows nothing of the recorder; the other request runs while this one waits
+        net::steady_timer timer(co_await net::this_coro::executor);
+        timer.expires_after(milliseconds(*req.get_param_int("delay")));
+        co_await timer.async_wait(net::use_awaitable);
+        const std::string sql = "SELECT " + std::string(req.path);
+        QueryTimer query("postgres", sql);
+        query.acquired();
+        res.send("ok");
+    });
+
+    net::io_context ioc;
+    Request slow, fast;
+    slow.method = fast.method = "GET";
+    slow.path = "/query/30";
+    fast.path = "/query/5";
+    net::co_spawn(ioc, app.handle_request(slow, "127.0.0.1"), net::detached);
+    net::co_spawn(ioc, app.handle_request(fast, "127.0.0.1"), net::detached);
+    ioc.run();
+
+    REQUIRE(slow.profile());
+    REQUIRE(fast.profile());
+    CHECK(slow.profile()->queries == 1);
+    CHECK(slow.profile()->slowest_sql.view() == "SELECT /query/30");
+    CHECK(fast.profile()->queries == 1);
+    CHECK(fast.profile()->slowest_sql.view() == "SELECT /query/5");
+
+    FlightRecorder::instance().disable();
+}
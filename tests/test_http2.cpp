@@ -0,0 +1,353 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/app.h>
+#include <blaze/util/compression.h>
+
+#ifdef BLAZE_HAS_HTTP2
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <nghttp2/nghttp2.h>
+#include <fstream>
+#include <map>
+
+using namespace blaze;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+    // Minimal blocking HTTP/2 client over prior-knowledge h2c
+    class H2Client {
+    public:
+        struct Result {
+            int status = 0;
+            std::map<std::string, std::string> headers;
+            std::string body;
+            bool done = false;
+        };
+
+        explicit H2Client(tcp::socket& socket) : socket_(socket) {
+            nghttp2_session_callbacks* cbs;
+            nghttp2_session_callbacks_new(&cbs);
+            nghttp2_session_callbacks_set_on_header_callback(cbs, &H2Client::on_header);
+            nghttp2_session_callbacks_set_on_data_chunk_recv_callback(cbs, &H2Client::on_data);
+            nghttp2_session_callbacks_set_on_stream_close_callback(cbs, &H2Client::on_close);
+            nghttp2_session_client_new(&session_, cbs, this);
+            nghttp2_session_callbacks_del(cbs);
+            nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, nullptr, 0);
+        }
+
+        ~H2Client() { nghttp2_session_del(session_); }
+
+        int32_t submit(const std::string& method, const std::string& path,
+                       std::vector<std::pair<std::string, std::string>> extra = {},
+                       const std::string* body = nullptr) {
+            std::vector<std::pair<std::string, std::string>> fields = {
+                {":method", method}, {":scheme", "http"}, {":authority", "localhost"}, {":path", path}
+            };
+            fields.insert(fields.end(), extra.begin(), extra.end());
+
+            std::vector<nghttp2_nv> nva;
+            for (auto& [k, v] : fields) {
+                nva.push_back({reinterpret_cast<uint8_t*>(k.data()), reinterpret_cast<uint8_t*>(v.data()),
+                               k.size(), v.size(), NGHTTP2_NV_FLAG_NONE});
+            }
+
+            nghttp2_data_provider provider{};
+            if (body) {
+                upload_ = *body;
+                provider.source.ptr = this;
+                provider.read_callback = &H2Client::read_upload;
+            }
+            const int32_t id = nghttp2_submit_request(session_, nullptr, nva.data(), nva.size(),
+                                                      body ? &provider : nullptr, nullptr);
+            results_[id];
+            return id;
+        }
+
+        // Pumps the connection until every submitted stream has closed
+        void run() {
+            std::array<char, 16384> buf;
+            while (!all_done()) {
+                const uint8_t* data;
+                ssize_t n;
+                while ((n = nghttp2_session_mem_send(session_, &data)) > 0) {
+                    net::write(socket_, net::buffer(data, n));
+                }
+                if (all_done()) break;
+                const size_t read = socket_.read_some(net::buffer(buf));
+                nghttp2_session_mem_recv(session_, reinterpret_cast<const uint8_t*>(buf.data()), read);
+            }
+        }
+
+        Result& result(int32_t id) { return results_[id]; }
+
+    private:
+        bool all_done() const {
+            for (const auto& [id, r] : results_) if (!r.done) return false;
+            return true;
+        }
+
+        static int on_header(nghttp2_session*, const nghttp2_frame* frame, const uint8_t* name, size_t namelen,
+                             const uint8_t* value, size_t valuelen, uint8_t, void* user_data) {
+            auto* self = static_cast<H2Client*>(user_data);
+            std::string key(reinterpret_cast<const char*>(name), namelen);
+            std::string val(reinterpret_cast<const char*>(value), valuelen);
+            auto& r = self->results_[frame->hd.stream_id];
+            if (key == ":status") r.status = std::stoi(val);
+            else r.headers[key] = val;
+            return 0;
+        }
+
+        static int on_data(nghttp2_session*, uint8_t, int32_t stream_id, const uint8_t* data, size_t len, void* user_data) {
+            static_cast<H2Client*>(user_data)->results_[stream_id].body.append(reinterpret_cast<const char*>(data), len);
+            return 0;
+        }
+
+        static int on_close(nghttp2_session*, int32_t stream_id, uint32_t, void* user_data) {
+            static_cast<H2Client*>(user_data)->results_[stream_id].done = true;
+            return 0;
+        }
+
+        static ssize_t read_upload(nghttp2_session*, int32_t, uint8_t* buf, size_t length, uint32_t* flags,
+                                   nghttp2_data_source*, void* user_data) {
+            auto* self = static_cast<H2Client*>(user_data);
+            const size_t n = std::min(length, self->upload_.size());
+            std::copy_n(self->upload_.data(), n, buf);
+            self->upload_.erase(0, n);
+            if (self->upload_.empty()) *flags |= NGHTTP2_DATA_FLAG_EOF;
+            return static_cast<ssize_t>(n);
+        }
+
+        tcp::socket& socket_;
+        nghttp2_session* session_ = nullptr;
+        std::map<int32_t, Result> results_;
+        std::string upload_;
+    };
+
+}
+
+TEST_CASE("HTTP/2: h2c Prior Knowledge", "[http2][integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.h2c(true);
+    app.config().timeout_seconds = 1;
+
+    app.get("/hello", [](Request& req, Response& res) -> Async<void> {
+        res.header("X-Echo", std::string(req.get_header("X-Test")))
+           .header("X-Host", std::string(req.get_header("Host")))
+           .send("Hello h2");
+        co_return;
+    });
+
+    app.get("/sleep/:ms", [](Path<int> ms) -> Async<std::string> {
+        co_await delay(std::chrono::milliseconds(ms));
+        co_return "slept " + std::to_string(ms);
+    });
+
+    app.post("/echo", [](Request& req, Response& res) -> Async<void> {
+        res.send(req.body);
+        co_return;
+    });
+
+    app.get("/stream", [](Response& res) -> Async<void> {
+        res.stream([](ResponseWriter& out) -> Async<void> {
+            const std::string block(40000, 's');
+            for (int i = 0; i < 5; ++i) {
+                co_await out.write(block);
+                co_await delay(std::chrono::milliseconds(5));
+            }
+        });
+        co_return;
+    });
+
+    app.get_static("/health", "OK", {{"Content-Type", "text/plain"}});
+
+    const std::string ranged_file = "/tmp/blaze_h2_ranges.txt";
+    {
+        std::ofstream out(ranged_file, std::ios::binary);
+        out << "0123456789abcdef";
+    }
+    app.get("/ranges", [&](Response& res) -> Async<void> {
+        res.status(206).file(ranged_file, {{"<", 2, 3}, {"|", 10, 2}}, ">");
+        co_return;
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9988);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9988");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    SECTION("Request headers and response") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const int32_t id = client.submit("GET", "/hello", {{"x-test", "abc"}});
+        client.run();
+
+        auto& r = client.result(id);
+        CHECK(r.status == 200);
+        CHECK(r.body == "Hello h2");
+        CHECK(r.headers["x-echo"] == "abc");
+        CHECK(r.headers["x-host"] == "localhost");
+        CHECK(r.headers["server"] == "Blaze/1.0");
+        CHECK(r.headers["date"].size() == HttpDate::kLength);
+        CHECK(r.headers["content-length"] == "8");
+        CHECK(r.headers.count("connection") == 0);
+    }
+
+    SECTION("Streams are multiplexed and handled concurrently") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<int32_t> ids;
+        for (int i = 0; i < 3; ++i) ids.push_back(client.submit("GET", "/sleep/400"));
+        const int32_t missing = client.submit("GET", "/missing");
+        client.run();
+
+        for (int32_t id : ids) {
+            CHECK(client.result(id).status == 200);
+            CHECK(client.result(id).body == "slept 400");
+        }
+        CHECK(client.result(missing).status == 404);
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(900));
+    }
+
+    SECTION("A stream may outlast the idle timeout") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const int32_t id = client.submit("GET", "/sleep/1500");
+        client.run();
+        CHECK(client.result(id).status == 200);
+        CHECK(client.result(id).body == "slept 1500");
+
+        // Idle again, the connection is closed
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        std::array<char, 1024> buf;
+        boost::system::error_code ec;
+        while (!ec) socket.read_some(net::buffer(buf), ec);
+        CHECK((ec == net::error::eof || ec == net::error::connection_reset));
+    }
+
+        SECTION("Request body") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const std::string payload(50000, 'x');
+        const int32_t id = client.submit("POST", "/echo", {}, &payload);
+        client.run();
+
+        CHECK(client.result(id).status == 200);
+        CHECK(client.result(id).body == payload);
+    }
+
+    SECTION("Compressed request bodies are decoded") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const std::string payload(50000, 'x');
+        const std::string packed = util::gzip_compress(payload);
+        const std::string bomb = util::gzip_compress(std::string(16 << 20, ' '), 9);
+        const std::string plain = "plain";
+        // The client holds one upload at a time
+        const int32_t id = client.submit("POST", "/echo", {{"content-encoding", "gzip"}}, &packed);
+        client.run();
+        const int32_t too_large = client.submit("POST", "/echo", {{"content-encoding", "gzip"}}, &bomb);
+        client.run();
+        const int32_t unknown = client.submit("POST", "/echo", {{"content-encoding", "compress"}}, &plain);
+        client.run();
+
+        CHECK(client.result(id).status == 200);
+        CHECK(client.result(id).body == payload);
+        CHECK(client.result(too_large).status == 413);
+        CHECK(client.result(unknown).status == 415);
+    }
+
+    SECTION("Streamed response bodies") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const int32_t streamed = client.submit("GET", "/stream");
+        const int32_t plain = client.submit("GET", "/hello");
+        client.run();
+
+        CHECK(client.result(streamed).status == 200);
+        CHECK(client.result(streamed).body == std::string(200000, 's'));
+        CHECK(client.result(streamed).headers.count("content-length") == 0);
+        CHECK(client.result(plain).body == "Hello h2");
+    }
+
+    SECTION("File byte ranges") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const int32_t id = client.submit("GET", "/ranges");
+        client.run();
+
+        CHECK(client.result(id).status == 206);
+        CHECK(client.result(id).body == "<234|ab>");
+        CHECK(client.result(id).headers["content-length"] == "8");
+    }
+
+    SECTION("Static responses, including HEAD") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        H2Client client(socket);
+
+        const int32_t get = client.submit("GET", "/health");
+        const int32_t head = client.submit("HEAD", "/health");
+        client.run();
+
+        CHECK(client.result(get).status == 200);
+        CHECK(client.result(get).body == "OK");
+        CHECK(client.result(head).status == 200);
+        CHECK(client.result(head).headers["content-type"] == "text/plain");
+        CHECK(client.result(head).body.empty());
+    }
+
+    SECTION("HTTP/1.1 still works on an h2c listener") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(std::string("GET /hello HTTP/1.1\r\nHost: localhost\r\nX-Test: one\r\n\r\n")));
+
+        boost::beast::http::response<boost::beast::http::string_body> res;
+        boost::beast::flat_buffer buffer;
+        boost::beast::http::read(socket, buffer, res);
+        CHECK(res.result_int() == 200);
+        CHECK(res.body() == "Hello h2");
+        CHECK(res["X-Echo"] == "one");
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+#endif
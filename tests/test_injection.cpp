@@ -105,10 +105,10 @@ TEST_CASE("Typed Injection: Query Parameters", "[injection]") {
         
         using Members = boost::describe::describe_members<Search, boost::describe::mod_any_access>;
         boost::mp11::mp_for_each<Members>([&](auto meta) {
-            std::string key = meta.name;
-            if (req.query.count(key)) {
+            const auto it = req.query.find(std::string_view(meta.name));
+            if (it != req.query.end()) {
                 using FieldT = std::remove_cvref_t<decltype(search.*meta.pointer)>;
-                search.*meta.pointer = convert_string<FieldT>(req.query.at(key));
+                search.*meta.pointer = convert_string<FieldT>(it->second);
             }
         });
 
@@ -0,0 +1,161 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/logger.h>
+#include <blaze/util/spsc_ring.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace blaze;
+
+namespace {
+    std::string read_file(const std::string& path) {
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    size_t count(const std::string& text, const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) ++n;
+        return n;
+    }
+}
+
+TEST_CASE("SpscRing: Push and Consume", "[logger]") {
+    SpscRing<int, 4> ring;
+    int next = 0;
+    for (int i = 0; i < 4; ++i) CHECK(ring.try_push([&](int& slot) { slot = next++; }));
+    CHECK_FALSE(ring.try_push([](int&) { FAIL("fill called on a full ring"); }));
+    CHECK(ring.size() == 4);
+
+    std::vector<int> seen;
+    CHECK(ring.consume([&](int value) { seen.push_back(value); }, 3) == 3);
+    CHECK(seen == std::vector<int>{0, 1, 2});
+
+    // Wraps around the end of the slots
+    for (int i = 0; i < 3; ++i) CHECK(ring.try_push([&](int& slot) { slot = next++; }));
+    seen.clear();
+    CHECK(ring.consume([&](int value) { seen.push_back(value); }) == 4);
+    CHECK(seen == std::vector<int>{3, 4, 5, 6});
+    CHECK(ring.consume([](int) {}) == 0);
+
+    SECTION("One producer and one consumer thread") {
+        SpscRing<int, 64> shared;
+        constexpr int total = 100000;
+        std::thread producer([&] {
+            for (int i = 0; i < total; ++i) {
+                while (!shared.try_push([i](int& slot) { slot = i; })) std::this_thread::yield();
+            }
+        });
+        int expected = 0;
+        bool ordered = true;
+        while (expected < total) {
+            shared.consume([&](int value) { ordered = ordered && value == expected; ++expected; });
+        }
+        producer.join();
+        CHECK(ordered);
+    }
+}
+
+TEST_CASE("Logger: Batched Access Log", "[logger]") {
+    const std::string path = "/tmp/blaze_test_logger.log";
+    std::remove(path.c_str());
+    Logger& logger = Logger::instance();
+    logger.configure(path);
+    logger.set_level(LogLevel::INFO);
+
+    logger.log_access("10.0.0.1", "GET", "/users/42", 200, 3);
+    logger.info("server started");
+    std::thread other([&] {
+        for (int i = 0; i < 100; ++i) logger.log_access("10.0.0.2", "POST", "/orders", 201, 1);
+    });
+    other.join();
+    logger.log_access("10.0.0.1", "GET", "/" + std::string(500, 'a'), 404, 0);
+    logger.flush();
+
+    const std::string text = read_file(path);
+    CHECK(text.find("] ACCESS: 10.0.0.1 GET /users/42 200 3ms\n") != std::string::npos);
+    CHECK(text.find("] INFO: server started\n") != std::string::npos);
+    CHECK(count(text, "ACCESS: 10.0.0.2 POST /orders 201 1ms\n") == 100);
+    // Long paths are truncated, not dropped
+    CHECK(text.find(" 404 0ms\n") != std::string::npos);
+    CHECK(logger.dropped() == 0);
+
+    logger.configure("/dev/null");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Logger: Structured Access Log", "[logger]") {
+    const std::string path = "/tmp/blaze_test_logger_structured.log";
+    std::remove(path.c_str());
+    Logger& logger = Logger::instance();
+    logger.configure(path);
+    logger.set_level(LogLevel::INFO);
+
+    AccessLogEntry entry;
+    entry.client_ip = "10.0.0.1";
+    entry.method = "GET";
+    entry.path = "/users/42?q=\"x\"";
+    entry.route = "/users/:id";
+    entry.user = "alice smith";
+    entry.status = 200;
+    entry.duration = std::chrono::microseconds(1234);
+    entry.bytes_in = 0;
+    entry.bytes_out = 512;
+
+    SECTION("JSON lines") {
+        logger.set_access_log({.format = AccessLogFormat::JSON});
+        logger.log_access(entry);
+        logger.flush();
+
+        const std::string text = read_file(path);
+        CHECK(text.starts_with("{\"ts\":\""));
+        CHECK(text.find(R"("ip":"10.0.0.1","method":"GET","path":"/users/42?q=\"x\"","route":"/users/:id",)"
+                        R"("status":200,"duration_us":1234,"bytes_in":0,"bytes_out":512,"user":"alice smith"})" "\n")
+              != std::string::npos);
+    }
+
+    SECTION("logfmt") {
+        logger.set_access_log({.format = AccessLogFormat::LOGFMT});
+        entry.user = {};
+        logger.log_access(entry);
+        logger.flush();
+
+        const std::string text = read_file(path);
+        CHECK(text.starts_with("ts="));
+        CHECK(text.find(R"( ip=10.0.0.1 method=GET path="/users/42?q=\"x\"" route=/users/:id status=200 )"
+                        "duration_us=1234 bytes_in=0 bytes_out=512\n") != std::string::npos);
+        CHECK(text.find("user=") == std::string::npos);
+    }
+
+    SECTION("Sampling by status class and latency") {
+        logger.set_access_log({
+            .sample_success = 0.0,
+            .sample_client_error = 0.5,
+            .sample_server_error = 1.0,
+            .slow_threshold = std::chrono::milliseconds(100)
+        });
+        CHECK_FALSE(logger.sample_access(200, std::chrono::microseconds(10)));
+        CHECK(logger.sample_access(200, std::chrono::milliseconds(150)));
+        CHECK(logger.sample_access(503, std::chrono::microseconds(10)));
+
+        int kept = 0;
+        for (int i = 0; i < 10000; ++i) kept += logger.sample_access(404, std::chrono::microseconds(10));
+        CHECK(kept > 4000);
+        CHECK(kept < 6000);
+
+        // The positional overload samples too
+        logger.log_access("10.0.0.1", "GET", "/sampled-out", 200, 0);
+        logger.flush();
+        CHECK(read_file(path).find("/sampled-out") == std::string::npos);
+    }
+
+    logger.set_access_log({});
+    logger.configure("/dev/null");
+    std::remove(path.c_str());
+}
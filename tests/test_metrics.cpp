@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/metrics.h>
+
+#include <string>
+#include <thread>
+
+using namespace blaze;
+
+TEST_CASE("Histogram: Buckets", "[metrics]") {
+    Histogram h;
+    h.observe(std::chrono::microseconds(50));      // <= 100us
+    h.observe(std::chrono::microseconds(100));     // <= 100us, bounds are inclusive
+    h.observe(std::chrono::microseconds(3000));    // <= 5ms
+    h.observe(std::chrono::seconds(60));           // +Inf
+
+    const auto snap = h.snapshot();
+    CHECK(snap.count == 4);
+    CHECK(snap.sum_us == 50 + 100 + 3000 + 60'000'000);
+    CHECK(snap.buckets[0] == 2);
+    CHECK(snap.buckets[5] == 1);
+    CHECK(snap.buckets[Histogram::kBuckets - 1] == 1);
+
+    Histogram::Snapshot total;
+    total.merge(snap);
+    total.merge(snap);
+    CHECK(total.count == 8);
+    CHECK(total.buckets[0] == 4);
+}
+
+TEST_CASE("Metrics: Prometheus Rendering", "[metrics]") {
+    Metrics& metrics = Metrics::instance();
+
+    metrics.observe_request("GET", "/metrics-test/:id", 200, std::chrono::microseconds(200));
+    std::thread other([&] {
+        metrics.observe_request("GET", "/metrics-test/:id", 200, std::chrono::microseconds(200));
+        metrics.observe_request("BREW", "/metrics-test/:id", 404, std::chrono::microseconds(200));
+    });
+    other.join();
+    metrics.observe_request("GET", "", 404, std::chrono::microseconds(10));
+
+    auto pool = metrics.register_pool("postgres");
+    pool->size = 4;
+    pool->in_use = 1;
+    pool->acquire.observe(std::chrono::milliseconds(2));
+
+    const std::string text = metrics.render();
+    CHECK(text.find("# TYPE blaze_http_requests_total counter\n") != std::string::npos);
+    // Series from both threads are merged
+    CHECK(text.find("blaze_http_requests_total{method=\"GET\",route=\"/metrics-test/:id\",status=\"200\"} 2\n")
+          != std::string::npos);
+    CHECK(text.find("blaze_http_requests_total{method=\"OTHER\",route=\"/metrics-test/:id\",status=\"404\"} 1\n")
+          != std::string::npos);
+    CHECK(text.find("{method=\"GET\",route=\"unmatched\",status=\"404\"}") != std::string::npos);
+
+    // Buckets are cumulative and labelled in seconds
+    const std::string series = "blaze_http_request_duration_seconds_bucket{method=\"GET\",route=\"/metrics-test/:id\",status=\"200\",";
+    CHECK(text.find(series + "le=\"0.0001\"} 0\n") != std::string::npos);
+    CHECK(text.find(series + "le=\"0.00025\"} 2\n") != std::string::npos);
+    CHECK(text.find(series + "le=\"+Inf\"} 2\n") != std::string::npos);
+
+    CHECK(text.find("blaze_db_pool_connections{driver=\"postgres\",pool=\"" + pool->id + "\"} 4\n") != std::string::npos);
+    CHECK(text.find("blaze_db_pool_in_use{driver=\"postgres\",pool=\"" + pool->id + "\"} 1\n") != std::string::npos);
+    CHECK(text.find("blaze_db_pool_acquire_seconds_count{driver=\"postgres\",pool=\"" + pool->id + "\"} 1\n") != std::string::npos);
+    CHECK(text.find("# TYPE blaze_log_dropped_records_total counter\n") != std::string::npos);
+
+    // A destroyed pool is no longer reported
+    const std::string label = "pool=\"" + pool->id + "\"";
+    pool.reset();
+    CHECK(metrics.render().find(label) == std::string::npos);
+}
+
+TEST_CASE("Metrics: Label Escaping", "[metrics]") {
+    std::string out;
+    Metrics::write_label(out, "path", "/a\"b\\c\nd", true);
+    Metrics::write_label(out, "x", "y", false);
+    CHECK(out == "path=\"/a\\\"b\\\\c\\nd\",x=\"y\"");
+}
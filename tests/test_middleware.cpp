@@ -49,6 +49,133 @@ TEST_CASE("Middleware: Execution Order", "[middleware]") {
     }
 }
 
+TEST_CASE("Middleware: Flattened Pipeline", "[middleware]") {
+    std::vector<int> trace;
+    Pipeline pipeline;
+
+    pipeline.add([&](Request&, Response&, Next next) -> Async<void> {
+        trace.push_back(1);
+        co_await next();
+        trace.push_back(5);
+    });
+    pipeline.add([&](Request& req, Response&, Next next) -> Async<void> {
+        trace.push_back(2);
+        if (req.path == "/blocked") co_return; // Short-circuit
+        co_await next();
+        if (req.path == "/twice") co_await next();
+        trace.push_back(4);
+    });
+
+    const Handler handler = [&](Request&, Response& res) -> Async<void> {
+        trace.push_back(3);
+        res.send("OK");
+        co_return;
+    };
+
+    auto run = [&](const std::string& path) {
+        trace.clear();
+        Request req;
+        req.method = "GET";
+        req.path = path;
+        Response res;
+        net::io_context ioc;
+        net::co_spawn(ioc, pipeline.run(req, res, handler), net::detached);
+        ioc.run();
+        return res.get_status();
+    };
+
+    SECTION("Layers wrap the handler in order") {
+        run("/ok");
+        CHECK(trace == std::vector<int>{1, 2, 3, 4, 5});
+    }
+
+    SECTION("A layer that doesn't call next ends the chain") {
+        run("/blocked");
+        CHECK(trace == std::vector<int>{1, 2, 5});
+    }
+
+    SECTION("Calling next twice runs the rest of the chain twice") {
+        run("/twice");
+        CHECK(trace == std::vector<int>{1, 2, 3, 3, 4, 5});
+    }
+
+    SECTION("An empty pipeline calls the handler directly") {
+        Pipeline empty;
+        Request req;
+        Response res;
+        net::io_context ioc;
+        net::co_spawn(ioc, empty.run(req, res, handler), net::detached);
+        ioc.run();
+        CHECK(trace == std::vector<int>{3});
+    }
+}
+
+TEST_CASE("Middleware: Route and Group Middleware", "[middleware][router]") {
+    std::vector<std::string> trace;
+    auto tag = [&](std::string name) -> Middleware {
+        return [&trace, name](Request&, Response&, Next next) -> Async<void> {
+            trace.push_back(name);
+            co_await next();
+        };
+    };
+    const Handler handler = [&](Request&, Response& res) -> Async<void> {
+        trace.push_back("handler");
+        res.send("OK");
+        co_return;
+    };
+
+    Router router;
+    router.use(tag("global"));
+    router.add_route("GET", "/health", handler);
+
+    RouteGroup api(router, "/api", {tag("api")});
+    api.get("/public", handler);
+    api.use(tag("auth"));
+    api.get("/me", {tag("route")}, handler);
+    api.group("/admin").get("/stats", handler);
+    router.compile();
+
+    auto run = [&](const std::string& path) {
+        trace.clear();
+        Request req;
+        req.method = "GET";
+        req.path = path;
+        Response res;
+        const RouteView route = router.find(req.method, req.path);
+        REQUIRE(route);
+        net::io_context ioc;
+        net::co_spawn(ioc, route.pipeline->run(req, res, *route.handler), net::detached);
+        ioc.run();
+        return trace;
+    };
+
+    SECTION("Routes outside the group run only global middleware") {
+        CHECK(run("/health") == std::vector<std::string>{"global", "handler"});
+    }
+
+    SECTION("Group use() applies to routes registered after it") {
+        CHECK(run("/api/public") == std::vector<std::string>{"global", "api", "handler"});
+    }
+
+    SECTION("Chain order is global, group, then route") {
+        CHECK(run("/api/me") == std::vector<std::string>{"global", "api", "auth", "route", "handler"});
+    }
+
+    SECTION("Nested groups inherit their parent's middleware") {
+        CHECK(run("/api/admin/stats") == std::vector<std::string>{"global", "api", "auth", "handler"});
+    }
+
+    SECTION("Global middleware added later reaches every route") {
+        router.use(tag("late"));
+        CHECK(run("/api/me") == std::vector<std::string>{"global", "late", "api", "auth", "route", "handler"});
+    }
+
+    SECTION("Unmatched requests run the global pipeline") {
+        CHECK(router.middleware().size() == 1);
+        CHECK_FALSE(router.find("GET", "/api/missing"));
+    }
+}
+
 TEST_CASE("Middleware: JWT and User Context", "[middleware][auth]") {
     App app;
     std::string secret = "test-secret";
@@ -143,7 +270,7 @@ TEST_CASE("Middleware: Rate Limiting", "[middleware]") {
         req.method = "GET";
         req.path = "/limit";
         req.set("client_ip", ip); // Simulate IP from App
-        return app.handle_request(req, ip, false); // IP arg here is for logger, req.set is for middleware
+        return app.handle_request(req, ip); // IP arg here is for logger, req.set is for middleware
     };
 
 
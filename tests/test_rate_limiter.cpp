@@ -0,0 +1,359 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/util/rate_limiter.h>
+#include <blaze/rate_limit.h>
+#include <blaze/app.h>
+#include <blaze/middleware.h>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace blaze;
+using namespace std::chrono_literals;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+    // Just enough of a Redis server for RedisRateLimitBackend: AUTH, INCRBY and PEXPIRE
+    class FakeRedis {
+    public:
+        FakeRedis(unsigned short port, std::string password = "")
+            : acceptor_(ioc_, {net::ip::make_address("127.0.0.1"), port}), password_(std::move(password)) {
+            accept_thread_ = std::thread([this] { accept_loop(); });
+        }
+
+        ~FakeRedis() {
+            stopping_ = true;
+            {
+                // Wake the blocking accept
+                tcp::socket poke(ioc_);
+                boost::system::error_code ec;
+                poke.connect(acceptor_.local_endpoint(), ec);
+            }
+            accept_thread_.join();
+            {
+                std::lock_guard lock(mutex_);
+                for (auto& socket : sockets_) {
+                    boost::system::error_code ec;
+                    socket->shutdown(tcp::socket::shutdown_both, ec);
+                }
+            }
+            for (auto& thread : connection_threads_) thread.join();
+        }
+
+        int incrby_calls() const { return incrby_calls_; }
+
+    private:
+        void accept_loop() {
+            while (true) {
+                auto socket = std::make_shared<tcp::socket>(ioc_);
+                boost::system::error_code ec;
+                acceptor_.accept(*socket, ec);
+                if (ec || stopping_) return;
+                std::lock_guard lock(mutex_);
+                sockets_.push_back(socket);
+                connection_threads_.emplace_back([this, socket] { serve(*socket); });
+            }
+        }
+
+        void serve(tcp::socket& socket) {
+            std::string buffer;
+            bool authenticated = password_.empty();
+            auto read_line = [&] {
+                const size_t n = net::read_until(socket, net::dynamic_buffer(buffer), "\r\n");
+                std::string line = buffer.substr(0, n - 2);
+                buffer.erase(0, n);
+                return line;
+            };
+            try {
+                while (true) {
+                    const int argc = std::stoi(read_line().substr(1));
+                    std::vector<std::string> args;
+                    for (int i = 0; i < argc; ++i) {
+                        const size_t length = std::stoul(read_line().substr(1));
+                        if (buffer.size() < length + 2) net::read(socket, net::dynamic_buffer(buffer), net::transfer_exactly(length + 2 - buffer.size()));
+                        args.push_back(buffer.substr(0, length));
+                        buffer.erase(0, length + 2);
+                    }
+
+                    std::string reply;
+                    if (args[0] == "AUTH") {
+                        authenticated = args[1] == password_;
+                        reply = authenticated ? "+OK\r\n" : "-WRONGPASS invalid password\r\n";
+                    } else if (!authenticated) {
+                        reply = "-NOAUTH Authentication required.\r\n";
+                    } else if (args[0] == "INCRBY") {
+                        ++incrby_calls_;
+                        std::lock_guard lock(mutex_);
+                        reply = ":" + std::to_string(counters_[args[1]] += std::stoll(args[2])) + "\r\n";
+                    } else {
+                        reply = ":1\r\n";
+                    }
+                    net::write(socket, net::buffer(reply));
+                }
+            } catch (...) {}
+        }
+
+        net::io_context ioc_;
+        tcp::acceptor acceptor_;
+        std::string password_;
+        std::atomic<bool> stopping_{false};
+        std::atomic<int> incrby_calls_{0};
+        std::thread accept_thread_;
+        std::mutex mutex_;
+        std::vector<std::shared_ptr<tcp::socket>> sockets_;
+        std::vector<std::thread> connection_threads_;
+        std::map<std::string, long long> counters_;
+    };
+
+    template <typename T>
+    T run_async(net::io_context& ioc, net::awaitable<T> task) {
+        auto result = net::co_spawn(ioc, std::move(task), net::use_future);
+        ioc.restart();
+        ioc.run();
+        return result.get();
+    }
+
+}
+
+TEST_CASE("RateLimiter: GCRA", "[rate_limit]") {
+    RateLimiter limiter(3, 1s);
+    const auto t0 = RateLimiter::Clock::now();
+
+    SECTION("A full burst, then one request per interval") {
+        CHECK(limiter.acquire("a", t0).remaining == 2);
+        CHECK(limiter.acquire("a", t0).remaining == 1);
+        CHECK(limiter.acquire("a", t0).remaining == 0);
+
+        const auto denied = limiter.acquire("a", t0);
+        CHECK_FALSE(denied.allowed);
+        CHECK(denied.retry_after == 334ms);
+
+        // Keys are independent
+        CHECK(limiter.acquire("b", t0).allowed);
+
+        CHECK_FALSE(limiter.acquire("a", t0 + 300ms).allowed);
+        CHECK(limiter.acquire("a", t0 + 334ms).allowed);
+        CHECK_FALSE(limiter.acquire("a", t0 + 334ms).allowed);
+
+        // A whole window later the burst is available again
+        const auto later = t0 + 2s;
+        CHECK(limiter.acquire("a", later).remaining == 2);
+    }
+
+    SECTION("Denied requests don't use up the allowance") {
+        for (int i = 0; i < 3; ++i) limiter.acquire("a", t0);
+        for (int i = 0; i < 100; ++i) CHECK_FALSE(limiter.acquire("a", t0 + 100ms).allowed);
+        CHECK(limiter.acquire("a", t0 + 334ms).allowed);
+    }
+
+    SECTION("Idle keys are dropped once their allowance has refilled") {
+        RateLimiter single(3, 1s, 1);
+        for (int i = 0; i < 100; ++i) single.acquire("client-" + std::to_string(i), t0);
+        CHECK(single.size() == 100);
+
+        // A busy key survives the sweep with its state intact
+        for (int i = 0; i < 3; ++i) single.acquire("busy", t0 + 1500ms);
+        CHECK(single.size() == 1);
+        CHECK_FALSE(single.acquire("busy", t0 + 1500ms).allowed);
+    }
+
+    SECTION("Concurrent requests never exceed the limit") {
+        RateLimiter shared(1000, 1s);
+        std::atomic<int> allowed{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 500; ++i) {
+                    if (shared.acquire("hot", t0).allowed) ++allowed;
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(allowed == 1000);
+    }
+
+    CHECK_THROWS_AS(RateLimiter(0, 1s), std::invalid_argument);
+}
+
+TEST_CASE("RateLimit: Redis Backend", "[rate_limit][integration]") {
+    net::io_context ioc;
+    // An hour-long window, so the test doesn't straddle a window boundary
+    RedisRateLimitOptions options{.port = 9980, .max_requests = 250, .window = 3600s, .lease_size = 100};
+
+    SECTION("Instances share one limit and lease tokens in batches") {
+        FakeRedis redis(9980);
+        RedisRateLimitBackend first(ioc, options);
+        RedisRateLimitBackend second(ioc, options);
+        CHECK_FALSE(first.try_acquire("client"));
+
+        const int allowed = run_async(ioc, [&]() -> net::awaitable<int> {
+            int count = 0;
+            for (int i = 0; i < 300; ++i) {
+                RedisRateLimitBackend& instance = i % 2 ? second : first;
+                auto decision = instance.try_acquire("client");
+                if (!decision) decision = co_await instance.acquire("client");
+                if (decision->allowed) ++count;
+            }
+            co_return count;
+        }());
+
+        CHECK(allowed == 250);
+        // Two leases each: the second one came back short (50 tokens) or empty
+        CHECK(redis.incrby_calls() == 4);
+        CHECK(first.round_trips() + second.round_trips() == 4);
+
+        // Exhausted keys are refused locally until the window ends
+        const auto refused = second.try_acquire("client");
+        REQUIRE(refused);
+        CHECK_FALSE(refused->allowed);
+        CHECK(refused->retry_after > 0ms);
+        CHECK(redis.incrby_calls() == 4);
+
+        // Other keys have their own count
+        CHECK(run_async(ioc, first.acquire("other")).allowed);
+    }
+
+    SECTION("Concurrent requests for a key share one lease") {
+        FakeRedis redis(9980);
+        RedisRateLimitBackend backend(ioc, options);
+
+        std::vector<std::future<RateLimitBackend::Decision>> decisions;
+        for (int i = 0; i < 50; ++i) {
+            decisions.push_back(net::co_spawn(ioc, backend.acquire("burst"), net::use_future));
+        }
+        ioc.restart();
+        ioc.run();
+
+        for (auto& decision : decisions) CHECK(decision.get().allowed);
+        CHECK(redis.incrby_calls() == 1);
+        CHECK(backend.try_acquire("burst")->remaining == 49);
+    }
+
+    SECTION("AUTH is sent when a password is set") {
+        FakeRedis redis(9980, "secret");
+        options.password = "secret";
+        RedisRateLimitBackend backend(ioc, options);
+        CHECK(run_async(ioc, backend.acquire("client")).allowed);
+        CHECK(redis.incrby_calls() == 1);
+    }
+
+    SECTION("An unreachable server fails open, or closed if configured") {
+        RedisRateLimitBackend open(ioc, options);
+        CHECK(run_async(ioc, open.acquire("client")).allowed);
+
+        options.fail_open = false;
+        RedisRateLimitBackend closed(ioc, options);
+        CHECK_FALSE(run_async(ioc, closed.acquire("client")).allowed);
+    }
+}
+
+TEST_CASE("Middleware: Keyed Rate Limiting", "[rate_limit][middleware][integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.use(middleware::rate_limit({.max_requests = 2, .window = 60s, .key = middleware::key_by_header("X-API-Key")}));
+
+    app.get("/limited", [](Response& res) -> Async<void> {
+        res.send("OK");
+        co_return;
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9981);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9981");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    namespace http = boost::beast::http;
+    auto send = [&](const std::string& api_key) {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        const std::string extra = api_key.empty() ? "" : "X-API-Key: " + api_key + "\r\n";
+        net::write(socket, net::buffer("GET /limited HTTP/1.1\r\nHost: localhost\r\n" + extra + "\r\n"));
+        http::response<http::string_body> res;
+        boost::beast::flat_buffer buffer;
+        http::read(socket, buffer, res);
+        return res;
+    };
+
+    CHECK(send("alpha").result_int() == 200);
+    CHECK(send("alpha").result_int() == 200);
+    auto blocked = send("alpha");
+    CHECK(blocked.result_int() == 429);
+    CHECK(blocked[http::field::retry_after] == "30");
+
+    // Other keys, and keyless requests (counted per IP), have their own allowance
+    CHECK(send("beta").result_int() == 200);
+    CHECK(send("").result_int() == 200);
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+// Not run by default: ./blaze_tests "[benchmark]" prints throughput per thread count
+// for the sharded limiter and for a single mutex-guarded map (the previous design)
+TEST_CASE("RateLimiter: Thread Scaling", "[.][benchmark][rate_limit]") {
+    constexpr int kOps = 2'000'000;
+    constexpr int kClients = 10'000;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < kClients; ++i) keys.push_back("10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256));
+
+    auto measure = [&](int threads, auto&& acquire) {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < kOps / threads; ++i) acquire(keys[(size_t(i) * 7919 + size_t(t) * 104729) % kClients]);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return kOps / seconds / 1e6;
+    };
+
+    std::printf("\n%d acquires over %d clients, %u hardware threads\n", kOps, kClients,
+                std::thread::hardware_concurrency());
+    std::printf("threads   sharded Mops/s   single mutex Mops/s\n");
+    for (int threads : {1, 2, 4, 8}) {
+        RateLimiter limiter(1'000'000, 60s);
+        const double sharded = measure(threads, [&](const std::string& key) { limiter.acquire(key); });
+
+        std::mutex mutex;
+        std::unordered_map<std::string, std::pair<int, std::chrono::steady_clock::time_point>> clients;
+        const double single = measure(threads, [&](const std::string& key) {
+            const auto now = std::chrono::steady_clock::now();
+            std::lock_guard lock(mutex);
+            auto& client = clients[key];
+            if (now - client.second > 60s) client = {0, now};
+            if (client.first < 1'000'000) ++client.first;
+        });
+        std::printf("%7d   %14.2f   %19.2f\n", threads, sharded, single);
+    }
+}
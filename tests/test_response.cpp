@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include <blaze/response.h>
+#include <blaze/util/http_date.h>
 
 using namespace blaze;
 
@@ -28,3 +29,57 @@ TEST_CASE("Response: Beast-based Serialization", "[response]") {
         CHECK(raw.find("{\"status\":\"ok\"}") != std::string::npos);
     }
 }
+
+TEST_CASE("Response: Pre-serialized Static Response", "[response]") {
+    StaticResponse fixed(200, "OK", {{"Content-Type", "text/plain"}});
+
+    CHECK(fixed.head() ==
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Type: text/plain\r\n"
+          "Content-Length: 2\r\n");
+
+    Response res;
+    fixed.apply(res);
+    CHECK(res.get_status() == 200);
+    CHECK(res.get_beast_response()["Content-Type"] == "text/plain");
+    CHECK(res.get_beast_response().body() == "OK");
+}
+
+TEST_CASE("Response: HTTP Date Formatting", "[response]") {
+    char out[HttpDate::kLength];
+    HttpDate::format(784111777, out);
+    CHECK(std::string(out, sizeof(out)) == "Sun, 06 Nov 1994 08:49:37 GMT");
+
+    CHECK(HttpDate::parse("Sun, 06 Nov 1994 08:49:37 GMT") == std::optional<std::time_t>(784111777));
+    CHECK_FALSE(HttpDate::parse("Sunday, 06-Nov-94 08:49:37 GMT"));
+    CHECK_FALSE(HttpDate::parse("Sun, 06 Nov 1994 08:49:37 UTC"));
+    CHECK_FALSE(HttpDate::parse("Sun, 06 Xyz 1994 08:49:37 GMT"));
+}
+
+TEST_CASE("Response: Shared Date/Server Header Block", "[response]") {
+    HeaderBlock block("Test/2.0");
+
+    std::string out;
+    block.append_to(out);
+    REQUIRE(out.size() == 6 + HttpDate::kLength + 2 + 18);
+    CHECK(out.starts_with("Date: "));
+    CHECK(out.substr(6 + HttpDate::kLength) == "\r\nServer: Test/2.0\r\n");
+    const HeaderBlock::DateText date = block.date();
+    CHECK(std::string_view(date.data(), date.size()) == out.substr(6, HttpDate::kLength));
+
+    SECTION("Lines can be appended separately") {
+        std::string date_only, server_only;
+        block.append_to(date_only, true, false);
+        block.append_to(server_only, false, true);
+        CHECK(date_only + server_only == out);
+        CHECK(server_only == "Server: Test/2.0\r\n");
+    }
+
+    SECTION("Refreshing keeps the layout") {
+        block.refresh();
+        std::string again;
+        block.append_to(again);
+        CHECK(again.size() == out.size());
+        CHECK(again.ends_with("GMT\r\nServer: Test/2.0\r\n"));
+    }
+}
@@ -53,4 +53,70 @@ TEST_CASE("Router: Parameter Extraction", "[router]") {
         CHECK(match->params.at("name") == "Jane Doe");
         CHECK(match->path_values[match->path_values.size()-1] == "Jane Doe");
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Router: Radix Tree Lookup", "[router]") {
+    Router router;
+    auto noop = [](Request&, Response&) -> Async<void> { co_return; };
+
+    router.add_route("GET", "/api/v1/users", noop);
+    router.add_route("GET", "/api/v1/users/:id", noop);
+    router.add_route("GET", "/api/v1/users/me", noop);
+    router.add_route("GET", "/api/v2/status", noop);
+    router.add_route("GET", "/files/:name/raw", noop);
+    router.add_route("GET", "/files/latest/meta", noop);
+    router.add_route("PATCH", "/api/v1/users/:id", noop);
+    router.add_route("GET", "/", noop);
+    router.compile();
+
+    SECTION("Shared prefixes are split without losing routes") {
+        CHECK(router.find("GET", "/api/v1/users"));
+        CHECK(router.find("GET", "/api/v2/status"));
+        CHECK_FALSE(router.find("GET", "/api/v1"));
+        CHECK_FALSE(router.find("GET", "/api/v3/status"));
+    }
+
+    SECTION("Static segments win over parameters") {
+        auto me = router.find("GET", "/api/v1/users/me");
+        REQUIRE(me);
+        CHECK(me.params().empty());
+
+        auto id = router.find("GET", "/api/v1/users/42");
+        REQUIRE(id);
+        CHECK(id.param("id") == "42");
+    }
+
+    SECTION("Falls back to the parameter edge when the static branch dead-ends") {
+        auto raw = router.find("GET", "/files/latest/raw");
+        REQUIRE(raw);
+        CHECK(raw.param("name") == "latest");
+        CHECK(router.find("GET", "/files/latest/meta"));
+    }
+
+    SECTION("Parameter spans are raw views into the request path") {
+        std::string path = "/api/v1/users/Jane%20Doe?x=1";
+        auto view = router.find("GET", path);
+        REQUIRE(view);
+        REQUIRE(view.params().size() == 1);
+        CHECK(view.params()[0].name == "id");
+        CHECK(view.params()[0].value == "Jane%20Doe");
+        CHECK(view.params()[0].value.data() == path.data() + 14);
+    }
+
+    SECTION("Each method has its own table") {
+        CHECK(router.find("PATCH", "/api/v1/users/7"));
+        CHECK_FALSE(router.find("PATCH", "/api/v1/users"));
+        CHECK_FALSE(router.find("PURGE", "/api/v1/users"));
+    }
+
+    SECTION("Root and redundant slashes") {
+        CHECK(router.find("GET", "/"));
+        CHECK(router.find("GET", ""));
+        CHECK(router.find("GET", "//api//v1/users/"));
+    }
+
+    SECTION("Routes added after compile are picked up") {
+        router.add_route("GET", "/late", noop);
+        CHECK(router.find("GET", "/late"));
+    }
+}
@@ -5,6 +5,10 @@
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <sstream>
 
 using namespace blaze;
 namespace net = boost::asio;
@@ -62,6 +66,9 @@ TEST_CASE("Server: End-to-End Request", "[integration]") {
         CHECK(res.result() == boost::beast::http::status::ok);
         CHECK(res.body() == "Integration OK");
         CHECK(res[boost::beast::http::field::server] == "Blaze/1.0");
+        CHECK(res[boost::beast::http::field::date].ends_with(" GMT"));
+        CHECK(res[boost::beast::http::field::content_length] == "14");
+        CHECK_FALSE(res.keep_alive());
     }
 
     app.engine().stop();
@@ -312,4 +319,543 @@ TEST_CASE("Server: Auth & Cookies", "[integration]") {
 
     app.engine().stop();
     if (server_thread.joinable()) server_thread.join();
-}
\ No newline at end of file
+}
+TEST_CASE("Server: HTTP/1.1 Pipelining", "[integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.pipeline_depth(2);
+
+    app.get("/sleep/:ms", [](Path<int> ms, Response& res) -> Async<void> {
+        co_await delay(std::chrono::milliseconds(ms));
+        res.send("slept " + std::to_string(ms));
+    });
+
+    app.get("/echo/:text", [](Path<std::string> text) -> Async<std::string> {
+        co_return text;
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9989);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9989");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    auto read_body = [](tcp::socket& socket, boost::beast::flat_buffer& buffer) {
+        boost::beast::http::response<boost::beast::http::string_body> res;
+        boost::beast::http::read(socket, buffer, res);
+        return res.body();
+    };
+
+    SECTION("Responses come back in request order") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+
+        // More requests than the pipeline depth, with a slow one first
+        std::string batch =
+            "GET /sleep/150 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /echo/one HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /sleep/50 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /echo/two HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /echo/three HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+        net::write(socket, net::buffer(batch));
+
+        boost::beast::flat_buffer buffer;
+        CHECK(read_body(socket, buffer) == "slept 150");
+        CHECK(read_body(socket, buffer) == "one");
+        CHECK(read_body(socket, buffer) == "slept 50");
+        CHECK(read_body(socket, buffer) == "two");
+        CHECK(read_body(socket, buffer) == "three");
+    }
+
+    SECTION("Pipelined handlers run concurrently") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+
+        const auto start = std::chrono::steady_clock::now();
+        net::write(socket, net::buffer(std::string(
+            "GET /sleep/400 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /sleep/400 HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+
+        boost::beast::flat_buffer buffer;
+        CHECK(read_body(socket, buffer) == "slept 400");
+        CHECK(read_body(socket, buffer) == "slept 400");
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(700));
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+namespace {
+    struct ShardProbe {
+        net::io_context* ioc;
+    };
+}
+
+TEST_CASE("Server: Shard-per-core Mode", "[integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.shard_per_core(true).num_threads(3);
+
+    app.provide_per_shard<ShardProbe>([](net::io_context& ioc) {
+        return std::make_shared<ShardProbe>(ShardProbe{&ioc});
+    });
+
+    // Reports which shard served the request and whether its service belongs to that shard
+    app.get("/shard", [&app](ShardProbe& probe) -> Async<std::string> {
+        co_return std::to_string(this_shard()) + (probe.ioc == &app.local_engine() ? ":local" : ":foreign");
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9987);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9987");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    auto get_shard = [](tcp::socket& socket, boost::beast::flat_buffer& buffer) {
+        net::write(socket, net::buffer(std::string("GET /shard HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+        boost::beast::http::response<boost::beast::http::string_body> res;
+        boost::beast::http::read(socket, buffer, res);
+        return res.body();
+    };
+
+    SECTION("Connections are spread across shards and stay on theirs") {
+        std::set<std::string> seen;
+        bool sticky = true;
+        for (int i = 0; i < 30; ++i) {
+            tcp::socket socket(ioc);
+            net::connect(socket, results);
+            boost::beast::flat_buffer buffer;
+            const std::string first = get_shard(socket, buffer);
+            sticky = get_shard(socket, buffer) == first && get_shard(socket, buffer) == first && sticky;
+            seen.insert(first);
+        }
+
+        CHECK(sticky);
+        CHECK(seen.size() > 1);
+        for (const auto& shard : seen) {
+            CHECK(shard.ends_with(":local"));
+        }
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+TEST_CASE("Server: Pre-serialized Static Responses", "[integration]") {
+    App app;
+    app.log_to("/dev/null");
+
+    std::atomic<int> middleware_hits{0};
+    app.use([&](Request&, Response&, Next next) -> Async<void> {
+        ++middleware_hits;
+        co_await next();
+    });
+
+    app.get_static("/health", "OK", {{"Content-Type", "text/plain"}});
+    app.get_static("/config", R"({"version":3})", {{"Content-Type", "application/json"}});
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9986);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9986");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    SECTION("Served without running middleware, over keep-alive") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(std::string(
+            "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /config?cache=no HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")));
+
+        boost::beast::flat_buffer buffer;
+        boost::beast::http::response<boost::beast::http::string_body> first, second;
+        boost::beast::http::read(socket, buffer, first);
+        boost::beast::http::read(socket, buffer, second);
+
+        CHECK(first.result_int() == 200);
+        CHECK(first.body() == "OK");
+        CHECK(first[boost::beast::http::field::content_type] == "text/plain");
+        CHECK(first[boost::beast::http::field::server] == "Blaze/1.0");
+        CHECK(first[boost::beast::http::field::date].size() == HttpDate::kLength);
+        CHECK(first.keep_alive());
+
+        CHECK(second.body() == R"({"version":3})");
+        CHECK_FALSE(second.keep_alive());
+        CHECK(middleware_hits == 0);
+    }
+
+    SECTION("HEAD gets headers only") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(std::string("HEAD /health HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")));
+
+        boost::beast::flat_buffer buffer;
+        boost::beast::http::response_parser<boost::beast::http::string_body> parser;
+        parser.skip(true);
+        boost::beast::http::read(socket, buffer, parser);
+        CHECK(parser.get().result_int() == 200);
+        CHECK(parser.get()[boost::beast::http::field::content_length] == "2");
+
+        // Nothing follows the head
+        boost::beast::error_code ec;
+        char extra;
+        CHECK(socket.read_some(net::buffer(&extra, 1), ec) == 0);
+        CHECK(ec == net::error::eof);
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+TEST_CASE("Server: Streaming Request Bodies", "[integration]") {
+    App app;
+    app.log_to("/dev/null");
+    app.stream_chunk_size(4096).max_stream_body_size(200000).max_body_size(50000);
+
+    app.post_stream("/upload", [](Request& req, Response& res) -> Async<void> {
+        size_t bytes = 0, chunks = 0, largest = 0;
+        for (auto chunk = co_await req.read_chunk(); !chunk.empty(); chunk = co_await req.read_chunk()) {
+            bytes += chunk.size();
+            largest = std::max(largest, chunk.size());
+            ++chunks;
+        }
+        res.send(std::to_string(bytes) + " " + std::to_string(chunks) + " " + std::to_string(largest) +
+                 " " + std::to_string(req.body.size()));
+    });
+
+    const std::string saved = "/tmp/blaze_stream_test.bin";
+    app.put_stream("/files", [&](Request& req, Response& res) -> Async<void> {
+        const size_t n = co_await req.save_to(saved);
+        res.send(std::to_string(n));
+    });
+
+    app.post_stream("/ignore", [](Response& res) -> Async<void> {
+        res.send("ignored");
+        co_return;
+    });
+
+    app.post("/buffered", [](Request& req, Response& res) -> Async<void> {
+        res.send(std::to_string(req.body.size()) + (req.is_streaming() ? " streaming" : " buffered"));
+        co_return;
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9985);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9985");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    namespace http = boost::beast::http;
+    auto post = [](const std::string& target, const std::string& body, const std::string& extra = "") {
+        return "POST " + target + " HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n" + extra + "\r\n" + body;
+    };
+
+    SECTION("Handler reads the body in bounded chunks, then the connection is reused") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        const std::string payload(100000, 'x');
+        net::write(socket, net::buffer(post("/upload", payload) + post("/buffered", "abc")));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> first, second;
+        http::read(socket, buffer, first);
+        http::read(socket, buffer, second);
+
+        CHECK(first.result_int() == 200);
+        std::istringstream fields(first.body());
+        size_t bytes = 0, chunks = 0, largest = 0, buffered = 1;
+        fields >> bytes >> chunks >> largest >> buffered;
+        CHECK(bytes == payload.size());
+        CHECK(chunks >= payload.size() / 4096);
+        CHECK(largest <= 4096);
+        CHECK(buffered == 0);
+        CHECK(first.keep_alive());
+
+        CHECK(second.body() == "3 buffered");
+    }
+
+    SECTION("Chunked uploads stream to a file") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(std::string(
+            "PUT /files HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n"
+            "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n")));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+        CHECK(res.body() == "11");
+
+        std::ifstream in(saved, std::ios::binary);
+        CHECK(std::string(std::istreambuf_iterator<char>(in), {}) == "hello world");
+        std::remove(saved.c_str());
+    }
+
+    SECTION("Expect: 100-continue is answered before the body is sent") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(std::string(
+            "POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 4\r\nExpect: 100-continue\r\n\r\n")));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::empty_body> interim;
+        http::read(socket, buffer, interim);
+        CHECK(interim.result_int() == 100);
+
+        net::write(socket, net::buffer(std::string("data")));
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+        CHECK(res.body().rfind("4 1 4", 0) == 0);
+    }
+
+    SECTION("An unread body closes the connection") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(post("/ignore", std::string(50000, 'y'))));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+        CHECK(res.body() == "ignored");
+        CHECK_FALSE(res.keep_alive());
+    }
+
+    SECTION("Streamed bodies have their own size limit") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(post("/upload", std::string(300000, 'z'))));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+        CHECK(res.result_int() == 413);
+    }
+
+    SECTION("Buffered routes keep max_body_size") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(post("/buffered", std::string(60000, 'z'))));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+        CHECK(res.result_int() == 413);
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
+
+TEST_CASE("Server: Streaming Responses", "[integration]") {
+    App app;
+    app.log_to("/dev/null");
+
+    app.get("/count/:n", [](Path<int> n, Response& res) -> Async<void> {
+        const int count = n;
+        res.header("X-Kind", "count").stream([count](ResponseWriter& out) -> Async<void> {
+            for (int i = 0; i < count; ++i) co_await out.write(std::to_string(i) + "\n");
+        });
+        co_return;
+    });
+
+    app.get("/events", [](Response& res) -> Async<void> {
+        res.sse([](SseWriter& sse) -> Async<void> {
+            co_await sse.retry(std::chrono::milliseconds(1500));
+            co_await sse.send("hello", "greeting", "1");
+            co_await sse.send("line one\nline two");
+            co_await sse.comment();
+        });
+        co_return;
+    });
+
+    std::atomic<size_t> written{0};
+    const size_t chunk = 64 * 1024, total_chunks = 64;
+    app.get("/firehose", [&](Response& res) -> Async<void> {
+        res.stream([&written, chunk, total_chunks](ResponseWriter& out) -> Async<void> {
+            const std::string block(chunk, 'f');
+            for (size_t i = 0; i < total_chunks; ++i) {
+                co_await out.write(block);
+                written += block.size();
+            }
+        });
+        co_return;
+    });
+
+    app.get("/plain", [](Response& res) -> Async<void> {
+        res.send("plain");
+        co_return;
+    });
+
+    std::thread server_thread([&]() {
+        try {
+            app.listen(9984);
+        } catch (...) {}
+    });
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto const results = resolver.resolve("127.0.0.1", "9984");
+
+    bool connected = false;
+    for(int i=0; i<20; ++i) {
+        try {
+            tcp::socket sock(ioc);
+            net::connect(sock, results);
+            connected = true;
+            break;
+        } catch(...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!connected) FAIL("Could not connect to test server");
+
+    namespace http = boost::beast::http;
+    auto get = [](const std::string& target) {
+        return "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    };
+
+    SECTION("Chunked body, then the connection is reused") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(get("/count/5") + get("/plain")));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> first, second;
+        http::read(socket, buffer, first);
+        http::read(socket, buffer, second);
+
+        CHECK(first.result_int() == 200);
+        CHECK(first.chunked());
+        CHECK(first["X-Kind"] == "count");
+        CHECK(first.count(http::field::content_length) == 0);
+        CHECK(first.body() == "0\n1\n2\n3\n4\n");
+        CHECK(first.keep_alive());
+        CHECK(second.body() == "plain");
+    }
+
+    SECTION("HTTP/1.0 gets the body unchunked, ended by closing the connection") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(std::string("GET /count/3 HTTP/1.0\r\nConnection: keep-alive\r\n\r\n")));
+
+        std::string raw;
+        boost::system::error_code ec;
+        net::read(socket, net::dynamic_buffer(raw), ec);
+        CHECK(ec == net::error::eof);
+
+        const auto split = raw.find("\r\n\r\n");
+        REQUIRE(split != std::string::npos);
+        const std::string head = raw.substr(0, split);
+        CHECK(head.find("Transfer-Encoding") == std::string::npos);
+        CHECK(head.find("Connection: close") != std::string::npos);
+        CHECK(raw.substr(split + 4) == "0\n1\n2\n");
+    }
+
+    SECTION("Server-sent events") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        net::write(socket, net::buffer(get("/events")));
+
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+
+        CHECK(res[http::field::content_type] == "text/event-stream");
+        CHECK(res[http::field::cache_control] == "no-cache");
+        CHECK(res.body() ==
+              "retry: 1500\n\n"
+              "id: 1\nevent: greeting\ndata: hello\n\n"
+              "data: line one\ndata: line two\n\n"
+              ":\n\n");
+    }
+
+    SECTION("A slow reader holds the producer back") {
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        socket.set_option(net::socket_base::receive_buffer_size(16384));
+        net::write(socket, net::buffer(get("/firehose")));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        CHECK(written.load() < chunk * total_chunks);
+
+        boost::beast::flat_buffer buffer;
+        http::response_parser<http::string_body> parser;
+        parser.body_limit(chunk * total_chunks * 2);
+        http::read(socket, buffer, parser);
+        CHECK(parser.get().body().size() == chunk * total_chunks);
+        CHECK(written.load() == chunk * total_chunks);
+    }
+
+    app.engine().stop();
+    if (server_thread.joinable()) server_thread.join();
+}
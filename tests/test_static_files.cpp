@@ -1,6 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include <blaze/app.h>
 #include <blaze/middleware.h>
+#include <blaze/util/compression.h>
+#include <blaze/util/http_date.h>
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -26,7 +28,7 @@ TEST_CASE("Middleware: Static Files Zero-Copy", "[middleware][static]") {
         ofs << content;
     }
 
-    app.use(middleware::static_files(test_dir));
+    app.use(middleware::static_files(test_dir, true, {.revalidate = std::chrono::milliseconds(50)}));
 
     std::thread server_thread([&]() {
         app.listen(9991);
@@ -74,6 +76,167 @@ TEST_CASE("Middleware: Static Files Zero-Copy", "[middleware][static]") {
         CHECK(res[boost::beast::http::field::content_type] == "text/html");
     }
 
+    SECTION("Small files are cached with validators and compressed variants") {
+        std::string css;
+        for (int i = 0; i < 200; ++i) css += ".rule-" + std::to_string(i % 10) + " { color: red; }\n";
+        {
+            std::ofstream ofs(test_dir + "/site.css", std::ios::binary);
+            ofs << css;
+        }
+
+        auto fetch = [&](const std::string& accept, const std::string& target = "/site.css") {
+            tcp::socket socket(ioc);
+            net::connect(socket, results);
+            const std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n" +
+                (accept.empty() ? "" : "Accept-Encoding: " + accept + "\r\n") + "\r\n";
+            net::write(socket, net::buffer(request));
+            boost::beast::http::response<boost::beast::http::string_body> res;
+            boost::beast::flat_buffer buffer;
+            boost::beast::http::read(socket, buffer, res);
+            return res;
+        };
+
+        auto plain = fetch("");
+        CHECK(plain.body() == css);
+        CHECK(plain[boost::beast::http::field::content_type] == "text/css");
+        CHECK(plain[boost::beast::http::field::last_modified].size() == HttpDate::kLength);
+        CHECK(plain[boost::beast::http::field::vary] == "Accept-Encoding");
+        const std::string etag(plain[boost::beast::http::field::etag]);
+        CHECK(etag.front() == '"');
+
+        auto gz = fetch("gzip");
+        CHECK(gz[boost::beast::http::field::content_encoding] == "gzip");
+        CHECK(gz.body().size() < css.size());
+        CHECK(gz[boost::beast::http::field::etag] != etag);
+
+        if (util::brotli_available()) {
+            auto br = fetch("gzip, br");
+            CHECK(br[boost::beast::http::field::content_encoding] == "br");
+            CHECK(br.body().size() < css.size());
+        }
+
+        // Other spellings of the path are served from disk, not loaded into the cache under a key of their own
+        for (const std::string target : {"/./site.css", "//site.css", "/%2E/site.css"}) {
+            auto other = fetch("gzip", target);
+            CHECK(other.result_int() == 200);
+            CHECK(other.body() == css);
+            CHECK(other.count(boost::beast::http::field::content_encoding) == 0);
+        }
+
+        // A rewrite is picked up once the entry is revalidated
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        {
+            std::ofstream ofs(test_dir + "/site.css", std::ios::binary);
+            ofs << "body {}";
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto fresh = fetch("");
+        CHECK(fresh.body() == "body {}");
+        CHECK(fresh[boost::beast::http::field::etag] != etag);
+    }
+
+    SECTION("Conditional requests and byte ranges") {
+        std::string big;
+        for (size_t i = 0; big.size() < 300 * 1024; ++i) big += std::to_string(i) + ";";
+        {
+            std::ofstream ofs(test_dir + "/big.bin", std::ios::binary);
+            ofs << big;
+        }
+
+        auto fetch = [&](const std::string& target, const std::string& extra) {
+            tcp::socket socket(ioc);
+            net::connect(socket, results);
+            net::write(socket, net::buffer("GET " + target + " HTTP/1.1\r\nHost: localhost\r\n" + extra + "\r\n"));
+            boost::beast::http::response_parser<boost::beast::http::string_body> parser;
+            parser.body_limit(1 << 20);
+            boost::beast::flat_buffer buffer;
+            boost::beast::http::read(socket, buffer, parser);
+            return parser.release();
+        };
+
+        // Cached (in-memory) and streamed-from-disk files behave the same
+        for (const std::string target : {"/hello.txt", "/big.bin"}) {
+            const std::string& body = target == "/hello.txt" ? content : big;
+            const std::string mime = target == "/hello.txt" ? "text/plain" : "application/octet-stream";
+            auto full = fetch(target, "");
+            REQUIRE(full.result_int() == 200);
+            CHECK(full.body() == body);
+            CHECK(full[boost::beast::http::field::accept_ranges] == "bytes");
+            const std::string etag(full[boost::beast::http::field::etag]);
+            const std::string modified(full[boost::beast::http::field::last_modified]);
+
+            auto revalidated = fetch(target, "If-None-Match: W/\"nope\", " + etag + "\r\n");
+            CHECK(revalidated.result_int() == 304);
+            CHECK(revalidated.body().empty());
+            CHECK(revalidated[boost::beast::http::field::etag] == etag);
+
+            CHECK(fetch(target, "If-Modified-Since: " + modified + "\r\n").result_int() == 304);
+            CHECK(fetch(target, "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n").result_int() == 200);
+            // If-None-Match wins over If-Modified-Since
+            CHECK(fetch(target, "If-None-Match: \"other\"\r\nIf-Modified-Since: " + modified + "\r\n").result_int() == 200);
+
+            auto first = fetch(target, "Range: bytes=0-3\r\n");
+            CHECK(first.result_int() == 206);
+            CHECK(first.body() == body.substr(0, 4));
+            CHECK(first[boost::beast::http::field::content_range] == "bytes 0-3/" + std::to_string(body.size()));
+
+            auto tail = fetch(target, "Range: bytes=-5\r\n");
+            CHECK(tail.body() == body.substr(body.size() - 5));
+
+            auto multi = fetch(target, "Range: bytes=0-1, 10-14\r\n");
+            CHECK(multi.result_int() == 206);
+            const std::string type(multi[boost::beast::http::field::content_type]);
+            REQUIRE(type.rfind("multipart/byteranges; boundary=", 0) == 0);
+            const std::string boundary = type.substr(type.find('=') + 1);
+            CHECK(multi.body() ==
+                  "--" + boundary + "\r\nContent-Type: " + mime + "\r\nContent-Range: bytes 0-1/" + std::to_string(body.size()) +
+                  "\r\n\r\n" + body.substr(0, 2) +
+                  "\r\n--" + boundary + "\r\nContent-Type: " + mime + "\r\nContent-Range: bytes 10-14/" + std::to_string(body.size()) +
+                  "\r\n\r\n" + body.substr(10, 5) +
+                  "\r\n--" + boundary + "--\r\n");
+
+            auto unsatisfiable = fetch(target, "Range: bytes=" + std::to_string(body.size()) + "-\r\n");
+            CHECK(unsatisfiable.result_int() == 416);
+            CHECK(unsatisfiable[boost::beast::http::field::content_range] == "bytes */" + std::to_string(body.size()));
+
+            // A stale If-Range, or a malformed Range, gets the whole file
+            CHECK(fetch(target, "Range: bytes=0-3\r\nIf-Range: \"stale\"\r\n").body() == body);
+            CHECK(fetch(target, "Range: bytes=0-3\r\nIf-Range: " + etag + "\r\n").body() == body.substr(0, 4));
+            CHECK(fetch(target, "Range: bytes=5-2\r\n").result_int() == 200);
+        }
+    }
+
+    SECTION("Large files arrive intact and the connection is reused") {
+        std::string large;
+        large.reserve(4 * 1024 * 1024);
+        for (size_t i = 0; large.size() < 4 * 1024 * 1024; ++i) large += std::to_string(i) + ",";
+        {
+            std::ofstream ofs(test_dir + "/large.bin", std::ios::binary);
+            ofs << large;
+        }
+
+        tcp::socket socket(ioc);
+        net::connect(socket, results);
+        socket.set_option(net::socket_base::receive_buffer_size(16384));
+        net::write(socket, net::buffer(std::string(
+            "GET /large.bin HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET /hello.txt HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+
+        // Let the server fill the socket buffer so it has to wait for us
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        boost::beast::flat_buffer buffer;
+        boost::beast::http::response_parser<boost::beast::http::string_body> parser;
+        parser.body_limit(large.size() * 2);
+        boost::beast::http::read(socket, buffer, parser);
+        CHECK(parser.get()[boost::beast::http::field::content_length] == std::to_string(large.size()));
+        CHECK(parser.get().body() == large);
+
+        boost::beast::http::response<boost::beast::http::string_body> next;
+        boost::beast::http::read(socket, buffer, next);
+        CHECK(next.body() == content);
+    }
+
     app.engine().stop();
     if (server_thread.joinable()) server_thread.join();
     
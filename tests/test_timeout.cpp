@@ -18,6 +18,13 @@ TEST_CASE("Server: Timeout Protection (Slowloris)", "[security]") {
         co_return;
     });
 
+    // Outlasts the timeout without the connection ever being idle
+    app.get("/slow", [](Response& res) -> Async<void> {
+        net::steady_timer timer(co_await net::this_coro::executor, std::chrono::milliseconds(1500));
+        co_await timer.async_wait(net::use_awaitable);
+        res.send("SLOW");
+    });
+
     std::thread server_thread([&]() {
         app.listen(9090);
     });
@@ -56,6 +63,41 @@ TEST_CASE("Server: Timeout Protection (Slowloris)", "[security]") {
         CHECK(closed == true);
     }
 
+    SECTION("A slow handler keeps its keep-alive connection") {
+        net::io_context ioc;
+        tcp::socket socket(ioc);
+        tcp::resolver resolver(ioc);
+        net::connect(socket, resolver.resolve("127.0.0.1", "9090"));
+
+        // The second request is read ahead while the first handler runs
+        const std::string requests =
+            "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        net::write(socket, net::buffer(requests));
+
+        std::string received;
+        char buf[1024];
+        boost::system::error_code ec;
+        while (!ec && received.find("\r\n\r\nOK", received.find("SLOW")) == std::string::npos) {
+            const size_t len = socket.read_some(net::buffer(buf), ec);
+            received.append(buf, len);
+        }
+        REQUIRE(!ec);
+        CHECK(received.find("HTTP/1.1 200") == 0);
+        CHECK(received.find("SLOW") < received.find("\r\n\r\nOK"));
+
+        // Still open for another request after the slow one
+        net::write(socket, net::buffer(std::string("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+        const size_t len = socket.read_some(net::buffer(buf), ec);
+        REQUIRE(!ec);
+        CHECK(std::string(buf, len).find("HTTP/1.1 200") == 0);
+
+        // Once idle, the timeout applies again
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        socket.read_some(net::buffer(buf), ec);
+        CHECK((ec == net::error::eof || ec == net::error::connection_reset));
+    }
+
     app.engine().stop();
     if (server_thread.joinable()) server_thread.join();
 }
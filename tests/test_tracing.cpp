@@ -0,0 +1,244 @@
+#include <catch2/catch_test_macros.hpp>
+#include <blaze/app.h>
+#include <blaze/request_scope.h>
+#include <blaze/tracing.h>
+#include <boost/asio.hpp>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace blaze;
+namespace net = boost::asio;
+
+namespace {
+    constexpr std::string_view kParent = "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01";
+
+    // Keeps every exported batch in memory
+    class CollectingExporter : public SpanExporter {
+    public:
+        explicit CollectingExporter(std::shared_ptr<std::vector<std::string>> bodies) : bodies_(std::move(bodies)) {}
+
+        bool export_json(const std::string& body) override {
+            bodies_->push_back(body);
+            return true;
+        }
+
+    private:
+        std::shared_ptr<std::vector<std::string>> bodies_;
+    };
+
+    std::shared_ptr<std::vector<std::string>> collect(TracingOptions options = {}) {
+        auto bodies = std::make_shared<std::vector<std::string>>();
+        options.export_interval = std::chrono::hours(1); // Only flush() exports
+        Tracer::instance().configure(std::move(options), std::make_unique<CollectingExporter>(bodies));
+        return bodies;
+    }
+
+    size_t count(const std::string& text, const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) ++n;
+        return n;
+    }
+}
+
+TEST_CASE("Tracing: traceparent", "[tracing]") {
+    const auto context = parse_traceparent(kParent);
+    REQUIRE(context);
+    CHECK(context->span_id == 0xb7ad6b7169203331ULL);
+    CHECK(context->trace_id[0] == 0x0a);
+    CHECK(context->trace_id[15] == 0x9c);
+    CHECK(context->sampled());
+    CHECK(format_traceparent(*context) == kParent);
+
+    CHECK_FALSE(parse_traceparent(""));
+    CHECK_FALSE(parse_traceparent("00-0AF7651916CD43DD8448EB211C80319C-B7AD6B7169203331-01"));  // Uppercase
+    CHECK_FALSE(parse_traceparent("00-00000000000000000000000000000000-b7ad6b7169203331-01"));  // Zero trace id
+    CHECK_FALSE(parse_traceparent("00-0af7651916cd43dd8448eb211c80319c-0000000000000000-01"));  // Zero span id
+    CHECK_FALSE(parse_traceparent("ff-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"));
+    CHECK_FALSE(parse_traceparent(std::string(kParent) + "-extra"));                            // Version 00 is exact
+    CHECK(parse_traceparent("01-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01-extra"));
+}
+
+TEST_CASE("Tracing: Spans and Export", "[tracing]") {
+    auto bodies = collect({.service_name = "orders"});
+    Tracer& tracer = Tracer::instance();
+
+    auto trace = tracer.start_trace(kParent);
+    REQUIRE(trace);
+    std::string child_parent;
+    {
+        Span outer(trace, "outer", SpanKind::SERVER);
+        outer.set_attribute("http.route", "/orders/:id");
+        outer.set_attribute("http.response.status_code", int64_t{200});
+        {
+            Span inner(trace, "inner \"quoted\"");
+            inner.set_error("boom");
+            child_parent = inner.traceparent();
+            CHECK(trace->context().span_id == parse_traceparent(child_parent)->span_id);
+        }
+        // Outside a request scope there is no current trace
+        Span late(Trace::current(), "ignored");
+        CHECK_FALSE(late);
+
+        auto scope = std::make_shared<RequestScope>();
+        scope->trace = trace;
+        {
+            RequestScope::Enter enter(scope.get());
+            CHECK(Trace::current() == trace);
+        }
+        CHECK(Trace::current() == nullptr);
+    }
+    tracer.finish(trace);
+
+    // Spans ending after finish() are discarded
+    { Span after(trace, "after"); }
+
+    tracer.flush();
+    REQUIRE(bodies->size() == 1);
+    const std::string& body = bodies->front();
+    CHECK(body.find(R"("service.name","value":{"stringValue":"orders"})") != std::string::npos);
+    CHECK(count(body, R"("traceId":"0af7651916cd43dd8448eb211c80319c")") == 2);
+    CHECK(body.find(R"("parentSpanId":"b7ad6b7169203331","name":"outer","kind":2)") != std::string::npos);
+    CHECK(body.find(R"("name":"inner \"quoted\"","kind":1)") != std::string::npos);
+    CHECK(body.find(R"({"key":"http.response.status_code","value":{"intValue":"200"}})") != std::string::npos);
+    CHECK(body.find(R"("status":{"code":2,"message":"boom"})") != std::string::npos);
+    CHECK(body.find("after") == std::string::npos);
+
+    SECTION("Sampling") {
+        tracer.configure({.sample_ratio = 0.0}, std::make_unique<CollectingExporter>(bodies));
+        CHECK_FALSE(tracer.start_trace(""));
+        CHECK(tracer.start_trace(kParent));  // A sampled parent wins
+        CHECK_FALSE(tracer.start_trace("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00"));
+    }
+
+    tracer.shutdown();
+    CHECK_FALSE(tracer.start_trace(kParent));
+}
+
+TEST_CASE("Tracing: OTLP/HTTP Exporter", "[tracing]") {
+    // Collector stub: accepts one POST and answers 200
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(::listen(listener, 1) == 0);
+    socklen_t len = sizeof(addr);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+    const int port = ntohs(addr.sin_port);
+
+    std::string received;
+    std::thread collector([&] {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+            received.append(buf, static_cast<size_t>(n));
+            const size_t header_end = received.find("\r\n\r\n");
+            if (header_end != std::string::npos && received.size() >= header_end + 4 + 2) break;
+        }
+        const char reply[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+        ::send(fd, reply, sizeof(reply) - 1, 0);
+        ::close(fd);
+    });
+
+    OtlpHttpExporter exporter("http://127.0.0.1:" + std::to_string(port) + "/v1/traces");
+    CHECK(exporter.export_json("{}"));
+    collector.join();
+    ::close(listener);
+
+    CHECK(received.starts_with("POST /v1/traces HTTP/1.1\r\n"));
+    CHECK(received.find("Content-Type: application/json\r\n") != std::string::npos);
+    CHECK(received.ends_with("\r\n\r\n{}"));
+
+    // Nothing listens there any more
+    CHECK_FALSE(exporter.export_json("{}"));
+    CHECK_THROWS_AS(OtlpHttpExporter("https://collector:4318"), std::invalid_argument);
+}
+
+TEST_CASE("Tracing: Request Spans", "[tracing]") {
+    auto bodies = collect();
+
+    App app;
+    app.use([](Request& req, Response& res, Next next) -> Async<void> {
+        co_await next();
+    });
+    app.get("/traced/:id", [](Request& req, Response& res) -> Async<void> {
+        // Framework code deeper in the call finds the trace on its own
+        Span span(Trace::current(), "lookup");
+        res.send("ok");
+        co_return;
+    });
+
+    net::io_context ioc;
+    Request req;
+    req.method = "GET";
+    req.path = "/traced/7";
+    req.headers.set("traceparent", std::string(kParent));
+    net::co_spawn(ioc, app.handle_request(req, "127.0.0.1"), net::detached);
+    ioc.run();
+
+    CHECK(Trace::current() == nullptr);
+    Tracer::instance().flush();
+    REQUIRE(bodies->size() == 1);
+    const std::string& body = bodies->front();
+    CHECK(count(body, R"("traceId":"0af7651916cd43dd8448eb211c80319c")") == 4);
+    CHECK(body.find(R"("parentSpanId":"b7ad6b7169203331","name":"GET /traced/:id","kind":2)") != std::string::npos);
+    CHECK(body.find(R"("name":"middleware")") != std::string::npos);
+    CHECK(body.find(R"("name":"handler")") != std::string::npos);
+    CHECK(body.find(R"("name":"lookup")") != std::string::npos);
+    CHECK(body.find(R"({"key":"http.route","value":{"stringValue":"/traced/:id"}})") != std::string::npos);
+
+    Tracer::instance().shutdown();
+}
+
+TEST_CASE("Tracing: Interleaved Requests", "[tracing]") {
+    auto bodies = collect();
+    constexpr std::string_view kOtherParent = "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+
+    App app;
+    app.get("/query/:delay", [](Request& req, Response& res) -> Async<void> {
+        // A raw timer knows nothing of tracing; the other request runs while this one waits
+        const int delay = *req.get_param_int("delay");
+        net::steady_timer timer(co_await net::this_coro::executor);
+        timer.expires_after(std::chrono::milliseconds(delay));
+        co_await timer.async_wait(net::use_awaitable);
+        Span span(Trace::current(), "query " + std::to_string(delay));
+        res.send("ok");
+    });
+
+    net::io_context ioc;
+    Request slow, fast;
+    slow.method = fast.method = "GET";
+    slow.path = "/query/30";
+    fast.path = "/query/5";
+    slow.headers.set("traceparent", std::string(kParent));
+    fast.headers.set("traceparent", std::string(kOtherParent));
+    net::co_spawn(ioc, app.handle_request(slow, "127.0.0.1"), net::detached);
+    net::co_spawn(ioc, app.handle_request(fast, "127.0.0.1"), net::detached);
+    ioc.run();
+
+    CHECK(Trace::current() == nullptr);
+    Tracer::instance().flush();
+    std::string all;
+    for (const auto& body : *bodies) all += body;
+
+    // Each span carries the trace id of its own request
+    const auto trace_of = [&](std::string_view name) {
+        const size_t at = all.find(R"("name":")" + std::string(name) + "\"");
+        if (at == std::string::npos) return std::string();
+        const size_t id = all.rfind(R"("traceId":")", at);
+        return all.substr(id + 11, 32);
+    };
+    CHECK(trace_of("query 30") == "0af7651916cd43dd8448eb211c80319c");
+    CHECK(trace_of("query 5") == "4bf92f3577b34da6a3ce929d0e0e4736");
+
+    Tracer::instance().shutdown();
+}
@@ -11,6 +11,7 @@ HOST="http://127.0.0.1:8080"
 WRK_BIN=$(command -v wrk || echo "/usr/bin/wrk")
 GREP_BIN=$(command -v grep || echo "/usr/bin/grep")
 AWK_BIN=$(command -v awk || echo "/usr/bin/awk")
+H2LOAD_BIN=$(command -v h2load || true)
 
 # Lua Script Generation (On-the-fly)
 LUA_POST="/tmp/blaze_post.lua"
@@ -79,6 +80,7 @@ fi
 echo -e "\n${BLUE}--- Phase 1: Sanity Check (Ping) ---${NC}"
 ROUTES=(
     "/health"
+    "/health/static"
     "/modern-json"
     "/locator"
     "/openapi.json"
@@ -126,6 +128,7 @@ run_bench() {
 
 # Run Suite
 run_bench "/health" "/health" ""
+run_bench "/health/static" "/health/static" ""
 run_bench "/modern-api" "/modern-api" "$LUA_POST"
 run_bench "/test/strict-json" "/test/strict-json" "$LUA_INT"
 run_bench "/locator" "/locator" ""
@@ -133,6 +136,31 @@ run_bench "/abstract" "/abstract" ""
 run_bench "/users" "/users" ""
 run_bench "/login" "/login" "$LUA_LOGIN"
 
+# 4. HTTP/2 vs HTTP/1.1 (needs h2load and a server built with libnghttp2)
+if [ -n "$H2LOAD_BIN" ]; then
+    echo -e "\n${BLUE}--- Phase 3: HTTP/2 (h2c) vs HTTP/1.1 ---${NC}"
+    echo -e "| Protocol | Requests/Sec |"
+    echo -e "|----------|--------------|"
+
+    H2_REQUESTS=200000
+    if [ "$MODE" == "CI" ]; then H2_REQUESTS=20000; fi
+
+    run_h2load() {
+        NAME=$1
+        shift
+        OUTPUT=$($H2LOAD_BIN -n $H2_REQUESTS -c $CONNS -t $THREADS "$@" "$HOST/health" 2>&1 || true)
+        RPS=$(echo "$OUTPUT" | $GREP_BIN "finished in" | $AWK_BIN '{print $4}')
+        echo -e "| $NAME | ${RPS:-n/a} |"
+    }
+
+    run_h2load "HTTP/1.1" --h1
+    run_h2load "HTTP/1.1 (pipelined x10)" --h1 -m 10
+    run_h2load "HTTP/2" -m 1
+    run_h2load "HTTP/2 (10 streams)" -m 10
+else
+    echo -e "\n${BLUE}h2load not found, skipping HTTP/2 benchmark${NC}"
+fi
+
 # Cleanup
 if [ "$EXISTING_SERVER" -eq "0" ]; then
     echo -e "\n${GREEN}Stopping server (PID $SERVER_PID)...${NC}"